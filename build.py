@@ -8,7 +8,9 @@ import subprocess
 BuildType = "release"
 WarnLevel = "3"
 RunTest   = False
+RunBench  = False
 Doxygen   = False
+Profiling = True
 
 # Utility functions
 def strtobool(val):
@@ -30,8 +32,12 @@ for arg in sys.argv[1:]:
         WarnLevel = opt[1]
     if opt[0] == "RunTest":
         RunTest = strtobool(opt[1])
+    if opt[0] == "RunBench":
+        RunBench = strtobool(opt[1])
     if opt[0] == "Doxygen":
         Doxygen = strtobool(opt[1])
+    if opt[0] == "Profiling":
+        Profiling = strtobool(opt[1])
 
 # Output directory
 BuildDir = "build/" + BuildType
@@ -41,6 +47,7 @@ conf = [
     "meson", "setup",
     "--buildtype", BuildType,
     "--warnlevel", WarnLevel,
+    "-Dprofiling=" + str(Profiling).lower(),
     BuildDir
 ]
 make = [
@@ -51,6 +58,12 @@ test = [
     "meson", "test",
     "-C", BuildDir
 ]
+bench = [
+    "meson", "test",
+    "--benchmark",
+    "--verbose",
+    "-C", BuildDir
+]
 docs = [
     "doxygen"
 ]
@@ -60,5 +73,7 @@ subprocess.run(conf)
 subprocess.run(make)
 if RunTest:
     subprocess.run(test)
+if RunBench:
+    subprocess.run(bench)
 if Doxygen:
     subprocess.run(docs, cwd=BuildDir)
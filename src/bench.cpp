@@ -0,0 +1,313 @@
+/**
+ * @file
+ * @brief
+ * Entry point of the Starlight benchmarks.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <algorithm>
+#include <any>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include "core/compute.hpp"
+#include "core/device.hpp"
+#include "core/job.hpp"
+#include "core/version.hpp"
+#include "core/window.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    double      duration = 2.0;
+    std::string only;
+};
+
+struct Result {
+    std::string name;
+    double      value;
+    std::string unit;
+    std::size_t samples;
+    std::string extra;
+};
+
+std::string Escape(std::string_view text) {
+    std::string result;
+    for (auto c : text) {
+        if (c == '"' || c == '\\') result += '\\';
+        if (static_cast<unsigned char>(c) >= 0x20) result += c;
+    }
+    return result;
+}
+
+double GetSeconds(Clock::time_point begin) {
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+double GetMedian(std::vector<double> samples) {
+    std::ranges::sort(samples);
+    auto size = samples.size();
+    return size % 2 ? samples[size / 2] : (samples[size / 2 - 1] + samples[size / 2]) / 2.0;
+}
+
+void Print(const Starlight::Core::GpuInfo& gpu, const Result& result) {
+    std::ostringstream line;
+    line << R"({"benchmark":")" << result.name << R"(","value":)" << result.value << R"(,"unit":")" << result.unit << R"(","samples":)" << result.samples;
+    line << R"(,"gpu":")" << Escape(gpu.name) << R"(","vendorID":)" << gpu.vendorID << R"(,"deviceID":)" << gpu.deviceID << R"(,"driverVersion":)" << gpu.driverVersion;
+    line << R"(,"version":")" << Starlight::Core::Version::Major << "." << Starlight::Core::Version::Minor << "." << Starlight::Core::Version::Patch << R"(")";
+    line << result.extra << "}";
+    std::cout << line.str() << std::endl;
+}
+
+void PrintSkipped(std::string_view name, std::string_view reason) {
+    std::cout << R"({"benchmark":")" << name << R"(","skipped":")" << Escape(reason) << R"("})" << std::endl;
+}
+
+template <typename Callback>
+std::size_t RunFor(double duration, Callback callback) {
+    std::size_t count = 0;
+    auto begin = Clock::now();
+    while (GetSeconds(begin) < duration) {
+        callback();
+        ++count;
+    }
+    return count;
+}
+
+Result BenchDeviceCreation(const Options& options, const std::string& name, const std::filesystem::path& cacheDirectory) {
+    std::vector<double> samples;
+    auto begin = Clock::now();
+    while (samples.size() < 3 || (GetSeconds(begin) < options.duration && samples.size() < 20)) {
+        auto created = Clock::now();
+        Starlight::Core::Device device(nullptr, { .cacheDirectory = cacheDirectory });
+        samples.push_back(GetSeconds(created) * 1000.0);
+    }
+    return { name, GetMedian(samples), "ms", samples.size(), {} };
+}
+
+Result BenchSwapchainCreation(const Options& options, Starlight::Core::Device& device) {
+    std::vector<double> samples;
+    auto begin = Clock::now();
+    while (samples.size() < 3 || (GetSeconds(begin) < options.duration && samples.size() < 50)) {
+        auto created = Clock::now();
+        device.ConfigureSwapchain(Starlight::Core::PresentPolicy::Immediate, 2 + samples.size() % 2);
+        samples.push_back(GetSeconds(created) * 1000.0);
+    }
+    return { "swapchain_creation", GetMedian(samples), "ms", samples.size(), {} };
+}
+
+Result BenchClear(const Options& options, Starlight::Core::Device& device, Starlight::Core::Window* window, const std::string& name) {
+    auto begin  = Clock::now();
+    auto frames = RunFor(options.duration, [&] {
+        if (window) window->PollEvents();
+        device.Clear(0.0f, 0.0f, 0.0f);
+    });
+    device.FinishFrames();
+    auto seconds = GetSeconds(begin);
+    return { name, frames / seconds, "fps", frames, {} };
+}
+
+Result BenchUpload(const Options& options) {
+    constexpr std::size_t chunkSize  = 4 << 20;
+    constexpr std::size_t bufferSize = 64 << 20;
+    Starlight::Core::Device device(nullptr, { .cacheDirectory = {} });
+    auto buffer = device.CreateBuffer(bufferSize, Starlight::Core::BufferUsage::Storage);
+    std::vector<std::byte> data(chunkSize, std::byte(0x5a));
+    std::size_t offset = 0;
+    auto begin  = Clock::now();
+    auto chunks = RunFor(options.duration, [&] {
+        device.UploadBuffer(buffer, offset, data);
+        offset = (offset + chunkSize) % bufferSize;
+    });
+    device.WaitUpload(device.FlushUploads());
+    auto seconds = GetSeconds(begin);
+    device.DestroyBuffer(buffer);
+    return { "upload_bandwidth", chunks * chunkSize / seconds / (1 << 20), "MiB/s", chunks, {} };
+}
+
+std::vector<Result> BenchRecording(const Options& options) {
+    constexpr std::size_t commandsPerPart = 4096;
+    Starlight::Core::Device device(nullptr, { .cacheDirectory = {} });
+    std::vector<Result> results;
+    for (std::size_t parts = 1; parts <= Starlight::Core::Job::GetThreadCount(); parts *= 2) {
+        auto record = [](std::size_t, std::any commandBuffer) {
+            auto target = std::any_cast<vk::CommandBuffer>(commandBuffer);
+            vk::Viewport viewport(0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f);
+            for (std::size_t i = 0; i < commandsPerPart; ++i) target.setViewport(0, viewport);
+        };
+        auto begin  = Clock::now();
+        auto frames = RunFor(options.duration, [&] {
+            device.BeginFrame(0.0f, 0.0f, 0.0f);
+            device.Record(parts, record);
+            device.EndFrame();
+        });
+        device.FinishFrames();
+        auto seconds = GetSeconds(begin);
+        auto extra   = R"(,"threads":)" + std::to_string(parts);
+        results.push_back({ "recording_throughput", frames * parts * commandsPerPart / seconds, "commands/s", frames, extra });
+    }
+    return results;
+}
+
+Result BenchDeferred(const Options& options) {
+    using Starlight::Core::TextureFormat;
+    Starlight::Core::Device device(nullptr, { .cacheDirectory = {} });
+    auto none   = [](std::any) {};
+    auto begin  = Clock::now();
+    auto frames = RunFor(options.duration, [&] {
+        device.BeginFrame(0.0f, 0.0f, 0.0f);
+        auto albedo = device.CreatePassImage({ .format = TextureFormat::RGBA8Unorm });
+        auto normal = device.CreatePassImage({ .format = TextureFormat::RGBA16Float });
+        auto depth  = device.CreatePassImage({ .depth = true });
+        auto hdr    = device.CreatePassImage({ .format = TextureFormat::RGBA16Float });
+        auto bloom  = device.CreatePassImage({ .format = TextureFormat::RGBA16Float, .width = 640, .height = 360 });
+        std::array gbuffer{ albedo, normal, depth };
+        std::array lights{ hdr };
+        std::array blooms{ bloom };
+        std::array post{ hdr, bloom };
+        device.AddPass("gbuffer", { .colors = std::span(gbuffer).first(2), .depth = depth }, none);
+        device.AddPass("lighting", { .colors = lights, .samples = gbuffer }, none);
+        device.AddPass("bloom", { .colors = blooms, .samples = lights }, none);
+        device.Record(1, [](std::size_t, std::any) {}, post);
+        device.EndFrame();
+    });
+    device.FinishFrames();
+    auto seconds = GetSeconds(begin);
+    auto stats   = device.GetTransientStats();
+    auto extra   = R"(,"requestedBytes":)" + std::to_string(stats.requestedBytes) + R"(,"allocatedBytes":)" + std::to_string(stats.allocatedBytes);
+    return { "deferred_frame", frames / seconds, "fps", frames, extra };
+}
+
+Result BenchDispatch(const Options& options) {
+    constexpr std::size_t   dispatchesPerBatch = 64;
+    constexpr std::size_t   maxBatchesInFlight = 256;
+    constexpr std::uint32_t elementCount       = 1 << 16;
+    Starlight::Core::ComputeDevice device({ .cacheDirectory = {} });
+    auto kernel = device.CreateKernel("scale.comp.spv");
+    auto buffer = device.CreateBuffer(elementCount * sizeof(float));
+    struct {
+        std::uint32_t count;
+        float         factor;
+    } constants{ elementCount, 1.0f };
+    std::array buffers{ buffer };
+    Starlight::Core::ComputeDispatch dispatch{ .kernel = kernel, .groupCountX = elementCount / 64, .buffers = buffers, .constants = std::as_bytes(std::span(&constants, 1)) };
+    std::vector<Starlight::Core::ComputeDispatch> dispatches(dispatchesPerBatch, dispatch);
+    std::deque<Starlight::Core::ComputeToken> tokens;
+    auto begin   = Clock::now();
+    auto batches = RunFor(options.duration, [&] {
+        tokens.push_back(device.Submit(dispatches));
+        if (tokens.size() <= maxBatchesInFlight) return;
+        device.Wait(tokens.front());
+        tokens.pop_front();
+    });
+    device.WaitIdle();
+    auto seconds = GetSeconds(begin);
+    device.DestroyBuffer(buffer);
+    device.DestroyKernel(kernel);
+    auto extra = R"(,"queues":)" + std::to_string(device.GetQueueCount());
+    return { "compute_dispatch_throughput", batches * dispatchesPerBatch / seconds, "dispatches/s", batches, extra };
+}
+
+Options ParseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg(argv[i]);
+        if (arg.starts_with("--duration=")) options.duration = std::stod(std::string(arg.substr(11)));
+        if (arg.starts_with("--only="    )) options.only     = arg.substr(7);
+    }
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    auto options = ParseOptions(argc, argv);
+    auto enabled = [&](std::string_view name) {
+        return options.only.empty() || name.find(options.only) != std::string_view::npos;
+    };
+    auto run = [&](std::string_view name, const std::function<void(void)>& bench) {
+        if (!enabled(name)) return;
+        try {
+            bench();
+        } catch (const std::exception& e) {
+            PrintSkipped(name, e.what());
+        }
+    };
+    Starlight::Core::GpuInfo gpu{};
+    try {
+        gpu = Starlight::Core::Device(nullptr, { .cacheDirectory = {} }).GetGpuInfo();
+    } catch (const std::exception& e) {
+        PrintSkipped("all", e.what());
+        return EXIT_FAILURE;
+    }
+    run("device_creation", [&] {
+        Print(gpu, BenchDeviceCreation(options, "device_creation", {}));
+    });
+    run("device_creation_cached", [&] {
+        Print(gpu, BenchDeviceCreation(options, "device_creation_cached", "bench-cache"));
+    });
+    run("headless_clear", [&] {
+        Starlight::Core::Device device(nullptr, { .cacheDirectory = {} });
+        Print(gpu, BenchClear(options, device, nullptr, "headless_clear"));
+    });
+    run("upload_bandwidth", [&] {
+        Print(gpu, BenchUpload(options));
+    });
+    run("recording_throughput", [&] {
+        for (const auto& result : BenchRecording(options)) Print(gpu, result);
+    });
+    run("deferred_frame", [&] {
+        Print(gpu, BenchDeferred(options));
+    });
+    run("compute_dispatch_throughput", [&] {
+        Print(gpu, BenchDispatch(options));
+    });
+    if (enabled("swapchain_creation") || enabled("windowed_clear")) {
+        try {
+            auto window = Starlight::Core::CreateSharedWindow("Starlight Benchmark", 1280, 720, true);
+            Starlight::Core::Device device(window, { .presentPolicy = Starlight::Core::PresentPolicy::Immediate, .cacheDirectory = {} });
+            run("swapchain_creation", [&] {
+                Print(gpu, BenchSwapchainCreation(options, device));
+            });
+            run("windowed_clear", [&] {
+                Print(gpu, BenchClear(options, device, window.get(), "windowed_clear"));
+            });
+        } catch (const std::exception& e) {
+            PrintSkipped("windowed", e.what());
+        }
+    }
+    return EXIT_SUCCESS;
+}
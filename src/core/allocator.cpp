@@ -0,0 +1,402 @@
+/**
+ * @file
+ * @brief
+ * Sub-allocate the GPU memory.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <algorithm>
+#include <bit>
+#include <mutex>
+#include <tuple>
+#include "allocator.hpp"
+
+namespace Starlight::Core {
+
+namespace {
+
+class Tlsf final {
+public:
+    struct Node {
+        vk::DeviceSize offset;
+        vk::DeviceSize size;
+        bool           free;
+        Node*          prevPhys;
+        Node*          nextPhys;
+        Node*          prevFree;
+        Node*          nextFree;
+    };
+    explicit Tlsf(vk::DeviceSize size) : flBitmap(0), slBitmap{}, heads{} {
+        first = new Node{ 0, size, true, nullptr, nullptr, nullptr, nullptr };
+        Insert(first);
+    }
+    ~Tlsf() {
+        auto node = first;
+        while (node) {
+            auto next = node->nextPhys;
+            delete node;
+            node = next;
+        }
+    }
+    Tlsf(const Tlsf&) = delete;
+    Tlsf& operator=(const Tlsf&) = delete;
+    Node* Allocate(vk::DeviceSize size, vk::DeviceSize alignment) {
+        auto node = Search(size + alignment - 1);
+        if (!node) return nullptr;
+        Remove(node);
+        if (auto padding = (alignment - node->offset % alignment) % alignment) {
+            auto body = Split(node, padding);
+            Insert(node);
+            node = body;
+        }
+        if (node->size > size) Insert(Split(node, size));
+        node->free = false;
+        return node;
+    }
+    void Free(Node* node) {
+        node->free = true;
+        if (auto prev = node->prevPhys; prev && prev->free) {
+            Remove(prev);
+            node = Merge(prev, node);
+        }
+        if (auto next = node->nextPhys; next && next->free) {
+            Remove(next);
+            node = Merge(node, next);
+        }
+        Insert(node);
+    }
+    bool Empty(void) const {
+        return first->free && !first->nextPhys;
+    }
+private:
+    static constexpr std::uint32_t slLog2  = 4;
+    static constexpr std::uint32_t slCount = 1u << slLog2;
+    static constexpr std::uint32_t flCount = 64 - slLog2 + 1;
+    std::uint64_t                                   flBitmap;
+    std::array<std::uint32_t, flCount>              slBitmap;
+    std::array<std::array<Node*, slCount>, flCount> heads;
+    Node*                                           first;
+    static void Mapping(vk::DeviceSize size, std::uint32_t& fl, std::uint32_t& sl) {
+        if (size < slCount) {
+            fl = 0;
+            sl = static_cast<std::uint32_t>(size);
+        } else {
+            auto msb = static_cast<std::uint32_t>(std::bit_width(size)) - 1;
+            fl = msb - slLog2 + 1;
+            sl = static_cast<std::uint32_t>(size >> (msb - slLog2)) ^ slCount;
+        }
+    }
+    Node* Search(vk::DeviceSize size) {
+        if (size >= slCount) {
+            auto msb = static_cast<std::uint32_t>(std::bit_width(size)) - 1;
+            auto round = (vk::DeviceSize(1) << (msb - slLog2)) - 1;
+            if (size > std::numeric_limits<vk::DeviceSize>::max() - round) return nullptr;
+            size += round;
+        }
+        std::uint32_t fl, sl;
+        Mapping(size, fl, sl);
+        if (fl >= flCount) return nullptr;
+        auto slMap = slBitmap[fl] & (~0u << sl);
+        if (!slMap) {
+            auto flMap = fl + 1 < 64 ? flBitmap & (~std::uint64_t(0) << (fl + 1)) : 0;
+            if (!flMap) return nullptr;
+            fl    = static_cast<std::uint32_t>(std::countr_zero(flMap));
+            slMap = slBitmap[fl];
+        }
+        sl = static_cast<std::uint32_t>(std::countr_zero(slMap));
+        return heads[fl][sl];
+    }
+    void Insert(Node* node) {
+        std::uint32_t fl, sl;
+        Mapping(node->size, fl, sl);
+        node->free     = true;
+        node->prevFree = nullptr;
+        node->nextFree = heads[fl][sl];
+        if (node->nextFree) node->nextFree->prevFree = node;
+        heads[fl][sl] = node;
+        flBitmap     |= std::uint64_t(1) << fl;
+        slBitmap[fl] |= 1u << sl;
+    }
+    void Remove(Node* node) {
+        std::uint32_t fl, sl;
+        Mapping(node->size, fl, sl);
+        if (node->prevFree) node->prevFree->nextFree = node->nextFree;
+        if (node->nextFree) node->nextFree->prevFree = node->prevFree;
+        if (heads[fl][sl] == node) {
+            heads[fl][sl] = node->nextFree;
+            if (!heads[fl][sl]) {
+                slBitmap[fl] &= ~(1u << sl);
+                if (!slBitmap[fl]) flBitmap &= ~(std::uint64_t(1) << fl);
+            }
+        }
+        node->prevFree = nullptr;
+        node->nextFree = nullptr;
+    }
+    Node* Split(Node* node, vk::DeviceSize size) {
+        auto tail = new Node{ node->offset + size, node->size - size, false, node, node->nextPhys, nullptr, nullptr };
+        if (tail->nextPhys) tail->nextPhys->prevPhys = tail;
+        node->nextPhys = tail;
+        node->size     = size;
+        return tail;
+    }
+    Node* Merge(Node* head, Node* tail) {
+        head->size    += tail->size;
+        head->nextPhys = tail->nextPhys;
+        if (head->nextPhys) head->nextPhys->prevPhys = head;
+        delete tail;
+        return head;
+    }
+};
+
+struct Block {
+    vk::UniqueDeviceMemory memory;
+    void*                  mapped;
+    std::unique_ptr<Tlsf>  tlsf;
+    std::size_t            poolIndex;
+};
+
+} // namespace
+
+static std::pair<vk::MemoryPropertyFlags, vk::MemoryPropertyFlags> GetMemoryProperties(MemoryUsage usage) {
+    using enum vk::MemoryPropertyFlagBits;
+    switch (usage) {
+    case MemoryUsage::CpuToGpu:
+        return { eHostVisible | eHostCoherent, {} };
+    case MemoryUsage::GpuToCpu:
+        return { eHostVisible | eHostCoherent, eHostCached };
+    case MemoryUsage::GpuLazy:
+        return { eDeviceLocal, eLazilyAllocated };
+    default:
+        return { eDeviceLocal, {} };
+    }
+}
+
+static constexpr std::array memoryUsages{ MemoryUsage::GpuOnly, MemoryUsage::CpuToGpu, MemoryUsage::GpuToCpu, MemoryUsage::GpuLazy };
+
+struct Allocator::Impl {
+    using Pool = std::vector<std::unique_ptr<Block>>;
+    using Rank = std::vector<std::uint32_t>;
+    vk::PhysicalDevice                          phyDevice;
+    vk::Device                                  device;
+    vk::PhysicalDeviceMemoryProperties          properties;
+    vk::DeviceSize                              blockSize;
+    std::array<Rank, memoryUsages.size()>       ranks;
+    std::mutex                                  mutex;
+    std::array<Pool, VK_MAX_MEMORY_TYPES * 2>  pools;
+    Impl(vk::PhysicalDevice phyDevice, vk::Device device, vk::DeviceSize blockSize) :
+    phyDevice(phyDevice), device(device), properties(phyDevice.getMemoryProperties()), blockSize(blockSize) {
+        for (auto usage : memoryUsages) ranks[static_cast<std::size_t>(usage)] = RankMemoryTypes(usage);
+    }
+    Rank RankMemoryTypes(MemoryUsage usage) const {
+        auto [required, preferred] = GetMemoryProperties(usage);
+        auto avoidLazy = !(preferred & vk::MemoryPropertyFlagBits::eLazilyAllocated);
+        auto cost = [&](std::uint32_t index) {
+            auto flags   = properties.memoryTypes[index].propertyFlags;
+            auto missing = (flags & required) != required;
+            auto matched = std::popcount(static_cast<VkMemoryPropertyFlags>(flags & preferred));
+            auto avoided = avoidLazy && (flags & vk::MemoryPropertyFlagBits::eLazilyAllocated);
+            return std::tuple(missing, avoided, -matched);
+        };
+        Rank rank;
+        for (std::uint32_t i = 0; i < properties.memoryTypeCount; ++i) {
+            auto flags = properties.memoryTypes[i].propertyFlags;
+            if ((flags & required) == required || usage == MemoryUsage::GpuOnly) rank.push_back(i);
+        }
+        std::ranges::stable_sort(rank, {}, cost);
+        return rank;
+    }
+    std::uint32_t LookupMemoryType(std::uint32_t typeBits, MemoryUsage usage) const {
+        for (auto index : ranks[static_cast<std::size_t>(usage)]) {
+            if (typeBits & (1u << index)) return index;
+        }
+        throw std::runtime_error("No suitable memory type found");
+    }
+    std::unique_ptr<Block> CreateBlock(std::uint32_t typeIndex, std::size_t poolIndex, vk::DeviceSize size, bool dedicated) {
+        auto block = std::make_unique<Block>();
+        block->poolIndex = poolIndex;
+        block->memory = device.allocateMemoryUnique(vk::MemoryAllocateInfo(size, typeIndex));
+        block->mapped = nullptr;
+        if (properties.memoryTypes[typeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+            block->mapped = device.mapMemory(*block->memory, 0, VK_WHOLE_SIZE);
+        }
+        if (!dedicated) block->tlsf = std::make_unique<Tlsf>(size);
+        return block;
+    }
+    vk::DeviceSize GetBlockSize(std::uint32_t typeIndex) const {
+        const auto& heap = properties.memoryHeaps[properties.memoryTypes[typeIndex].heapIndex];
+        return std::min(blockSize, heap.size / 8);
+    }
+};
+
+Allocation::Allocation() :
+allocator(nullptr), block(nullptr), node(nullptr), memory(nullptr), offset(0), size(0), mapped(nullptr) {
+}
+
+Allocation::Allocation(Allocation&& other) noexcept :
+allocator(std::exchange(other.allocator, nullptr)), block(std::exchange(other.block, nullptr)), node(std::exchange(other.node, nullptr)),
+memory(std::exchange(other.memory, nullptr)), offset(std::exchange(other.offset, 0)), size(std::exchange(other.size, 0)), mapped(std::exchange(other.mapped, nullptr)) {
+}
+
+Allocation& Allocation::operator=(Allocation&& other) noexcept {
+    if (this != &other) {
+        if (allocator) allocator->Free(*this);
+        allocator = std::exchange(other.allocator, nullptr);
+        block     = std::exchange(other.block,     nullptr);
+        node      = std::exchange(other.node,      nullptr);
+        memory    = std::exchange(other.memory,    nullptr);
+        offset    = std::exchange(other.offset,    0);
+        size      = std::exchange(other.size,      0);
+        mapped    = std::exchange(other.mapped,    nullptr);
+    }
+    return *this;
+}
+
+Allocation::~Allocation() {
+    if (allocator) allocator->Free(*this);
+}
+
+Allocation::operator bool() const {
+    return allocator != nullptr;
+}
+
+vk::DeviceMemory Allocation::GetMemory(void) const {
+    return memory;
+}
+
+vk::DeviceSize Allocation::GetOffset(void) const {
+    return offset;
+}
+
+vk::DeviceSize Allocation::GetSize(void) const {
+    return size;
+}
+
+void* Allocation::GetMapped(void) const {
+    return mapped;
+}
+
+Allocator::Allocator(vk::PhysicalDevice phyDevice, vk::Device device, vk::DeviceSize blockSize) :
+pImpl(std::make_unique<Impl>(phyDevice, device, blockSize)) {
+}
+
+Allocator::~Allocator() {
+}
+
+std::uint32_t Allocator::FindMemoryType(std::uint32_t typeBits, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred) const {
+    const auto& properties = pImpl->properties;
+    auto found = std::numeric_limits<std::uint32_t>::max();
+    auto score = -1;
+    for (std::uint32_t i = 0, size = properties.memoryTypeCount; i < size; ++i) {
+        if (!(typeBits & (1u << i))) continue;
+        auto flags = properties.memoryTypes[i].propertyFlags;
+        if ((flags & required) != required) continue;
+        auto matched = std::popcount(static_cast<VkMemoryPropertyFlags>(flags & preferred));
+        if (matched > score) {
+            found = i;
+            score = matched;
+        }
+    }
+    if (score < 0) throw std::runtime_error("No suitable memory type found");
+    return found;
+}
+
+Allocation Allocator::Allocate(const vk::MemoryRequirements& requirements, MemoryUsage usage, bool linear) {
+    auto typeIndex = pImpl->LookupMemoryType(requirements.memoryTypeBits, usage);
+    auto blockSize = pImpl->GetBlockSize(typeIndex);
+    auto poolIndex = typeIndex * 2 + (linear ? 1 : 0);
+    auto& pool = pImpl->pools[poolIndex];
+    std::lock_guard lock(pImpl->mutex);
+    Block* block = nullptr;
+    Tlsf::Node* node = nullptr;
+    if (requirements.size > blockSize / 2) {
+        block = pool.emplace_back(pImpl->CreateBlock(typeIndex, poolIndex, requirements.size, true)).get();
+    } else {
+        for (const auto& candidate : pool) {
+            if (!candidate->tlsf) continue;
+            if ((node = candidate->tlsf->Allocate(requirements.size, requirements.alignment))) {
+                block = candidate.get();
+                break;
+            }
+        }
+        if (!block) {
+            block = pool.emplace_back(pImpl->CreateBlock(typeIndex, poolIndex, blockSize, false)).get();
+            node  = block->tlsf->Allocate(requirements.size, requirements.alignment);
+            if (!node) throw std::runtime_error("Failed to sub-allocate the GPU memory");
+        }
+    }
+    Allocation allocation;
+    allocation.allocator = this;
+    allocation.block     = block;
+    allocation.node      = node;
+    allocation.memory    = *block->memory;
+    allocation.offset    = node ? node->offset : 0;
+    allocation.size      = requirements.size;
+    allocation.mapped    = block->mapped ? static_cast<std::byte*>(block->mapped) + allocation.offset : nullptr;
+    return allocation;
+}
+
+Image Allocator::CreateImage(const vk::ImageCreateInfo& info, MemoryUsage usage) {
+    Image image;
+    image.image      = pImpl->device.createImageUnique(info);
+    image.allocation = Allocate(pImpl->device.getImageMemoryRequirements(*image.image), usage, info.tiling == vk::ImageTiling::eLinear);
+    pImpl->device.bindImageMemory(*image.image, image.allocation.GetMemory(), image.allocation.GetOffset());
+    return image;
+}
+
+Buffer Allocator::CreateBuffer(const vk::BufferCreateInfo& info, MemoryUsage usage) {
+    Buffer buffer;
+    buffer.buffer     = pImpl->device.createBufferUnique(info);
+    buffer.allocation = Allocate(pImpl->device.getBufferMemoryRequirements(*buffer.buffer), usage, true);
+    pImpl->device.bindBufferMemory(*buffer.buffer, buffer.allocation.GetMemory(), buffer.allocation.GetOffset());
+    return buffer;
+}
+
+void Allocator::Free(Allocation& allocation) {
+    std::lock_guard lock(pImpl->mutex);
+    auto block = static_cast<Block*>(allocation.block);
+    auto node  = static_cast<Tlsf::Node*>(allocation.node);
+    if (node) block->tlsf->Free(node);
+    if (!node || block->tlsf->Empty()) {
+        auto& pool  = pImpl->pools[block->poolIndex];
+        auto  found = std::ranges::find_if(pool, [block](const auto& candidate) { return candidate.get() == block; });
+        auto  count = std::ranges::count_if(pool, [](const auto& candidate) { return candidate->tlsf != nullptr; });
+        if (!node || count > 1) pool.erase(found);
+    }
+    allocation.allocator = nullptr;
+}
+
+LinearArena::LinearArena(Allocator& allocator, vk::DeviceSize size, vk::BufferUsageFlags usage) :
+buffer(allocator.CreateBuffer(vk::BufferCreateInfo(vk::BufferCreateFlags(), size, usage), MemoryUsage::CpuToGpu)), capacity(size), offset(0) {
+}
+
+LinearArena::Range LinearArena::Allocate(vk::DeviceSize size, vk::DeviceSize alignment) {
+    alignment  = std::max<vk::DeviceSize>(alignment, 1);
+    auto begin = (offset + alignment - 1) / alignment * alignment;
+    if (begin > capacity || size > capacity - begin) throw std::runtime_error("The linear arena is exhausted");
+    offset = begin + size;
+    return { *buffer.buffer, begin, static_cast<std::byte*>(buffer.allocation.GetMapped()) + begin };
+}
+
+void LinearArena::Reset(void) {
+    offset = 0;
+}
+
+} // namespace Starlight::Core
@@ -0,0 +1,298 @@
+/**
+ * @file
+ * @brief
+ * Sub-allocate the GPU memory.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_ALLOCATOR_HPP
+#define STARLIGHT_CORE_ALLOCATOR_HPP
+
+#include <memory>
+#include <vulkan/vulkan.hpp>
+
+namespace Starlight::Core {
+
+class Allocator;
+
+/**
+ * @brief Intended usage of the GPU memory.
+ *
+ * This enumeration selects the memory properties that an allocation is placed in.
+ * Host visible usages are persistently mapped.
+ */
+enum class MemoryUsage {
+    GpuOnly,  ///< Device local memory that only the GPU accesses.
+    CpuToGpu, ///< Host visible memory that the CPU writes and the GPU reads.
+    GpuToCpu, ///< Host visible memory that the GPU writes and the CPU reads.
+    GpuLazy,  ///< Device local memory that is lazily allocated if possible, for transient attachments.
+};
+
+/**
+ * @brief A range of GPU memory sub-allocated from an Allocator.
+ *
+ * This class owns a range of a memory block and returns it to the allocator when destroyed.
+ * It is movable but not copyable, in the same way as the `vk::Unique*` handles.
+ */
+class Allocation final {
+public:
+    /**
+     * @brief Construct an empty Allocation object.
+     */
+    Allocation();
+
+    /**
+     * @brief Move construct an Allocation object.
+     *
+     * @param other The allocation to take the ownership from.
+     */
+    Allocation(Allocation&& other) noexcept;
+
+    /**
+     * @brief Move assign an Allocation object.
+     *
+     * The currently owned range is returned to the allocator before taking the ownership.
+     *
+     * @param other The allocation to take the ownership from.
+     *
+     * @return This allocation.
+     */
+    Allocation& operator=(Allocation&& other) noexcept;
+
+    /**
+     * @brief Destruct the Allocation object.
+     *
+     * The owned range is returned to the allocator.
+     */
+    ~Allocation();
+
+    /**
+     * @brief Check if the allocation owns a range.
+     *
+     * @return true if the allocation owns a range, false otherwise.
+     */
+    explicit operator bool() const;
+
+    /**
+     * @brief Get the memory object that the range belongs to.
+     *
+     * @return The memory object.
+     */
+    vk::DeviceMemory GetMemory(void) const;
+
+    /**
+     * @brief Get the offset of the range in the memory object.
+     *
+     * @return The offset in bytes.
+     */
+    vk::DeviceSize GetOffset(void) const;
+
+    /**
+     * @brief Get the size of the range.
+     *
+     * @return The size in bytes.
+     */
+    vk::DeviceSize GetSize(void) const;
+
+    /**
+     * @brief Get the host address of the range.
+     *
+     * @return The host address, or nullptr if the memory is not host visible.
+     */
+    void* GetMapped(void) const;
+
+private:
+    friend class Allocator;
+    Allocator*       allocator;
+    void*            block;
+    void*            node;
+    vk::DeviceMemory memory;
+    vk::DeviceSize   offset;
+    vk::DeviceSize   size;
+    void*            mapped;
+};
+
+/**
+ * @brief An image and the memory bound to it.
+ */
+struct Image final {
+    Allocation      allocation; ///< The memory bound to the image.
+    vk::UniqueImage image;      ///< The image, destroyed before its memory.
+};
+
+/**
+ * @brief A buffer and the memory bound to it.
+ */
+struct Buffer final {
+    Allocation       allocation; ///< The memory bound to the buffer.
+    vk::UniqueBuffer buffer;     ///< The buffer, destroyed before its memory.
+};
+
+/**
+ * @brief Sub-allocate the GPU memory.
+ *
+ * This class allocates large memory blocks per memory type and sub-allocates them
+ * with a two-level segregated fit (TLSF) allocator, so the number of driver allocations stays small.
+ * Linear (buffer) and optimal (image) resources live in separate blocks,
+ * so the buffer-image granularity never has to be considered.
+ * Requests larger than half a block get a dedicated memory object.
+ * The memory types are ranked per usage once at construction, so an allocation picks its memory type from a table,
+ * and lazily allocated memory is only chosen for transient attachments.
+ * All methods are thread safe.
+ */
+class Allocator final {
+public:
+    /**
+     * @brief Construct a new Allocator object.
+     *
+     * @param phyDevice The physical device to allocate from.
+     * @param device    The logical device to allocate from.
+     * @param blockSize The preferred size of a memory block.
+     */
+    Allocator(vk::PhysicalDevice phyDevice, vk::Device device, vk::DeviceSize blockSize = 64 << 20);
+
+    /**
+     * @brief Destruct the Allocator object.
+     *
+     * All allocations must be destroyed before the allocator.
+     */
+    ~Allocator();
+
+    /**
+     * @brief Find a memory type.
+     *
+     * This method returns the index of the memory type that is allowed by `typeBits`,
+     * has all of the `required` properties, and has as many of the `preferred` properties as possible.
+     * If no memory type matches, a `std::runtime_error` exception is thrown.
+     *
+     * @param typeBits  The bit mask of the allowed memory types.
+     * @param required  The properties that the memory type must have.
+     * @param preferred The properties that the memory type should have.
+     *
+     * @return The index of the memory type.
+     *
+     * @throw std::runtime_error If no memory type matches.
+     */
+    std::uint32_t FindMemoryType(std::uint32_t typeBits, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred) const;
+
+    /**
+     * @brief Allocate a range of the GPU memory.
+     *
+     * If the allocation fails, a `std::runtime_error` exception is thrown.
+     *
+     * @param requirements The memory requirements of the resource.
+     * @param usage        The intended usage of the memory.
+     * @param linear       Whether the resource is linear (a buffer or a linear image).
+     *
+     * @return The allocation.
+     *
+     * @throw std::runtime_error If the allocation fails.
+     */
+    Allocation Allocate(const vk::MemoryRequirements& requirements, MemoryUsage usage, bool linear);
+
+    /**
+     * @brief Create an image and bind memory to it.
+     *
+     * @param info  The parameters of the image.
+     * @param usage The intended usage of the memory.
+     *
+     * @return The image and its memory.
+     *
+     * @throw std::runtime_error If the allocation fails.
+     */
+    Image CreateImage(const vk::ImageCreateInfo& info, MemoryUsage usage);
+
+    /**
+     * @brief Create a buffer and bind memory to it.
+     *
+     * @param info  The parameters of the buffer.
+     * @param usage The intended usage of the memory.
+     *
+     * @return The buffer and its memory.
+     *
+     * @throw std::runtime_error If the allocation fails.
+     */
+    Buffer CreateBuffer(const vk::BufferCreateInfo& info, MemoryUsage usage);
+
+private:
+    friend class Allocation;
+    struct Impl;
+    std::unique_ptr<Impl> pImpl;
+    void Free(Allocation& allocation);
+};
+
+/**
+ * @brief Sub-allocate a buffer linearly.
+ *
+ * This class owns a persistently mapped buffer and hands out ranges of it by bumping an offset.
+ * The ranges are released all at once by Reset, which makes it suitable for transient per-frame data.
+ * It is not thread safe.
+ */
+class LinearArena final {
+public:
+    /**
+     * @brief A range of the arena.
+     */
+    struct Range final {
+        vk::Buffer     buffer; ///< The buffer of the arena.
+        vk::DeviceSize offset; ///< The offset of the range in the buffer.
+        void*          mapped; ///< The host address of the range.
+    };
+
+    /**
+     * @brief Construct a new LinearArena object.
+     *
+     * @param allocator The allocator to create the buffer with.
+     * @param size      The size of the arena.
+     * @param usage     The usage flags of the buffer.
+     */
+    LinearArena(Allocator& allocator, vk::DeviceSize size, vk::BufferUsageFlags usage);
+
+    /**
+     * @brief Allocate a range of the arena.
+     *
+     * If the arena is exhausted, a `std::runtime_error` exception is thrown.
+     *
+     * @param size      The size of the range.
+     * @param alignment The alignment of the range, where 0 is treated as 1.
+     *
+     * @return The range.
+     *
+     * @throw std::runtime_error If the arena is exhausted.
+     */
+    Range Allocate(vk::DeviceSize size, vk::DeviceSize alignment);
+
+    /**
+     * @brief Release all ranges of the arena.
+     *
+     * The GPU must have finished using the ranges before calling this method.
+     */
+    void Reset(void);
+
+private:
+    Buffer         buffer;
+    vk::DeviceSize capacity;
+    vk::DeviceSize offset;
+};
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_ALLOCATOR_HPP
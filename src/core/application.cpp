@@ -0,0 +1,218 @@
+/**
+ * @file
+ * @brief
+ * Run the main loop of the application.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include "application.hpp"
+#include "job.hpp"
+#include "profiler.hpp"
+
+namespace Starlight::Core {
+
+struct Application::Impl {
+    using Clock = std::chrono::steady_clock;
+    SharedWindow            window;
+    ApplicationOptions      options;
+    UpdateCallback          update;
+    RenderCallback          render;
+    InputCallback           input;
+    std::atomic<bool>       redraw = true;
+    std::atomic<bool>       quit   = false;
+    std::atomic<bool>       shown  = false;
+    Clock::time_point       previous;
+    double                  lag    = 0.0;
+    FrameTimeHistogram      histogram;
+    std::mutex              mutex;
+    std::condition_variable signal;
+    std::uint64_t           wakeups = 0;
+    bool                    stopping = false;
+    std::exception_ptr      error;
+    void UpdateShown(void) {
+        auto visible = window->IsVisible() && !window->IsIconified();
+        if (visible && !shown) redraw = true;
+        shown = visible;
+    }
+    bool IsIdle(void) const {
+        return !shown || (!options.continuous && !redraw);
+    }
+    void Wake(void) {
+        {
+            std::lock_guard lock(mutex);
+            ++wakeups;
+        }
+        signal.notify_one();
+    }
+    void DrainInput(void) {
+        STARLIGHT_ZONE("Input");
+        while (auto event = window->PopEvent()) {
+            if (input) input(*event);
+        }
+    }
+    void Step(void) {
+        redraw = false;
+        auto alpha = Advance();
+        STARLIGHT_ZONE("Render");
+        if (render) render(alpha);
+    }
+    void RunRenderThread(void) {
+        try {
+            previous = Clock::now();
+            for (;;) {
+                std::uint64_t seen;
+                {
+                    std::lock_guard lock(mutex);
+                    if (stopping) return;
+                    seen = wakeups;
+                }
+                DrainInput();
+                if (IsIdle()) {
+                    std::unique_lock lock(mutex);
+                    signal.wait_for(lock, std::chrono::duration<double>(options.idleTimeout), [&] { return stopping || wakeups != seen; });
+                    previous = Clock::now();
+                    continue;
+                }
+                Step();
+                window->PostEmptyEvent();
+            }
+        } catch (...) {
+            error = std::current_exception();
+            quit  = true;
+            window->PostEmptyEvent();
+        }
+    }
+    double Advance(void) {
+        auto now = Clock::now();
+        auto delta = std::chrono::duration<double>(now - previous).count();
+        previous = now;
+        histogram.Add(delta * 1000.0);
+        STARLIGHT_ZONE("Update");
+        if (options.fixedStep <= 0.0) {
+            if (update) update(delta);
+            return 1.0;
+        }
+        lag += delta;
+        std::size_t steps = 0;
+        for (; lag >= options.fixedStep && steps < options.maxSteps; ++steps) {
+            if (update) update(options.fixedStep);
+            lag -= options.fixedStep;
+        }
+        if (lag >= options.fixedStep) lag = std::fmod(lag, options.fixedStep);
+        return lag / options.fixedStep;
+    }
+};
+
+Application::Application(SharedWindow window) :
+Application(window, ApplicationOptions()) {
+}
+
+Application::Application(SharedWindow window, const ApplicationOptions& options) :
+pImpl(std::make_unique<Impl>()) {
+    pImpl->window  = window;
+    pImpl->options = options;
+}
+
+Application::~Application() {
+}
+
+void Application::SetUpdateCallback(const UpdateCallback& update) {
+    pImpl->update = update;
+}
+
+void Application::SetRenderCallback(const RenderCallback& render) {
+    pImpl->render = render;
+}
+
+void Application::SetInputCallback(const InputCallback& input) {
+    pImpl->input = input;
+}
+
+void Application::RequestRedraw(void) {
+    pImpl->redraw = true;
+    pImpl->window->PostEmptyEvent();
+    pImpl->Wake();
+}
+
+void Application::Quit(void) {
+    pImpl->quit = true;
+    pImpl->window->PostEmptyEvent();
+    pImpl->Wake();
+}
+
+FrameTimeStats Application::GetFrameTimeStats(void) const {
+    return pImpl->histogram.GetStats();
+}
+
+void Application::Run(void) {
+    Job::RunMainThread();
+    pImpl->UpdateShown();
+    if (!pImpl->options.renderThread) {
+        pImpl->previous = Impl::Clock::now();
+        while (!pImpl->quit && !pImpl->window->ShouldClose()) {
+            Job::RunMainThread();
+            pImpl->UpdateShown();
+            if (pImpl->IsIdle()) {
+                pImpl->window->WaitEvents(pImpl->options.idleTimeout);
+                pImpl->DrainInput();
+                pImpl->previous = Impl::Clock::now();
+                continue;
+            }
+            pImpl->window->PollEvents();
+            pImpl->DrainInput();
+            pImpl->Step();
+        }
+        return;
+    }
+    pImpl->stopping = false;
+    std::thread renderThread([this] { pImpl->RunRenderThread(); });
+    auto stop = [&] {
+        {
+            std::lock_guard lock(pImpl->mutex);
+            pImpl->stopping = true;
+        }
+        pImpl->signal.notify_one();
+        renderThread.join();
+    };
+    try {
+        while (!pImpl->quit && !pImpl->window->ShouldClose()) {
+            Job::RunMainThread();
+            pImpl->window->WaitEvents(pImpl->options.idleTimeout);
+            pImpl->UpdateShown();
+            pImpl->Wake();
+        }
+    } catch (...) {
+        stop();
+        throw;
+    }
+    stop();
+    if (pImpl->error) std::rethrow_exception(std::exchange(pImpl->error, nullptr));
+}
+
+} // namespace Starlight::Core
@@ -0,0 +1,207 @@
+/**
+ * @file
+ * @brief
+ * Run the main loop of the application.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_APPLICATION_HPP
+#define STARLIGHT_CORE_APPLICATION_HPP
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include "profiler.hpp"
+#include "window.hpp"
+
+namespace Starlight::Core {
+
+/**
+ * @brief A structure to hold the options of the main loop.
+ *
+ * Every member has a default value, so only the options of interest need to be set.
+ */
+struct ApplicationOptions final {
+    double      fixedStep    = 0.0;  ///< The period of the fixed update in seconds, or 0 to update once per frame with the elapsed time.
+    std::size_t maxSteps     = 8;    ///< The maximum number of fixed updates per frame, beyond which the backlog is dropped.
+    double      idleTimeout  = 0.25; ///< The maximum time in seconds to sleep for events while idle.
+    bool        continuous   = true; ///< Whether to render every frame while the window is shown, or only when requested.
+    bool        renderThread = true; ///< Whether to update and render on a thread of their own, so the main thread only handles the window events.
+};
+
+/**
+ * @brief Run the main loop of the application.
+ *
+ * This class drives the updates and the rendering of the application from the window events.
+ * While the window is shown, the loop renders back to back without sleeping,
+ * so the frame rate is paced by the presentation of the swapchain that the render callback presents to.
+ * While the window is hidden or iconified, or nothing needs to be rendered, the loop sleeps until an event arrives,
+ * so an idle application does not burn the battery.
+ * Jobs pinned to the main thread are run once per iteration.
+ *
+ * If a fixed step is set, the update callback is called with the fixed step as many times as the elapsed time requires,
+ * and the render callback receives the fraction of the step that has elapsed since the last update, to interpolate the state.
+ * Otherwise the update callback is called once per frame with the elapsed time, and the render callback receives 1.
+ * The time spent sleeping while idle is not simulated.
+ *
+ * By default the updates and the rendering run on a thread of their own, and the main thread only handles the window events,
+ * so the input is received on time however long a frame takes.
+ * Before each update, the input events received since the previous update are passed to the input callback in the order they arrived,
+ * and their timestamps tell when each of them happened.
+ * The callbacks must not call the methods of the window that must be called on the main thread; submit them with Job::SubmitMain instead.
+ *
+ * Example:
+ * @code{.cpp}
+ * auto window = Starlight::Core::CreateSharedWindow("My Window", 1280, 720, true);
+ * Starlight::Core::Device device(window);
+ * Starlight::Core::Application application(window, { .fixedStep = 1.0 / 60.0 });
+ * application.SetUpdateCallback([&](double delta) { world.Step(delta); });
+ * application.SetRenderCallback([&](double alpha) {
+ *     device.BeginFrame(0.0f, 0.0f, 0.0f);
+ *     world.Draw(device, alpha);
+ *     device.EndFrame();
+ * });
+ * application.Run();
+ * @endcode
+ */
+class Application final {
+public:
+    /**
+     * @brief Callback function type for updates.
+     *
+     * Signature:
+     * @code
+     * void update(double delta);
+     * @endcode
+     *
+     * @param delta The simulated time in seconds.
+     */
+    using UpdateCallback = std::function<void(double)>;
+
+    /**
+     * @brief Callback function type for rendering.
+     *
+     * Signature:
+     * @code
+     * void render(double alpha);
+     * @endcode
+     *
+     * @param alpha The fraction of the fixed step elapsed since the last update, between 0 and 1.
+     */
+    using RenderCallback = std::function<void(double)>;
+
+    /**
+     * @brief Callback function type for input events.
+     *
+     * Signature:
+     * @code
+     * void input(const Starlight::Core::InputEvent& event);
+     * @endcode
+     *
+     * @param event The input event.
+     */
+    using InputCallback = std::function<void(const InputEvent&)>;
+
+    /**
+     * @brief Construct a new Application object.
+     *
+     * @param window The window to take the events from.
+     */
+    Application(SharedWindow window);
+
+    /**
+     * @brief Construct a new Application object.
+     *
+     * @param window  The window to take the events from.
+     * @param options The options of the main loop.
+     */
+    Application(SharedWindow window, const ApplicationOptions& options);
+
+    /**
+     * @brief Destruct the Application object.
+     */
+    ~Application();
+
+    /**
+     * @brief Set the update callback function.
+     *
+     * @param update The update callback function.
+     */
+    void SetUpdateCallback(const UpdateCallback& update);
+
+    /**
+     * @brief Set the render callback function.
+     *
+     * @param render The render callback function.
+     */
+    void SetRenderCallback(const RenderCallback& render);
+
+    /**
+     * @brief Set the input callback function.
+     *
+     * @param input The input callback function, which is called on the thread that updates.
+     */
+    void SetInputCallback(const InputCallback& input);
+
+    /**
+     * @brief Request a frame to be rendered.
+     *
+     * If the loop is not continuous, it renders one frame after this call.
+     * This method may be called from any thread.
+     */
+    void RequestRedraw(void);
+
+    /**
+     * @brief Request the main loop to stop.
+     *
+     * The main loop returns after the current iteration.
+     * This method may be called from any thread.
+     */
+    void Quit(void);
+
+    /**
+     * @brief Get the percentiles of the recent frame times.
+     *
+     * The frame time is the time between the starts of consecutive iterations that render,
+     * over a rolling window of the last 600 frames. The time spent sleeping while idle is not counted.
+     * This method may be called from any thread.
+     *
+     * @return The statistics of the frame times.
+     */
+    FrameTimeStats GetFrameTimeStats(void) const;
+
+    /**
+     * @brief Run the main loop.
+     *
+     * This method returns when the window should close or Quit is called.
+     * It must be called on the main thread.
+     * If a callback throws an exception on the render thread, the loop stops and the exception is rethrown.
+     */
+    void Run(void);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_APPLICATION_HPP
@@ -0,0 +1,161 @@
+/**
+ * @file
+ * @brief
+ * Create the Vulkan instance and choose the GPU.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <GLFW/glfw3.h>
+#include "bootstrap.hpp"
+#include "config.hpp"
+#include "version.hpp"
+
+namespace Starlight::Core {
+
+static const char** GetRequiredInstanceLyrs(std::uint32_t* count, bool headless) {
+#ifdef DEBUG
+    static const char* layers[1];
+    for (const auto& property : vk::enumerateInstanceLayerProperties()) {
+        if (std::strcmp("VK_LAYER_KHRONOS_validation", property.layerName) == 0) {
+            layers[0] = "VK_LAYER_KHRONOS_validation";
+            if (count) *count = 1;
+            return layers;
+        }
+    }
+#endif
+    if (count) *count = 0;
+    return nullptr;
+}
+
+static const char** GetRequiredInstanceExts(std::uint32_t* count, bool headless) {
+    if (!headless) {
+        auto extensions = glfwGetRequiredInstanceExtensions(count);
+        if (extensions) return extensions;
+        const char* description;
+        glfwGetError(&description);
+        throw std::runtime_error(description);
+    }
+    if (count) *count = 0;
+    return nullptr;
+}
+
+vk::UniqueInstance CreateInstance(bool headless) {
+    auto requiredLyrCount = static_cast<std::uint32_t>(0);
+    auto requiredLyrNames = GetRequiredInstanceLyrs(&requiredLyrCount, headless);
+    auto requiredExtCount = static_cast<std::uint32_t>(0);
+    auto requiredExtNames = GetRequiredInstanceExts(&requiredExtCount, headless);
+    std::span lyrNames(requiredLyrNames, requiredLyrCount);
+    std::span extNames(requiredExtNames, requiredExtCount);
+    const auto& appSnap = Config::GetAppInfo();
+    auto sysName = Version::Name;
+    auto appVer = VK_MAKE_VERSION(appSnap.major, appSnap.minor, appSnap.patch);
+    auto sysVer = VK_MAKE_VERSION(Version::Major, Version::Minor, Version::Patch);
+    vk::ApplicationInfo    appInfo(appSnap.name.c_str(), appVer, sysName, sysVer, VK_API_VERSION_1_3);
+    vk::InstanceCreateInfo insInfo(vk::InstanceCreateFlags(), &appInfo, lyrNames, extNames);
+    return vk::createInstanceUnique(insInfo);
+}
+
+bool IsSuitableDevice(vk::Instance instance, vk::PhysicalDevice device, bool headless) {
+    auto queueFamilyProperties = device.getQueueFamilyProperties();
+    vk::QueueFlags queueFlags;
+    for (const auto& queueFamilyProperty : queueFamilyProperties) {
+        queueFlags |= queueFamilyProperty.queueFlags;
+    }
+    if (device.getProperties().apiVersion < VK_API_VERSION_1_3) return false;
+    auto features = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>().get<vk::PhysicalDeviceVulkan12Features>();
+    if (!features.descriptorIndexing || !features.shaderSampledImageArrayNonUniformIndexing || !features.shaderStorageBufferArrayNonUniformIndexing) return false;
+    if (!features.descriptorBindingSampledImageUpdateAfterBind || !features.descriptorBindingStorageBufferUpdateAfterBind ||
+        !features.descriptorBindingPartiallyBound || !features.descriptorBindingUpdateUnusedWhilePending || !features.runtimeDescriptorArray) return false;
+    if (queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer)) {
+        if (headless) return true;
+        for (std::uint32_t i = 0, size = queueFamilyProperties.size(); i < size; ++i) {
+            if (queueFamilyProperties[i].queueFlags & vk::QueueFlagBits::eGraphics) {
+                if (glfwGetPhysicalDevicePresentationSupport(instance, device, i)) return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool HasDeviceExtension(vk::PhysicalDevice device, const char* name) {
+    auto extensions = device.enumerateDeviceExtensionProperties();
+    return std::ranges::any_of(extensions, [name](const vk::ExtensionProperties& extension) {
+        return std::strcmp(extension.extensionName, name) == 0;
+    });
+}
+
+GpuInfo GetGpuInfo(vk::PhysicalDevice device, std::size_t index) {
+    auto deviceProperty = device.getProperties();
+    auto memoryProperty = device.getMemoryProperties();
+    GpuInfo info;
+    info.index         = index;
+    info.name          = deviceProperty.deviceName.data();
+    info.vendorID      = deviceProperty.vendorID;
+    info.deviceID      = deviceProperty.deviceID;
+    info.deviceMemory  = 0;
+    info.driverVersion = deviceProperty.driverVersion;
+    switch (deviceProperty.deviceType) {
+    case vk::PhysicalDeviceType::eDiscreteGpu:
+        info.type = GpuType::Discrete;
+        break;
+    case vk::PhysicalDeviceType::eIntegratedGpu:
+        info.type = GpuType::Integrated;
+        break;
+    case vk::PhysicalDeviceType::eVirtualGpu:
+        info.type = GpuType::Virtual;
+        break;
+    case vk::PhysicalDeviceType::eCpu:
+        info.type = GpuType::Cpu;
+        break;
+    default:
+        info.type = GpuType::Other;
+        break;
+    }
+    for (const auto& heap : std::span(memoryProperty.memoryHeaps).first(memoryProperty.memoryHeapCount)) {
+        if (heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal) info.deviceMemory += heap.size;
+    }
+    if (HasDeviceExtension(device, VK_EXT_PCI_BUS_INFO_EXTENSION_NAME)) {
+        auto chain = device.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDevicePCIBusInfoPropertiesEXT>();
+        const auto& pci = chain.get<vk::PhysicalDevicePCIBusInfoPropertiesEXT>();
+        info.pciAddress = PciAddress{ pci.pciDomain, pci.pciBus, pci.pciDevice, pci.pciFunction };
+    }
+    return info;
+}
+
+std::uint32_t ChoosePhysicalDevice(vk::Instance instance, std::span<const vk::PhysicalDevice> devices, const GpuScorer& scorer, bool headless) {
+    auto score = scorer ? scorer : GpuScorer(DefaultGpuScore);
+    std::optional<std::pair<std::int64_t, std::uint32_t>> best;
+    for (std::uint32_t i = 0, size = devices.size(); i < size; ++i) {
+        if (!IsSuitableDevice(instance, devices[i], headless)) continue;
+        auto value = score(GetGpuInfo(devices[i], i));
+        if (value < 0 || (best && best->first >= value)) continue;
+        best.emplace(value, i);
+    }
+    if (best) return best->second;
+    throw std::runtime_error("No suitable physical device found");
+}
+
+} // namespace Starlight::Core
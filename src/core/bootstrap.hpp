@@ -0,0 +1,102 @@
+/**
+ * @file
+ * @brief
+ * Create the Vulkan instance and choose the GPU.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_BOOTSTRAP_HPP
+#define STARLIGHT_CORE_BOOTSTRAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vulkan/vulkan.hpp>
+#include "device.hpp"
+
+namespace Starlight::Core {
+
+/**
+ * @brief Create the Vulkan instance.
+ *
+ * The instance targets Vulkan 1.3 and enables the validation layer in debug builds if it is installed.
+ *
+ * @param headless Whether the instance is used without a window, so the extensions of the windowing system are not enabled.
+ *
+ * @return The instance.
+ *
+ * @throw std::runtime_error If the windowing system cannot provide its extensions.
+ */
+vk::UniqueInstance CreateInstance(bool headless);
+
+/**
+ * @brief Check if a physical device meets the requirements of the engine.
+ *
+ * The device must support Vulkan 1.3 and the descriptor indexing features of the bindless descriptor heap.
+ * Unless headless, one of its graphics queue families must be able to present.
+ *
+ * @param instance The instance.
+ * @param device   The physical device.
+ * @param headless Whether the device is used without a window.
+ *
+ * @return true if the device is suitable, false otherwise.
+ */
+bool IsSuitableDevice(vk::Instance instance, vk::PhysicalDevice device, bool headless);
+
+/**
+ * @brief Check if a physical device supports an extension.
+ *
+ * @param device The physical device.
+ * @param name   The name of the extension.
+ *
+ * @return true if the extension is supported, false otherwise.
+ */
+bool HasDeviceExtension(vk::PhysicalDevice device, const char* name);
+
+/**
+ * @brief Describe a physical device.
+ *
+ * @param device The physical device.
+ * @param index  The index of the physical device in the enumeration order.
+ *
+ * @return The description of the GPU.
+ */
+GpuInfo GetGpuInfo(vk::PhysicalDevice device, std::size_t index);
+
+/**
+ * @brief Choose the suitable physical device with the highest score.
+ *
+ * If scores tie, the device enumerated first wins.
+ *
+ * @param instance The instance.
+ * @param devices  The physical devices enumerated by the instance.
+ * @param scorer   The function to score the GPUs, or empty to use DefaultGpuScore.
+ * @param headless Whether the device is used without a window.
+ *
+ * @return The index of the chosen device.
+ *
+ * @throw std::runtime_error If no device is suitable or the scorer rejects all of them.
+ */
+std::uint32_t ChoosePhysicalDevice(vk::Instance instance, std::span<const vk::PhysicalDevice> devices, const GpuScorer& scorer, bool headless);
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_BOOTSTRAP_HPP
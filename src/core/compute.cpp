@@ -0,0 +1,362 @@
+/**
+ * @file
+ * @brief
+ * Manage a compute-only GPU device for batch workloads.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include "allocator.hpp"
+#include "bootstrap.hpp"
+#include "compute.hpp"
+#include "deletion.hpp"
+#include "descriptor.hpp"
+#include "pipeline.hpp"
+#include "registry.hpp"
+#include "shader.hpp"
+#include "sync.hpp"
+
+namespace Starlight::Core {
+
+static_assert(ComputeDevice::PushConstantSize == DescriptorHeap::PushConstantSize);
+
+static std::pair<std::uint32_t, std::uint32_t> ChooseComputeFamily(vk::PhysicalDevice device) {
+    auto queueFamilyProperties = device.getQueueFamilyProperties();
+    std::optional<std::pair<std::uint32_t, std::uint32_t>> best;
+    bool bestDedicated = false;
+    for (std::uint32_t i = 0, size = queueFamilyProperties.size(); i < size; ++i) {
+        const auto& property = queueFamilyProperties[i];
+        if (!(property.queueFlags & vk::QueueFlagBits::eCompute) || !property.queueCount) continue;
+        auto dedicated = !(property.queueFlags & vk::QueueFlagBits::eGraphics);
+        if (best && (bestDedicated > dedicated || (bestDedicated == dedicated && best->second >= property.queueCount))) continue;
+        best.emplace(i, property.queueCount);
+        bestDedicated = dedicated;
+    }
+    if (best) return *best;
+    throw std::runtime_error("No suitable compute queue family found");
+}
+
+static MemoryUsage ToMemoryUsage(ComputeMemory memory) {
+    switch (memory) {
+    case ComputeMemory::Upload:
+        return MemoryUsage::CpuToGpu;
+    case ComputeMemory::Readback:
+        return MemoryUsage::GpuToCpu;
+    default:
+        return MemoryUsage::GpuOnly;
+    }
+}
+
+struct DescriptorSlot {
+    DescriptorHeap* heap;
+    std::uint32_t   index;
+    DescriptorSlot(DescriptorHeap* heap, std::uint32_t index) : heap(heap), index(index) {
+    }
+    DescriptorSlot(DescriptorSlot&& other) noexcept : heap(std::exchange(other.heap, nullptr)), index(other.index) {
+    }
+    DescriptorSlot& operator=(DescriptorSlot&&) = delete;
+    ~DescriptorSlot() {
+        if (heap) heap->Free(DescriptorKind::StorageBuffer, index, 0);
+    }
+};
+
+struct ComputeBuffer {
+    Buffer         buffer;
+    DescriptorSlot descriptor;
+    std::size_t    size;
+};
+
+struct ComputeLane {
+    struct Batch {
+        vk::UniqueCommandBuffer  commandBuffer;
+        std::uint64_t            value;
+    };
+    Queue                        queue;
+    Timeline                     timeline;
+    vk::UniqueCommandPool        commandPool;
+    std::deque<Batch>            batches;
+    std::vector<Submission>      pending;
+    std::atomic<std::uint64_t>   submitted;
+    std::mutex                   mutex;
+    ComputeLane(vk::Device device, std::uint32_t family, std::uint32_t index) :
+    queue(device.getQueue(family, index), std::make_shared<std::mutex>()), timeline(device), submitted(0) {
+        using enum vk::CommandPoolCreateFlagBits;
+        commandPool = device.createCommandPoolUnique(vk::CommandPoolCreateInfo(eResetCommandBuffer | eTransient, family));
+    }
+    vk::UniqueCommandBuffer Acquire(vk::Device device) {
+        if (!batches.empty() && timeline.IsComplete(batches.front().value)) {
+            auto commandBuffer = std::move(batches.front().commandBuffer);
+            batches.pop_front();
+            return commandBuffer;
+        }
+        vk::CommandBufferAllocateInfo info(*commandPool, vk::CommandBufferLevel::ePrimary, 1);
+        return std::move(device.allocateCommandBuffersUnique(info).front());
+    }
+    void Flush(void) {
+        if (pending.empty()) return;
+        queue.Submit(pending);
+        pending.clear();
+        submitted = timeline.GetPending().value;
+    }
+};
+
+struct ComputeDevice::Impl {
+    vk::UniqueInstance                   instance;
+    vk::PhysicalDevice                   phyDevice;
+    std::uint32_t                        phyIndex;
+    vk::UniqueDevice                     device;
+    std::unique_ptr<Allocator>           allocator;
+    std::unique_ptr<PipelineCache>       pipelineCache;
+    std::unique_ptr<DescriptorHeap>      descriptors;
+    std::unique_ptr<ShaderCache>         shaders;
+    std::vector<std::unique_ptr<ComputeLane>> lanes;
+    std::unique_ptr<DeletionQueue>       deletions;
+    std::shared_mutex                    mutex;
+    Registry<ComputeBuffer>              buffers;
+    Registry<vk::UniquePipeline>         kernels;
+    std::atomic<std::size_t>             nextLane;
+    std::size_t                          batchSize;
+    Impl(const ComputeDeviceOptions& options) : nextLane(0), batchSize(std::max<std::size_t>(options.batchSize, 1)) {
+        instance     = CreateInstance(true);
+        auto devices = instance->enumeratePhysicalDevices();
+        phyIndex     = ChoosePhysicalDevice(*instance, devices, options.gpuScorer, true);
+        phyDevice    = devices[phyIndex];
+        auto [family, queueCount] = ChooseComputeFamily(phyDevice);
+        if (options.queueCount) queueCount = static_cast<std::uint32_t>(std::min<std::size_t>(options.queueCount, queueCount));
+        device        = CreateLogicalDevice(family, queueCount);
+        allocator     = std::make_unique<Allocator>(phyDevice, *device);
+        pipelineCache = std::make_unique<PipelineCache>(phyDevice, *device, options.cacheDirectory);
+        descriptors   = std::make_unique<DescriptorHeap>(phyDevice, *device);
+        shaders       = std::make_unique<ShaderCache>(*device);
+        std::vector<const Timeline*> timelines;
+        for (std::uint32_t i = 0; i < queueCount; ++i) {
+            timelines.push_back(&lanes.emplace_back(std::make_unique<ComputeLane>(*device, family, i))->timeline);
+        }
+        deletions = std::make_unique<DeletionQueue>(std::move(timelines));
+    }
+    ~Impl() {
+        if (!device) return;
+        for (auto& lane : lanes) {
+            try {
+                lane->Flush();
+            } catch (const std::exception&) {
+            }
+        }
+        device->waitIdle();
+    }
+    vk::UniqueDevice CreateLogicalDevice(std::uint32_t family, std::uint32_t queueCount) {
+        std::vector<float> queuePriorities(queueCount, 1.0f);
+        vk::DeviceQueueCreateInfo queueInfo(vk::DeviceQueueCreateFlags(), family, queuePriorities);
+        vk::DeviceCreateInfo info(vk::DeviceCreateFlags(), queueInfo);
+        vk::PhysicalDeviceVulkan12Features features12;
+        features12.timelineSemaphore                             = VK_TRUE;
+        features12.descriptorIndexing                            = VK_TRUE;
+        features12.shaderSampledImageArrayNonUniformIndexing     = VK_TRUE;
+        features12.shaderStorageBufferArrayNonUniformIndexing    = VK_TRUE;
+        features12.descriptorBindingSampledImageUpdateAfterBind  = VK_TRUE;
+        features12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        features12.descriptorBindingUpdateUnusedWhilePending     = VK_TRUE;
+        features12.descriptorBindingPartiallyBound               = VK_TRUE;
+        features12.runtimeDescriptorArray                        = VK_TRUE;
+        vk::PhysicalDeviceVulkan13Features features13;
+        features13.synchronization2 = VK_TRUE;
+        vk::StructureChain<vk::DeviceCreateInfo, vk::PhysicalDeviceVulkan12Features, vk::PhysicalDeviceVulkan13Features> chain(info, features12, features13);
+        return phyDevice.createDeviceUnique(chain.get<vk::DeviceCreateInfo>());
+    }
+    KernelHandle AddKernel(vk::ShaderModule module) {
+        vk::PipelineShaderStageCreateInfo stage(vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eCompute, module, "main");
+        vk::ComputePipelineCreateInfo info(vk::PipelineCreateFlags(), stage, descriptors->GetPipelineLayout());
+        auto pipeline = device->createComputePipelineUnique(pipelineCache->Get(), info).value;
+        std::unique_lock lock(mutex);
+        return static_cast<KernelHandle>(kernels.Add(std::move(pipeline)));
+    }
+    ComputeLane& GetLane(const ComputeToken& token) {
+        if (token.queue >= lanes.size() || token.value > lanes[token.queue]->timeline.GetPending().value) throw std::runtime_error("Invalid compute token");
+        return *lanes[token.queue];
+    }
+    void Flush(ComputeLane& lane, std::uint64_t value) {
+        if (lane.submitted >= value) return;
+        std::lock_guard lock(lane.mutex);
+        lane.Flush();
+    }
+    void Collect(void) {
+        if (deletions->Collect()) descriptors->Collect(0);
+    }
+    void Record(vk::CommandBuffer commandBuffer, std::span<const ComputeDispatch> dispatches) {
+        using Stage  = vk::PipelineStageFlagBits2;
+        using Access = vk::AccessFlagBits2;
+        auto layout = descriptors->GetPipelineLayout();
+        commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+        descriptors->Bind(commandBuffer, vk::PipelineBindPoint::eCompute);
+        vk::Pipeline bound;
+        for (const auto& dispatch : dispatches) {
+            if (dispatch.barrier) {
+                vk::MemoryBarrier2 barrier(Stage::eComputeShader, Access::eShaderStorageWrite, Stage::eComputeShader, Access::eShaderStorageRead | Access::eShaderStorageWrite);
+                commandBuffer.pipelineBarrier2(vk::DependencyInfo().setMemoryBarriers(barrier));
+            }
+            auto pipeline = *kernels.Get(std::to_underlying(dispatch.kernel));
+            if (pipeline != bound) commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+            bound = pipeline;
+            std::array<std::byte, PushConstantSize> constants{};
+            std::size_t size = 0;
+            for (auto buffer : dispatch.buffers) {
+                auto index = buffers.Get(std::to_underlying(buffer)).descriptor.index;
+                std::memcpy(constants.data() + size, &index, sizeof(index));
+                size += sizeof(index);
+            }
+            if (!dispatch.constants.empty()) std::memcpy(constants.data() + size, dispatch.constants.data(), dispatch.constants.size());
+            size = (size + dispatch.constants.size() + 3) & ~std::size_t(3);
+            if (size) commandBuffer.pushConstants(layout, vk::ShaderStageFlagBits::eAll, 0, static_cast<std::uint32_t>(size), constants.data());
+            commandBuffer.dispatch(dispatch.groupCountX, dispatch.groupCountY, dispatch.groupCountZ);
+        }
+        vk::MemoryBarrier2 barrier(Stage::eComputeShader, Access::eShaderStorageWrite, Stage::eHost, Access::eHostRead);
+        commandBuffer.pipelineBarrier2(vk::DependencyInfo().setMemoryBarriers(barrier));
+        commandBuffer.end();
+    }
+};
+
+ComputeDevice::ComputeDevice(void) :
+ComputeDevice(ComputeDeviceOptions()) {
+}
+
+ComputeDevice::ComputeDevice(const ComputeDeviceOptions& options) :
+pImpl(std::make_unique<Impl>(options)) {
+}
+
+ComputeDevice::~ComputeDevice() {
+}
+
+GpuInfo ComputeDevice::GetGpuInfo(void) {
+    return Core::GetGpuInfo(pImpl->phyDevice, pImpl->phyIndex);
+}
+
+std::size_t ComputeDevice::GetQueueCount(void) {
+    return pImpl->lanes.size();
+}
+
+KernelHandle ComputeDevice::CreateKernel(const std::filesystem::path& path) {
+    return pImpl->AddKernel(pImpl->shaders->Load(path));
+}
+
+KernelHandle ComputeDevice::CreateKernel(std::span<const std::uint32_t> code) {
+    return pImpl->AddKernel(pImpl->shaders->Load(code));
+}
+
+void ComputeDevice::DestroyKernel(KernelHandle kernel) {
+    std::unique_lock lock(pImpl->mutex);
+    pImpl->deletions->Push(std::move(pImpl->kernels.Get(std::to_underlying(kernel))));
+    pImpl->kernels.Remove(std::to_underlying(kernel));
+}
+
+BufferHandle ComputeDevice::CreateBuffer(std::size_t size, ComputeMemory memory) {
+    using enum vk::BufferUsageFlagBits;
+    vk::BufferCreateInfo info(vk::BufferCreateFlags(), size, eStorageBuffer | eTransferSrc | eTransferDst);
+    auto buffer = pImpl->allocator->CreateBuffer(info, ToMemoryUsage(memory));
+    DescriptorSlot descriptor(pImpl->descriptors.get(), pImpl->descriptors->AddBuffer(*buffer.buffer, 0, VK_WHOLE_SIZE));
+    std::unique_lock lock(pImpl->mutex);
+    return static_cast<BufferHandle>(pImpl->buffers.Add({ std::move(buffer), std::move(descriptor), size }));
+}
+
+void ComputeDevice::DestroyBuffer(BufferHandle buffer) {
+    std::unique_lock lock(pImpl->mutex);
+    pImpl->deletions->Push(std::move(pImpl->buffers.Get(std::to_underlying(buffer))));
+    pImpl->buffers.Remove(std::to_underlying(buffer));
+}
+
+std::span<std::byte> ComputeDevice::MapBuffer(BufferHandle buffer) {
+    std::shared_lock lock(pImpl->mutex);
+    auto& target = pImpl->buffers.Get(std::to_underlying(buffer));
+    auto  mapped = target.buffer.allocation.GetMapped();
+    if (!mapped) throw std::runtime_error("The buffer is not host visible");
+    return std::span(static_cast<std::byte*>(mapped), target.size);
+}
+
+std::uint32_t ComputeDevice::GetBindlessIndex(BufferHandle buffer) {
+    std::shared_lock lock(pImpl->mutex);
+    return pImpl->buffers.Get(std::to_underlying(buffer)).descriptor.index;
+}
+
+ComputeToken ComputeDevice::Submit(std::span<const ComputeDispatch> dispatches, std::span<const ComputeToken> waits) {
+    pImpl->Collect();
+    std::shared_lock resources(pImpl->mutex);
+    for (const auto& dispatch : dispatches) {
+        pImpl->kernels.Get(std::to_underlying(dispatch.kernel));
+        for (auto buffer : dispatch.buffers) pImpl->buffers.Get(std::to_underlying(buffer));
+        if (dispatch.buffers.size() * sizeof(std::uint32_t) + dispatch.constants.size() > PushConstantSize) {
+            throw std::runtime_error("The bindings and constants of a dispatch exceed the push constants");
+        }
+    }
+    auto index = static_cast<std::uint32_t>(pImpl->nextLane++ % pImpl->lanes.size());
+    auto& lane = *pImpl->lanes[index];
+    Submission submission;
+    for (const auto& wait : waits) {
+        auto& waited = pImpl->GetLane(wait);
+        if (&waited != &lane) pImpl->Flush(waited, wait.value);
+        submission.Wait({ waited.timeline.GetSemaphore(), wait.value }, vk::PipelineStageFlagBits2::eComputeShader);
+    }
+    std::lock_guard lock(lane.mutex);
+    auto commandBuffer = lane.Acquire(*pImpl->device);
+    pImpl->Record(*commandBuffer, dispatches);
+    auto point = lane.timeline.Next();
+    submission.Execute(*commandBuffer);
+    submission.Signal(point);
+    lane.pending.push_back(std::move(submission));
+    lane.batches.push_back({ std::move(commandBuffer), point.value });
+    if (lane.pending.size() >= pImpl->batchSize) lane.Flush();
+    return { index, point.value };
+}
+
+void ComputeDevice::Flush(void) {
+    for (auto& lane : pImpl->lanes) {
+        std::lock_guard lock(lane->mutex);
+        lane->Flush();
+    }
+}
+
+bool ComputeDevice::IsDone(const ComputeToken& token) {
+    return pImpl->GetLane(token).timeline.IsComplete(token.value);
+}
+
+void ComputeDevice::Wait(const ComputeToken& token) {
+    auto& lane = pImpl->GetLane(token);
+    pImpl->Flush(lane, token.value);
+    lane.timeline.Wait(token.value);
+    pImpl->Collect();
+}
+
+void ComputeDevice::WaitIdle(void) {
+    Flush();
+    for (auto& lane : pImpl->lanes) lane->timeline.Wait(lane->timeline.GetPending().value);
+    pImpl->Collect();
+}
+
+} // namespace Starlight::Core
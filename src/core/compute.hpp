@@ -0,0 +1,320 @@
+/**
+ * @file
+ * @brief
+ * Manage a compute-only GPU device for batch workloads.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_COMPUTE_HPP
+#define STARLIGHT_CORE_COMPUTE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include "device.hpp"
+
+namespace Starlight::Core {
+
+/**
+ * @brief Handle of a compute kernel owned by the compute device.
+ */
+enum class KernelHandle : std::uint32_t {};
+
+/**
+ * @brief Memory of a compute buffer.
+ */
+enum class ComputeMemory {
+    Device,   ///< Device local memory that only the GPU accesses.
+    Upload,   ///< Host visible memory that the CPU writes and the GPU reads, see ComputeDevice::MapBuffer.
+    Readback, ///< Host visible and preferably cached memory that the GPU writes and the CPU reads, see ComputeDevice::MapBuffer.
+};
+
+/**
+ * @brief Completion token of a compute batch.
+ *
+ * Tokens of the same queue increase monotonically, so a batch with a smaller value completes no later than one with a larger value on that queue.
+ */
+struct ComputeToken final {
+    std::uint32_t queue; ///< The index of the queue that runs the batch.
+    std::uint64_t value; ///< The value that the timeline of the queue reaches when the batch completes.
+};
+
+/**
+ * @brief A structure to hold a dispatch of a compute kernel.
+ */
+struct ComputeDispatch final {
+    KernelHandle                  kernel;          ///< The kernel to dispatch.
+    std::uint32_t                 groupCountX = 1; ///< The number of workgroups in the X dimension.
+    std::uint32_t                 groupCountY = 1; ///< The number of workgroups in the Y dimension.
+    std::uint32_t                 groupCountZ = 1; ///< The number of workgroups in the Z dimension.
+    std::span<const BufferHandle> buffers;         ///< The buffers to bind, whose bindless indices are pushed in order before the constants.
+    std::span<const std::byte>    constants;       ///< The constants pushed after the bindless indices of the buffers.
+    bool                          barrier = false; ///< Whether to wait for the earlier dispatches of the batch, such as when reading their output.
+};
+
+/**
+ * @brief A structure to hold the options of the compute device.
+ *
+ * Every member has a default value, so only the options of interest need to be set.
+ */
+struct ComputeDeviceOptions final {
+    std::size_t           queueCount     = 0;       ///< The maximum number of compute queues, or 0 to use every queue of the chosen family.
+    std::size_t           batchSize      = 64;      ///< The number of batches a queue collects before they are submitted together (clamped to 1 or more).
+    std::filesystem::path cacheDirectory = "cache"; ///< The directory to persist the pipeline cache in, or empty to disable persistence.
+    GpuScorer             gpuScorer;                ///< The function to score the GPUs, or empty to use DefaultGpuScore.
+};
+
+/**
+ * @brief Manage a compute-only GPU device.
+ *
+ * This class shares the instance creation and the GPU selection of Device,
+ * but creates neither a window surface nor graphics queues, command pools, render targets or frames.
+ * It takes the queues of a compute family, preferring one without graphics support, and spreads the batches over them round robin.
+ *
+ * Kernels use the bindless descriptor layout of Device, so binding buffers never updates a descriptor set.
+ * The push constants of a dispatch begin with the bindless indices of its buffers, which index the array at `set = 0, binding = 1`,
+ * followed by its constants, all in at most 128 bytes:
+ *
+ * @code{.glsl}
+ * layout(set = 0, binding = 1) buffer Data { float values[]; } buffers[];
+ * layout(push_constant) uniform Bindings {
+ *     uint source;
+ *     uint target;
+ *     uint count;
+ * };
+ * @endcode
+ *
+ * A batch of dispatches is recorded into one command buffer, and the batches of a queue are collected and submitted together
+ * with a single `vkQueueSubmit2` once there are `batchSize` of them, on Flush, or when a batch among them is awaited.
+ * Each batch signals the timeline of its queue, and the value is returned as its token.
+ * The dispatches of a batch may overlap unless they ask for a barrier, and batches are unordered unless one waits for the token of another.
+ * The writes of a batch are visible to the host once its token has completed.
+ *
+ * All methods are thread safe, so batches may be submitted from many threads at once.
+ *
+ * Example:
+ * @code{.cpp}
+ * Starlight::Core::ComputeDevice device({ .cacheDirectory = {} });
+ * auto kernel = device.CreateKernel("blur.comp.spv");
+ * auto source = device.CreateBuffer(size, Starlight::Core::ComputeMemory::Upload);
+ * auto target = device.CreateBuffer(size, Starlight::Core::ComputeMemory::Readback);
+ * std::ranges::copy(pixels, device.MapBuffer(source).begin());
+ * std::array buffers{ source, target };
+ * auto token = device.Submit(std::array{ Starlight::Core::ComputeDispatch{ .kernel = kernel, .groupCountX = groups, .buffers = buffers } });
+ * device.Wait(token);
+ * // Read the result from device.MapBuffer(target)...
+ * @endcode
+ */
+class ComputeDevice final {
+public:
+    /**
+     * @brief The maximum size of the push constants of a dispatch, including the bindless indices of its buffers.
+     */
+    static constexpr std::size_t PushConstantSize = 128;
+
+    /**
+     * @brief Construct a new ComputeDevice object with the default options.
+     *
+     * @throw std::runtime_error If the device fails to initialize.
+     */
+    ComputeDevice(void);
+
+    /**
+     * @brief Construct a new ComputeDevice object.
+     *
+     * @param options The options of the device.
+     *
+     * @throw std::runtime_error If no GPU is suitable, or the device fails to initialize.
+     */
+    explicit ComputeDevice(const ComputeDeviceOptions& options);
+
+    /**
+     * @brief Destruct the ComputeDevice object.
+     *
+     * The collected batches are submitted, and the destructor waits for the GPU to finish.
+     */
+    ~ComputeDevice();
+
+    /**
+     * @brief Get the description of the GPU of the device.
+     *
+     * @return The description of the GPU.
+     */
+    GpuInfo GetGpuInfo(void);
+
+    /**
+     * @brief Get the number of compute queues.
+     *
+     * @return The number of queues, which is also the bound of ComputeToken::queue.
+     */
+    std::size_t GetQueueCount(void);
+
+    /**
+     * @brief Create a kernel from a precompiled SPIR-V file.
+     *
+     * The entry point of the shader is `main`, and it must use the bindless layout described in the class.
+     *
+     * @param path The path of the SPIR-V file, such as one compiled by the build from the `shaders` directory.
+     *
+     * @return The handle of the kernel.
+     *
+     * @throw std::runtime_error If the file cannot be mapped or is not SPIR-V, or the pipeline fails to create.
+     */
+    KernelHandle CreateKernel(const std::filesystem::path& path);
+
+    /**
+     * @brief Create a kernel from SPIR-V code.
+     *
+     * @param code The SPIR-V code of the compute shader.
+     *
+     * @return The handle of the kernel.
+     *
+     * @throw std::runtime_error If the code is not SPIR-V, or the pipeline fails to create.
+     */
+    KernelHandle CreateKernel(std::span<const std::uint32_t> code);
+
+    /**
+     * @brief Destroy a kernel.
+     *
+     * The kernel is destroyed once the batches submitted so far have completed, and this method does not wait.
+     *
+     * @param kernel The handle of the kernel.
+     *
+     * @throw std::runtime_error If the handle is invalid.
+     */
+    void DestroyKernel(KernelHandle kernel);
+
+    /**
+     * @brief Create a storage buffer.
+     *
+     * The contents of the buffer are undefined until written by the host or a kernel.
+     *
+     * @param size   The size of the buffer in bytes.
+     * @param memory The memory of the buffer.
+     *
+     * @return The handle of the buffer.
+     *
+     * @throw std::runtime_error If the buffer fails to create.
+     */
+    BufferHandle CreateBuffer(std::size_t size, ComputeMemory memory = ComputeMemory::Device);
+
+    /**
+     * @brief Destroy a buffer.
+     *
+     * The buffer is destroyed once the batches submitted so far have completed, and this method does not wait.
+     *
+     * @param buffer The handle of the buffer.
+     *
+     * @throw std::runtime_error If the handle is invalid.
+     */
+    void DestroyBuffer(BufferHandle buffer);
+
+    /**
+     * @brief Get the host memory of a buffer.
+     *
+     * Host visible buffers are persistently mapped and coherent, so the memory can be written before a batch is submitted
+     * and read after the token of a batch that wrote it has completed.
+     *
+     * @param buffer The handle of the buffer.
+     *
+     * @return The memory of the buffer, which stays valid until the buffer is destroyed.
+     *
+     * @throw std::runtime_error If the handle is invalid or the buffer is in device local memory.
+     */
+    std::span<std::byte> MapBuffer(BufferHandle buffer);
+
+    /**
+     * @brief Get the bindless index of a buffer.
+     *
+     * This is the index pushed for the buffer when it is bound to a dispatch.
+     *
+     * @param buffer The handle of the buffer.
+     *
+     * @return The index of the buffer.
+     *
+     * @throw std::runtime_error If the handle is invalid.
+     */
+    std::uint32_t GetBindlessIndex(BufferHandle buffer);
+
+    /**
+     * @brief Submit a batch of dispatches.
+     *
+     * The dispatches are recorded into one command buffer, and the batch is collected to be submitted together with the other batches of its queue.
+     * Waiting for a token of another queue synchronizes the queues on the GPU, and the writes of the awaited batch are visible to the batch.
+     * If the awaited batch of another queue is still collected, that queue is flushed first, so a submitted batch never waits for one that is not.
+     *
+     * @param dispatches The dispatches of the batch, in order.
+     * @param waits      The tokens of the batches that must complete before the batch starts.
+     *
+     * @return The token of the batch.
+     *
+     * @throw std::runtime_error If a handle or token is invalid, or the bindings and constants of a dispatch exceed PushConstantSize.
+     */
+    ComputeToken Submit(std::span<const ComputeDispatch> dispatches, std::span<const ComputeToken> waits = {});
+
+    /**
+     * @brief Submit the collected batches of all queues.
+     *
+     * Each queue submits its batches with a single `vkQueueSubmit2`.
+     */
+    void Flush(void);
+
+    /**
+     * @brief Check if a batch has completed.
+     *
+     * A batch that has not been flushed yet never completes, see Flush.
+     *
+     * @param token The token of the batch.
+     *
+     * @return true if the batch has completed, false otherwise.
+     *
+     * @throw std::runtime_error If the token is invalid.
+     */
+    bool IsDone(const ComputeToken& token);
+
+    /**
+     * @brief Wait for a batch to complete.
+     *
+     * If the batch is still collected, the batches of its queue are flushed first.
+     *
+     * @param token The token of the batch.
+     *
+     * @throw std::runtime_error If the token is invalid or the wait fails.
+     */
+    void Wait(const ComputeToken& token);
+
+    /**
+     * @brief Wait for all batches to complete.
+     *
+     * @throw std::runtime_error If the wait fails.
+     */
+    void WaitIdle(void);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_COMPUTE_HPP
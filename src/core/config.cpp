@@ -23,8 +23,8 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  * @endparblock
  */
-#include <mutex>
-#include <shared_mutex>
+#include <atomic>
+#include <stdexcept>
 #include "config.hpp"
 #include "version.hpp"
 
@@ -34,38 +34,82 @@ static_assert(Version::Major >= 0 && Version::Major <= 0x3ff);
 static_assert(Version::Minor >= 0 && Version::Minor <= 0x3ff);
 static_assert(Version::Patch >= 0 && Version::Patch <= 0xfff);
 
-static std::shared_mutex appMutex;
-static std::string       appName  = "Starlight";
-static std::uint16_t     appMajor = Version::Major;
-static std::uint16_t     appMinor = Version::Minor;
-static std::uint16_t     appPatch = Version::Patch;
+template <typename T>
+struct Snapshot {
+    std::atomic<std::shared_ptr<const T>> value;
+    std::atomic<std::uint64_t>            generation = 1;
+    explicit Snapshot(std::shared_ptr<const T> initial) : value(std::move(initial)) {
+    }
+    const std::shared_ptr<const T>& Load(void) {
+        thread_local std::shared_ptr<const T> cached;
+        thread_local std::uint64_t            cachedGeneration = 0;
+        auto current = generation.load(std::memory_order_acquire);
+        if (current != cachedGeneration) {
+            cached           = value.load(std::memory_order_acquire);
+            cachedGeneration = current;
+        }
+        return cached;
+    }
+    void Publish(std::shared_ptr<const T> next) {
+        value.store(std::move(next), std::memory_order_release);
+        generation.fetch_add(1, std::memory_order_acq_rel);
+    }
+};
 
-std::string GetAppName(void) {
-    std::shared_lock lock(appMutex);
-    return appName;
+static Snapshot<AppInfo>& GetAppStore(void) {
+    static Snapshot<AppInfo> store(std::make_shared<const AppInfo>(AppInfo { "Starlight", Version::Major, Version::Minor, Version::Patch }));
+    return store;
+}
+
+static Snapshot<SettingsFile>& GetSettingsStore(void) {
+    static Snapshot<SettingsFile> store(nullptr);
+    return store;
+}
+
+static std::uint32_t GetVersionField(const SettingsFile& settings, SettingKey key, std::uint32_t current, std::int64_t limit) {
+    auto value = settings.GetInteger(key);
+    if (!value) return current;
+    if (*value < 0 || *value > limit) throw std::runtime_error("Invalid application version in the settings file");
+    return static_cast<std::uint32_t>(*value);
+}
+
+const AppInfo& GetAppInfo(void) {
+    return *GetAppStore().Load();
+}
+
+std::string_view GetAppName(void) {
+    return GetAppInfo().name;
 }
 
 std::uint16_t GetAppMajor(void) {
-    std::shared_lock lock(appMutex);
-    return appMajor;
+    return GetAppInfo().major;
 }
 
 std::uint16_t GetAppMinor(void) {
-    std::shared_lock lock(appMutex);
-    return appMinor;
+    return GetAppInfo().minor;
 }
 
 std::uint16_t GetAppPatch(void) {
-    std::shared_lock lock(appMutex);
-    return appPatch;
+    return GetAppInfo().patch;
 }
 
 void SetAppInfo(const AppInfo& info) {
-    std::unique_lock lock(appMutex);
-    appName  = info.name;
-    appMajor = info.major;
-    appMinor = info.minor;
-    appPatch = info.patch;
+    GetAppStore().Publish(std::make_shared<const AppInfo>(info));
+}
+
+std::shared_ptr<const SettingsFile> GetSettings(void) {
+    return GetSettingsStore().Load();
+}
+
+void LoadSettings(const std::filesystem::path& path) {
+    auto settings = std::make_shared<const SettingsFile>(path);
+    AppInfo info  = GetAppInfo();
+    if (auto name = settings->GetString("app.name")) info.name = *name;
+    info.major = GetVersionField(*settings, "app.major", info.major, 0x3ff);
+    info.minor = GetVersionField(*settings, "app.minor", info.minor, 0x3ff);
+    info.patch = GetVersionField(*settings, "app.patch", info.patch, 0xfff);
+    GetSettingsStore().Publish(std::move(settings));
+    SetAppInfo(info);
 }
 
 } // namespace Starlight::Core::Config
@@ -27,7 +27,11 @@
 #define STARLIGHT_CORE_CONFIG_HPP
 
 #include <cstdint>
+#include <filesystem>
+#include <memory>
 #include <string>
+#include <string_view>
+#include "settings.hpp"
 
 namespace Starlight::Core::Config {
 
@@ -46,14 +50,29 @@ struct AppInfo final {
     std::uint32_t patch : 12; ///< The patch version number of the application.
 };
 
+/**
+ * @brief Get a snapshot of the application information.
+ *
+ * This function returns the application information published by the latest SetAppInfo without taking a lock,
+ * so all fields of the snapshot are consistent even if SetAppInfo races with the caller.
+ * Each thread caches the snapshot and only reloads it after SetAppInfo publishes a new one,
+ * so calling it every frame from every worker thread neither contends nor copies.
+ * The snapshot is immutable and stays valid until the calling thread reloads it, that is, until its next call after a SetAppInfo.
+ * Copy the structure to keep it longer.
+ *
+ * @return The snapshot of the application information.
+ */
+const AppInfo& GetAppInfo(void);
+
 /**
  * @brief Get the name of the application.
  *
- * This function returns the name of the application.
+ * This function returns the name of the application from the snapshot of the calling thread, without copying it.
+ * Use GetAppInfo to read several fields from the same snapshot.
  *
- * @return The name of the application.
+ * @return The name of the application, which stays valid as long as the snapshot returned by GetAppInfo.
  */
-std::string GetAppName(void);
+std::string_view GetAppName(void);
 
 /**
  * @brief Get the major version number of the application.
@@ -88,12 +107,36 @@ std::uint16_t GetAppPatch(void);
 /**
  * @brief Set the application information.
  *
- * This function sets the application information to the given AppInfo structure.
+ * This function publishes a copy of the given AppInfo structure as a new snapshot.
+ * The snapshots that readers already hold are not modified.
  *
  * @param info The AppInfo structure containing the application information to be set.
  */
 void SetAppInfo(const AppInfo& info);
 
+/**
+ * @brief Get a snapshot of the loaded settings file.
+ *
+ * Like GetAppInfo, this function does not take a lock and each thread caches the snapshot until LoadSettings publishes a new one.
+ * The strings returned by the snapshot stay valid as long as it is held.
+ *
+ * @return The snapshot of the settings file, or nullptr if no settings file has been loaded.
+ */
+std::shared_ptr<const SettingsFile> GetSettings(void);
+
+/**
+ * @brief Load a settings file.
+ *
+ * This function maps the settings file compiled by `starlight-settings` and publishes it as a new snapshot.
+ * The application information is taken from the `app.name`, `app.major`, `app.minor` and `app.patch` settings,
+ * and the fields that the file does not set keep their current values.
+ *
+ * @param path The path of the settings file.
+ *
+ * @throw std::runtime_error If the file is invalid or the application version is out of range.
+ */
+void LoadSettings(const std::filesystem::path& path);
+
 } // namespace Starlight::Core::Config
 
 #endif // STARLIGHT_CORE_CONFIG_HPP
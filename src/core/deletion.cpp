@@ -0,0 +1,89 @@
+/**
+ * @file
+ * @brief
+ * Destroy the GPU objects once the GPU has finished using them.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include "deletion.hpp"
+
+namespace Starlight::Core {
+
+struct DeletionQueue::Impl {
+    struct Entry {
+        std::vector<std::uint64_t> values;
+        Holder                     object;
+    };
+    std::vector<const Timeline*>   timelines;
+    mutable std::mutex             mutex;
+    std::deque<Entry>              entries;
+};
+
+DeletionQueue::DeletionQueue(std::vector<const Timeline*> timelines) :
+pImpl(std::make_unique<Impl>()) {
+    pImpl->timelines = std::move(timelines);
+}
+
+DeletionQueue::~DeletionQueue() {
+    while (!pImpl->entries.empty()) pImpl->entries.pop_front();
+}
+
+void DeletionQueue::Enqueue(Holder object, std::span<const std::uint64_t> values) {
+    std::vector<std::uint64_t> retireValues(values.begin(), values.end());
+    if (values.empty()) {
+        for (const auto* timeline : pImpl->timelines) retireValues.push_back(timeline->GetPending().value);
+    } else if (values.size() != pImpl->timelines.size()) {
+        throw std::runtime_error("The retire values do not match the timelines");
+    }
+    std::lock_guard lock(pImpl->mutex);
+    pImpl->entries.push_back({ std::move(retireValues), std::move(object) });
+}
+
+std::size_t DeletionQueue::Collect(void) {
+    std::vector<Holder> retired;
+    {
+        std::lock_guard lock(pImpl->mutex);
+        if (pImpl->entries.empty()) return 0;
+        std::vector<std::uint64_t> completed;
+        completed.reserve(pImpl->timelines.size());
+        for (const auto* timeline : pImpl->timelines) completed.push_back(timeline->GetCompleted());
+        while (!pImpl->entries.empty()) {
+            const auto& values = pImpl->entries.front().values;
+            bool ready = true;
+            for (std::size_t i = 0; i < values.size() && ready; ++i) ready = values[i] <= completed[i];
+            if (!ready) break;
+            retired.push_back(std::move(pImpl->entries.front().object));
+            pImpl->entries.pop_front();
+        }
+    }
+    for (auto& object : retired) object.reset();
+    return retired.size();
+}
+
+std::size_t DeletionQueue::GetSize(void) const {
+    std::lock_guard lock(pImpl->mutex);
+    return pImpl->entries.size();
+}
+
+} // namespace Starlight::Core
@@ -0,0 +1,122 @@
+/**
+ * @file
+ * @brief
+ * Destroy the GPU objects once the GPU has finished using them.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_DELETION_HPP
+#define STARLIGHT_CORE_DELETION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "sync.hpp"
+
+namespace Starlight::Core {
+
+/**
+ * @brief Defer the destruction of objects until the GPU work submitted before them has retired.
+ *
+ * An object is moved into the queue together with the pending values of the timelines at that time,
+ * and is destroyed by Collect once all of the timelines have reached those values.
+ * Any movable object can be deferred, such as `vk::Unique*` handles, or Image and Buffer objects that return their memory to the allocator,
+ * so replacing a resource that the frames in flight still use never waits for the device to be idle.
+ * The objects are destroyed in the order they were pushed, and the remaining ones are destroyed with the queue.
+ * All methods are thread safe.
+ */
+class DeletionQueue final {
+public:
+    /**
+     * @brief Construct a new DeletionQueue object.
+     *
+     * @param timelines The timelines of the queues that may use the objects, which must outlive the queue.
+     */
+    explicit DeletionQueue(std::vector<const Timeline*> timelines);
+
+    /**
+     * @brief Destruct the DeletionQueue object.
+     *
+     * The remaining objects are destroyed without waiting, so the GPU must have finished using them.
+     */
+    ~DeletionQueue();
+
+    /**
+     * @brief Defer the destruction of an object.
+     *
+     * The object must not be used by work that has not been submitted yet.
+     *
+     * @param object The object to destroy once the work submitted so far has retired.
+     */
+    template <typename T>
+    void Push(T&& object) {
+        Enqueue(MakeHolder(std::forward<T>(object)), {});
+    }
+
+    /**
+     * @brief Defer the destruction of an object until the given values.
+     *
+     * This method is used when the object is also used by work that will be submitted later, such as the frame being recorded.
+     * An object is never destroyed before the objects pushed earlier, so the values should not decrease from one push to the next.
+     *
+     * @param object The object to destroy.
+     * @param values The values that the timelines must reach, in the order of the timelines given at the construction.
+     *
+     * @throw std::runtime_error If the number of values does not match the number of timelines.
+     */
+    template <typename T>
+    void Push(T&& object, std::span<const std::uint64_t> values) {
+        Enqueue(MakeHolder(std::forward<T>(object)), values);
+    }
+
+    /**
+     * @brief Destroy the objects whose work has retired.
+     *
+     * @return The number of objects destroyed.
+     */
+    std::size_t Collect(void);
+
+    /**
+     * @brief Get the number of objects waiting to be destroyed.
+     *
+     * @return The number of objects.
+     */
+    std::size_t GetSize(void) const;
+
+private:
+    using Holder = std::unique_ptr<void, void (*)(void*)>;
+    template <typename T>
+    static Holder MakeHolder(T&& object) {
+        using Object = std::remove_cvref_t<T>;
+        return Holder(new Object(std::forward<T>(object)), [](void* held) { delete static_cast<Object*>(held); });
+    }
+    struct Impl;
+    std::unique_ptr<Impl> pImpl;
+    void Enqueue(Holder object, std::span<const std::uint64_t> values);
+};
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_DELETION_HPP
@@ -0,0 +1,163 @@
+/**
+ * @file
+ * @brief
+ * Manage the bindless descriptors.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "descriptor.hpp"
+
+namespace Starlight::Core {
+
+struct DescriptorHeap::Impl {
+    struct Slots {
+        std::uint32_t                 capacity;
+        std::uint32_t                 next = 0;
+        std::vector<std::uint32_t>    free;
+    };
+    struct Retired {
+        std::uint64_t                 retireValue;
+        DescriptorKind                kind;
+        std::uint32_t                 index;
+    };
+    vk::Device                        device;
+    vk::UniqueDescriptorSetLayout     setLayout;
+    vk::UniquePipelineLayout          pipelineLayout;
+    vk::UniqueDescriptorPool          pool;
+    vk::DescriptorSet                 set;
+    std::mutex                        mutex;
+    std::array<Slots, 3>              slots;
+    std::deque<Retired>               retired;
+    std::uint32_t Allocate(DescriptorKind kind) {
+        auto& target = slots[std::to_underlying(kind)];
+        if (!target.free.empty()) {
+            auto index = target.free.back();
+            target.free.pop_back();
+            return index;
+        }
+        if (target.next == target.capacity) throw std::runtime_error("The descriptor heap is full");
+        return target.next++;
+    }
+    void Write(DescriptorKind kind, std::uint32_t index, vk::DescriptorType type, const vk::DescriptorImageInfo* image, const vk::DescriptorBufferInfo* buffer) {
+        vk::WriteDescriptorSet write(set, std::to_underlying(kind), index, 1, type, image, buffer);
+        device.updateDescriptorSets(write, {});
+    }
+};
+
+DescriptorHeap::DescriptorHeap(vk::PhysicalDevice phyDevice, vk::Device device, std::uint32_t capacity, std::uint32_t samplerCapacity) :
+pImpl(std::make_unique<Impl>()) {
+    auto chain  = phyDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>();
+    auto limits = chain.get<vk::PhysicalDeviceVulkan12Properties>();
+    auto allResources = limits.maxUpdateAfterBindDescriptorsInAllPools;
+    pImpl->device = device;
+    pImpl->slots[std::to_underlying(DescriptorKind::SampledImage )].capacity = std::min({ capacity, limits.maxDescriptorSetUpdateAfterBindSampledImages, limits.maxPerStageDescriptorUpdateAfterBindSampledImages, allResources / 3 });
+    pImpl->slots[std::to_underlying(DescriptorKind::StorageBuffer)].capacity = std::min({ capacity, limits.maxDescriptorSetUpdateAfterBindStorageBuffers, limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers, allResources / 3 });
+    pImpl->slots[std::to_underlying(DescriptorKind::Sampler      )].capacity = std::min({ samplerCapacity, limits.maxDescriptorSetUpdateAfterBindSamplers, limits.maxPerStageDescriptorUpdateAfterBindSamplers, allResources / 3 });
+    const std::array types{ vk::DescriptorType::eSampledImage, vk::DescriptorType::eStorageBuffer, vk::DescriptorType::eSampler };
+    std::vector<vk::DescriptorSetLayoutBinding> bindings;
+    std::vector<vk::DescriptorBindingFlags>     bindingFlags;
+    std::vector<vk::DescriptorPoolSize>         poolSizes;
+    for (std::uint32_t i = 0; i < types.size(); ++i) {
+        bindings.emplace_back(i, types[i], pImpl->slots[i].capacity, vk::ShaderStageFlagBits::eAll);
+        bindingFlags.push_back(vk::DescriptorBindingFlagBits::eUpdateAfterBind | vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending);
+        poolSizes.emplace_back(types[i], pImpl->slots[i].capacity);
+    }
+    vk::DescriptorSetLayoutBindingFlagsCreateInfo flagsInfo(bindingFlags);
+    vk::DescriptorSetLayoutCreateInfo setLayoutInfo(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool, bindings, &flagsInfo);
+    pImpl->setLayout = device.createDescriptorSetLayoutUnique(setLayoutInfo);
+    vk::PushConstantRange pushConstant(vk::ShaderStageFlagBits::eAll, 0, PushConstantSize);
+    pImpl->pipelineLayout = device.createPipelineLayoutUnique(vk::PipelineLayoutCreateInfo(vk::PipelineLayoutCreateFlags(), *pImpl->setLayout, pushConstant));
+    pImpl->pool = device.createDescriptorPoolUnique(vk::DescriptorPoolCreateInfo(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind, 1, poolSizes));
+    pImpl->set  = device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(*pImpl->pool, *pImpl->setLayout)).front();
+}
+
+DescriptorHeap::~DescriptorHeap() {
+}
+
+std::uint32_t DescriptorHeap::AddImage(vk::ImageView view, vk::ImageLayout layout) {
+    std::lock_guard lock(pImpl->mutex);
+    auto index = pImpl->Allocate(DescriptorKind::SampledImage);
+    vk::DescriptorImageInfo info(nullptr, view, layout);
+    pImpl->Write(DescriptorKind::SampledImage, index, vk::DescriptorType::eSampledImage, &info, nullptr);
+    return index;
+}
+
+std::uint32_t DescriptorHeap::AddBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range) {
+    std::lock_guard lock(pImpl->mutex);
+    auto index = pImpl->Allocate(DescriptorKind::StorageBuffer);
+    vk::DescriptorBufferInfo info(buffer, offset, range);
+    pImpl->Write(DescriptorKind::StorageBuffer, index, vk::DescriptorType::eStorageBuffer, nullptr, &info);
+    return index;
+}
+
+std::uint32_t DescriptorHeap::AddSampler(vk::Sampler sampler) {
+    std::lock_guard lock(pImpl->mutex);
+    auto index = pImpl->Allocate(DescriptorKind::Sampler);
+    vk::DescriptorImageInfo info(sampler, nullptr, vk::ImageLayout::eUndefined);
+    pImpl->Write(DescriptorKind::Sampler, index, vk::DescriptorType::eSampler, &info, nullptr);
+    return index;
+}
+
+std::uint32_t DescriptorHeap::ReserveImage(void) {
+    std::lock_guard lock(pImpl->mutex);
+    return pImpl->Allocate(DescriptorKind::SampledImage);
+}
+
+void DescriptorHeap::SetImage(std::uint32_t index, vk::ImageView view, vk::ImageLayout layout) {
+    std::lock_guard lock(pImpl->mutex);
+    vk::DescriptorImageInfo info(nullptr, view, layout);
+    pImpl->Write(DescriptorKind::SampledImage, index, vk::DescriptorType::eSampledImage, &info, nullptr);
+}
+
+void DescriptorHeap::Free(DescriptorKind kind, std::uint32_t index, std::uint64_t retireValue) {
+    std::lock_guard lock(pImpl->mutex);
+    pImpl->retired.push_back({ retireValue, kind, index });
+}
+
+void DescriptorHeap::Collect(std::uint64_t completedValue) {
+    std::lock_guard lock(pImpl->mutex);
+    while (!pImpl->retired.empty() && pImpl->retired.front().retireValue <= completedValue) {
+        const auto& front = pImpl->retired.front();
+        pImpl->slots[std::to_underlying(front.kind)].free.push_back(front.index);
+        pImpl->retired.pop_front();
+    }
+}
+
+void DescriptorHeap::Bind(vk::CommandBuffer commandBuffer, vk::PipelineBindPoint bindPoint) const {
+    commandBuffer.bindDescriptorSets(bindPoint, *pImpl->pipelineLayout, 0, pImpl->set, {});
+}
+
+vk::DescriptorSetLayout DescriptorHeap::GetSetLayout(void) const {
+    return *pImpl->setLayout;
+}
+
+vk::PipelineLayout DescriptorHeap::GetPipelineLayout(void) const {
+    return *pImpl->pipelineLayout;
+}
+
+} // namespace Starlight::Core
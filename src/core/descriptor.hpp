@@ -0,0 +1,189 @@
+/**
+ * @file
+ * @brief
+ * Manage the bindless descriptors.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_DESCRIPTOR_HPP
+#define STARLIGHT_CORE_DESCRIPTOR_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vulkan/vulkan.hpp>
+
+namespace Starlight::Core {
+
+/**
+ * @brief Kind of a bindless descriptor.
+ *
+ * The kind is also the binding of its array in the descriptor set.
+ */
+enum class DescriptorKind : std::uint32_t {
+    SampledImage  = 0, ///< A sampled image, bound at `binding = 0`.
+    StorageBuffer = 1, ///< A storage buffer, bound at `binding = 1`.
+    Sampler       = 2, ///< A sampler, bound at `binding = 2`.
+};
+
+/**
+ * @brief Manage the bindless descriptors.
+ *
+ * This class owns a single descriptor set with a large array per descriptor kind,
+ * which is created with `UPDATE_AFTER_BIND` and `PARTIALLY_BOUND`, so descriptors are written while the set is bound
+ * and the unused elements never need to be valid.
+ * Each resource gets an index into the array of its kind from a free list, and shaders index the arrays with the indices
+ * that draws pass in push constants, so the set is bound once per command buffer and never changes between draws.
+ * A freed index is recycled only after the GPU has retired the frames that may still read it.
+ * The shared pipeline layout has this set at `set = 0` and a push constant range for all stages.
+ * All methods are thread safe.
+ */
+class DescriptorHeap final {
+public:
+    /**
+     * @brief The size of the push constant range of the pipeline layout in bytes.
+     */
+    static constexpr std::uint32_t PushConstantSize = 128;
+
+    /**
+     * @brief Construct a new DescriptorHeap object.
+     *
+     * The capacities are clamped to the limits of the physical device.
+     * The logical device must enable the descriptor indexing features for update-after-bind sampled images and storage buffers,
+     * partially bound descriptors, runtime descriptor arrays and updates of unused descriptors while pending.
+     *
+     * @param phyDevice       The physical device to get the limits from.
+     * @param device          The logical device.
+     * @param capacity        The number of sampled images and of storage buffers.
+     * @param samplerCapacity The number of samplers.
+     */
+    DescriptorHeap(vk::PhysicalDevice phyDevice, vk::Device device, std::uint32_t capacity = 65536, std::uint32_t samplerCapacity = 1024);
+
+    /**
+     * @brief Destruct the DescriptorHeap object.
+     *
+     * The GPU must have finished using the descriptor set.
+     */
+    ~DescriptorHeap();
+
+    /**
+     * @brief Add a sampled image.
+     *
+     * @param view   The image view.
+     * @param layout The layout of the image when it is sampled.
+     *
+     * @return The index of the image.
+     *
+     * @throw std::runtime_error If the array is full.
+     */
+    std::uint32_t AddImage(vk::ImageView view, vk::ImageLayout layout);
+
+    /**
+     * @brief Add a storage buffer.
+     *
+     * @param buffer The buffer.
+     * @param offset The offset of the range in the buffer.
+     * @param range  The size of the range.
+     *
+     * @return The index of the buffer.
+     *
+     * @throw std::runtime_error If the array is full.
+     */
+    std::uint32_t AddBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range);
+
+    /**
+     * @brief Add a sampler.
+     *
+     * @param sampler The sampler.
+     *
+     * @return The index of the sampler.
+     *
+     * @throw std::runtime_error If the array is full.
+     */
+    std::uint32_t AddSampler(vk::Sampler sampler);
+
+    /**
+     * @brief Reserve the index of a sampled image whose view is not created yet.
+     *
+     * The descriptor must be written with SetImage before the GPU reads it.
+     *
+     * @return The index of the image.
+     *
+     * @throw std::runtime_error If the array is full.
+     */
+    std::uint32_t ReserveImage(void);
+
+    /**
+     * @brief Write a sampled image to a reserved index.
+     *
+     * @param index  The index returned by ReserveImage.
+     * @param view   The image view.
+     * @param layout The layout of the image when it is sampled.
+     */
+    void SetImage(std::uint32_t index, vk::ImageView view, vk::ImageLayout layout);
+
+    /**
+     * @brief Free an index.
+     *
+     * The index is recycled by Collect once the GPU has reached `retireValue`.
+     *
+     * @param kind        The kind of the descriptor.
+     * @param index       The index of the descriptor.
+     * @param retireValue The timeline value after which the GPU no longer reads the descriptor.
+     */
+    void Free(DescriptorKind kind, std::uint32_t index, std::uint64_t retireValue);
+
+    /**
+     * @brief Recycle the freed indices that the GPU no longer reads.
+     *
+     * @param completedValue The timeline value that the GPU has reached.
+     */
+    void Collect(std::uint64_t completedValue);
+
+    /**
+     * @brief Bind the descriptor set.
+     *
+     * @param commandBuffer The command buffer to bind the set in.
+     * @param bindPoint     The pipeline bind point.
+     */
+    void Bind(vk::CommandBuffer commandBuffer, vk::PipelineBindPoint bindPoint) const;
+
+    /**
+     * @brief Get the layout of the descriptor set.
+     *
+     * @return The descriptor set layout.
+     */
+    vk::DescriptorSetLayout GetSetLayout(void) const;
+
+    /**
+     * @brief Get the shared pipeline layout.
+     *
+     * @return The pipeline layout.
+     */
+    vk::PipelineLayout GetPipelineLayout(void) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_DESCRIPTOR_HPP
@@ -23,185 +23,515 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  * @endparblock
  */
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <ranges>
+#include <tuple>
+#include <utility>
 #include <vulkan/vulkan.hpp>
 #include <GLFW/glfw3.h>
-#include "config.hpp"
+#include "allocator.hpp"
+#include "bootstrap.hpp"
+#include "deletion.hpp"
+#include "descriptor.hpp"
 #include "device.hpp"
-#include "version.hpp"
+#include "graph.hpp"
+#include "indirect.hpp"
+#include "job.hpp"
+#include "pipeline.hpp"
+#include "recorder.hpp"
+#include "registry.hpp"
+#include "selection.hpp"
+#include "shader.hpp"
+#include "streaming.hpp"
+#include "sync.hpp"
+#include "timestamp.hpp"
+#include "upload.hpp"
 
 namespace Starlight::Core {
 
-static const char** GetRequiredInstanceLyrs(std::uint32_t* count, bool headless) {
-#ifdef DEBUG
-    static const char* layers[1];
-    for (const auto& property : vk::enumerateInstanceLayerProperties()) {
-        if (std::strcmp("VK_LAYER_KHRONOS_validation", property.layerName) == 0) {
-            layers[0] = "VK_LAYER_KHRONOS_validation";
-            if (count) *count = 1;
-            return layers;
+static std::span<const vk::PresentModeKHR> GetPresentModeCandidates(PresentPolicy policy) {
+    static constexpr std::array vsync       { vk::PresentModeKHR::eFifo };
+    static constexpr std::array mailbox     { vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eFifo };
+    static constexpr std::array immediate   { vk::PresentModeKHR::eImmediate, vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eFifoRelaxed, vk::PresentModeKHR::eFifo };
+    static constexpr std::array fifoRelaxed { vk::PresentModeKHR::eFifoRelaxed, vk::PresentModeKHR::eFifo };
+    switch (policy) {
+    case PresentPolicy::Mailbox:
+        return mailbox;
+    case PresentPolicy::Immediate:
+        return immediate;
+    case PresentPolicy::FifoRelaxed:
+        return fifoRelaxed;
+    default:
+        return vsync;
+    }
+}
+
+static PresentPolicy ToPresentPolicy(vk::PresentModeKHR mode) {
+    switch (mode) {
+    case vk::PresentModeKHR::eMailbox:
+        return PresentPolicy::Mailbox;
+    case vk::PresentModeKHR::eImmediate:
+        return PresentPolicy::Immediate;
+    case vk::PresentModeKHR::eFifoRelaxed:
+        return PresentPolicy::FifoRelaxed;
+    default:
+        return PresentPolicy::VSync;
+    }
+}
+
+static vk::BufferUsageFlags ToBufferUsage(BufferUsage usage) {
+    auto flags = static_cast<std::uint32_t>(usage);
+    vk::BufferUsageFlags result = vk::BufferUsageFlagBits::eTransferDst;
+    if (flags & static_cast<std::uint32_t>(BufferUsage::Vertex  )) result |= vk::BufferUsageFlagBits::eVertexBuffer;
+    if (flags & static_cast<std::uint32_t>(BufferUsage::Index   )) result |= vk::BufferUsageFlagBits::eIndexBuffer;
+    if (flags & static_cast<std::uint32_t>(BufferUsage::Uniform )) result |= vk::BufferUsageFlagBits::eUniformBuffer;
+    if (flags & static_cast<std::uint32_t>(BufferUsage::Storage )) result |= vk::BufferUsageFlagBits::eStorageBuffer;
+    if (flags & static_cast<std::uint32_t>(BufferUsage::Indirect)) result |= vk::BufferUsageFlagBits::eIndirectBuffer;
+    return result;
+}
+
+static vk::Format ToFormat(TextureFormat format) {
+    switch (format) {
+    case TextureFormat::R8Unorm:
+        return vk::Format::eR8Unorm;
+    case TextureFormat::RGBA8Srgb:
+        return vk::Format::eR8G8B8A8Srgb;
+    case TextureFormat::RGBA16Float:
+        return vk::Format::eR16G16B16A16Sfloat;
+    default:
+        return vk::Format::eR8G8B8A8Unorm;
+    }
+}
+
+static std::size_t GetTexelSize(TextureFormat format) {
+    switch (format) {
+    case TextureFormat::R8Unorm:
+        return 1;
+    case TextureFormat::RGBA16Float:
+        return 8;
+    default:
+        return 4;
+    }
+}
+
+static bool SupportsIndirectCount(vk::PhysicalDevice device) {
+    auto chain = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+    const auto& features = chain.get<vk::PhysicalDeviceFeatures2>().features;
+    return chain.get<vk::PhysicalDeviceVulkan12Features>().drawIndirectCount && features.multiDrawIndirect && features.drawIndirectFirstInstance;
+}
+
+static vk::Format ChooseDepthFormat(vk::PhysicalDevice device, std::uint32_t depthBits, bool stencil) {
+    struct Candidate {
+        vk::Format    format;
+        std::uint32_t bits;
+        bool          stencil;
+    };
+    static constexpr std::array candidates{
+        Candidate{ vk::Format::eD16Unorm,         16, false },
+        Candidate{ vk::Format::eX8D24UnormPack32, 24, false },
+        Candidate{ vk::Format::eD32Sfloat,        32, false },
+        Candidate{ vk::Format::eD16UnormS8Uint,   16, true  },
+        Candidate{ vk::Format::eD24UnormS8Uint,   24, true  },
+        Candidate{ vk::Format::eD32SfloatS8Uint,  32, true  },
+    };
+    for (const auto& candidate : candidates) {
+        if (candidate.bits < depthBits || candidate.stencil != stencil) continue;
+        auto features = device.getFormatProperties(candidate.format).optimalTilingFeatures;
+        if (features & vk::FormatFeatureFlagBits::eDepthStencilAttachment) return candidate.format;
+    }
+    throw std::runtime_error("No suitable depth format found");
+}
+
+struct BufferResource {
+    Buffer                       buffer;
+    std::optional<std::uint32_t> descriptor;
+    std::size_t                  size;
+};
+
+struct SamplerResource {
+    vk::UniqueSampler   sampler;
+    std::uint32_t       descriptor;
+};
+
+struct Texture {
+    Image               image;
+    vk::UniqueImageView view;
+    std::uint32_t       descriptor;
+    vk::Extent3D        extent;
+    std::uint32_t       mipLevels;
+    TextureFormat       format;
+    Device::MipSource   source;
+    std::uint32_t       residentMip = 0;
+    struct Pending {
+        Image               image;
+        vk::UniqueImageView view;
+        std::uint32_t       mipLevel;
+        std::uint64_t       token;
+    };
+    std::optional<Pending> pending;
+};
+
+static vk::Extent3D GetMipExtent(const vk::Extent3D& extent, std::uint32_t mipLevel) {
+    return vk::Extent3D(std::max(extent.width >> mipLevel, 1u), std::max(extent.height >> mipLevel, 1u), 1);
+}
+
+static QueueTopology ChooseQueueTopology(vk::Instance instance, vk::PhysicalDevice phyDevice, bool headless) {
+    using enum vk::QueueFlagBits;
+    auto queueFamilyProperties = phyDevice.getQueueFamilyProperties();
+    auto findFamily = [&](vk::QueueFlags required, vk::QueueFlags excluded, bool present) {
+        for (std::uint32_t i = 0, size = queueFamilyProperties.size(); i < size; ++i) {
+            auto flags = queueFamilyProperties[i].queueFlags;
+            if ((flags & required) != required || (flags & excluded)) continue;
+            if (present && !glfwGetPhysicalDevicePresentationSupport(instance, phyDevice, i)) continue;
+            return std::optional(i);
         }
+        return std::optional<std::uint32_t>();
+    };
+    auto familyGraphics = findFamily(eGraphics | eCompute, {}, !headless);
+    if (!familyGraphics) familyGraphics = findFamily(eGraphics, {}, !headless);
+    if (!familyGraphics) throw std::runtime_error("No suitable graphics queue family found");
+    auto familyCompute = findFamily(eCompute, eGraphics, false);
+    if (!familyCompute) familyCompute = findFamily(eCompute, {}, false);
+    if (!familyCompute) throw std::runtime_error("No suitable compute queue family found");
+    auto familyTransfer = findFamily(eTransfer, eGraphics | eCompute, false);
+    if (!familyTransfer) familyTransfer = findFamily(eTransfer, eGraphics, false);
+    if (!familyTransfer) familyTransfer = familyCompute;
+    std::vector<std::uint32_t> queueCountList(queueFamilyProperties.size());
+    auto takeQueue = [&](std::uint32_t family) {
+        if (queueCountList[family] < queueFamilyProperties[family].queueCount) return queueCountList[family]++;
+        return queueCountList[family] - 1;
+    };
+    QueueTopology topology;
+    topology.graphicsFamily    = *familyGraphics;
+    topology.computeFamily     = *familyCompute;
+    topology.transferFamily    = *familyTransfer;
+    topology.graphicsIndex     = takeQueue(topology.graphicsFamily);
+    topology.computeIndex      = takeQueue(topology.computeFamily );
+    topology.transferIndex     = takeQueue(topology.transferFamily);
+    topology.dedicatedCompute  = !(queueFamilyProperties[topology.computeFamily ].queueFlags &  eGraphics);
+    topology.dedicatedTransfer = !(queueFamilyProperties[topology.transferFamily].queueFlags & (eGraphics | eCompute));
+    auto sameQueue = [](std::uint32_t familyA, std::uint32_t indexA, std::uint32_t familyB, std::uint32_t indexB) {
+        return familyA == familyB && indexA == indexB;
+    };
+    topology.sharedCompute  = sameQueue(topology.computeFamily,  topology.computeIndex,  topology.graphicsFamily, topology.graphicsIndex);
+    topology.sharedTransfer = sameQueue(topology.transferFamily, topology.transferIndex, topology.graphicsFamily, topology.graphicsIndex) ||
+                              sameQueue(topology.transferFamily, topology.transferIndex, topology.computeFamily,  topology.computeIndex );
+    return topology;
+}
+
+struct Selection {
+    vk::UniqueInstance instance;
+    vk::PhysicalDevice phyDevice;
+    DeviceSelection    traits;
+};
+
+static Selection SelectDevice(bool headless, const DeviceOptions& options) {
+    STARLIGHT_ZONE("SelectDevice");
+    Selection selection;
+    selection.instance = CreateInstance(headless);
+    auto instance = *selection.instance;
+    auto devices  = instance.enumeratePhysicalDevices();
+    SelectionCache cache(options.gpuScorer ? std::filesystem::path() : options.cacheDirectory, devices, headless);
+    if (auto cached = cache.Load()) {
+        selection.phyDevice = devices[cached->index];
+        selection.traits    = *cached;
+        return selection;
     }
-#endif
-    if (count) *count = 0;
-    return nullptr;
+    auto index  = ChoosePhysicalDevice(instance, devices, options.gpuScorer, headless);
+    auto device = devices[index];
+    selection.phyDevice               = device;
+    selection.traits.index            = index;
+    selection.traits.topology         = ChooseQueueTopology(instance, device, headless);
+    selection.traits.deviceLocalBytes = GetGpuInfo(device, index).deviceMemory;
+    selection.traits.memoryBudget     = HasDeviceExtension(device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    selection.traits.indirectCount    = SupportsIndirectCount(device);
+    cache.Store(selection.traits);
+    return selection;
 }
 
-static const char** GetRequiredInstanceExts(std::uint32_t* count, bool headless) {
-    if (!headless) {
-        auto extensions = glfwGetRequiredInstanceExtensions(count);
-        if (extensions) return extensions;
-        const char* description;
-        glfwGetError(&description);
-        throw std::runtime_error(description);
+struct Preloaded {
+    bool                                      headless;
+    bool                                      scored;
+    std::filesystem::path                     cacheDirectory;
+    Job::Handle                               job;
+    std::shared_ptr<std::optional<Selection>> selection;
+};
+
+static std::mutex               preloadMutex;
+static std::optional<Preloaded> preloaded;
+
+static std::optional<Selection> TakePreloaded(bool headless, const DeviceOptions& options) {
+    std::optional<Preloaded> taken;
+    {
+        std::lock_guard lock(preloadMutex);
+        taken.swap(preloaded);
+    }
+    if (!taken) return std::nullopt;
+    // A scorer cannot be compared, so a preload made or taken with one is never reused
+    auto scored = static_cast<bool>(options.gpuScorer);
+    if (taken->headless != headless || taken->scored || scored || taken->cacheDirectory != options.cacheDirectory) {
+        try {
+            Job::Wait(taken->job);
+        } catch (const std::exception&) {
+        }
+        return std::nullopt;
     }
-    if (count) *count = 0;
-    return nullptr;
+    Job::Wait(taken->job);
+    return std::move(*taken->selection);
 }
 
+static constexpr vk::DeviceSize frameArenaSize = 4 << 20;
+static constexpr vk::Format     offscreenFormat = vk::Format::eR8G8B8A8Unorm;
+static constexpr std::size_t    maxTimings      = 1024;
+
 struct Device::Impl {
     SharedWindow                         window;
     vk::UniqueInstance                   instance;
     vk::PhysicalDevice                   phyDevice;
+    QueueTopology                        topology;
     vk::UniqueDevice                     lgcDevice;
-    vk::Queue                            queueGraphics;
-    vk::Queue                            queueCompute;
-    vk::Queue                            queueTransfer;
+    std::unique_ptr<Allocator>           allocator;
+    std::unique_ptr<Uploader>            uploader;
+    std::unique_ptr<PipelineCache>       pipelineCache;
+    std::unique_ptr<DescriptorHeap>      descriptors;
+    std::unique_ptr<ShaderCache>         shaders;
+    Registry<BufferResource>             buffers;
+    Registry<Texture>                    textures;
+    Registry<SamplerResource>            samplers;
+    Registry<std::unique_ptr<IndirectBatch>> indirectBatches;
+    Queue                                queueGraphics;
+    Queue                                queueCompute;
+    Queue                                queueTransfer;
+    std::unique_ptr<Timeline>            timelineGraphics;
+    std::unique_ptr<Timeline>            timelineCompute;
     vk::UniqueCommandPool                commandPoolGraphics;
     vk::UniqueCommandPool                commandPoolCompute;
     vk::UniqueCommandPool                commandPoolTransfer;
     vk::UniqueSurfaceKHR                 surface;
     vk::UniqueSwapchainKHR               swapchain;
-    vk::UniqueImage                      depthStencil;
-    vk::UniqueDeviceMemory               depthStencilMemory;
+    PresentPolicy                        presentPolicy;
+    std::size_t                          imageCount;
+    vk::PresentModeKHR                   presentMode;
+    std::vector<vk::Image>               swapchainImages;
     std::vector<vk::UniqueImageView>     colorImageViews;
-    vk::UniqueImageView                  depthImageView;
-    vk::UniqueRenderPass                 renderPass;
-    std::vector<vk::UniqueFramebuffer>   framebuffers;
-    std::vector<vk::UniqueCommandBuffer> commandBuffersGraphics;
-    std::vector<vk::UniqueCommandBuffer> commandBuffersCompute;
-    std::vector<vk::UniqueCommandBuffer> commandBuffersTransfer;
-    vk::UniqueSemaphore                  presentCompletedSemaphore;
-    vk::UniqueSemaphore                  renderCompletedSemaphore;
-    std::vector<vk::UniqueFence>         presentFences;
-    Impl(SharedWindow window) : window(window) {
-        instance  = CreateInstance();
-        phyDevice = ChoosePhysicalDevice();
-        lgcDevice = CreateLogicalDevice();
-        if (window) {
-            surface   = CreateSurface();
-            swapchain = CreateSwapchain();
-            CreateDepthStencil();
+    vk::Format                           depthFormat;
+    vk::Format                           stencilFormat;
+    struct SwapchainDesc {
+        vk::SurfaceCapabilitiesKHR       capabilities;
+        vk::SurfaceFormatKHR             format;
+        vk::Extent2D                     extent;
+        vk::Extent2D                     windowExtent;
+        std::uint32_t                    imageCount = 0;
+    };
+    SwapchainDesc                        swapchainDesc;
+    bool                                 swapchainDirty;
+    std::unique_ptr<DeletionQueue>       deletions;
+    vk::Extent2D                         offscreenExtent;
+    struct Offscreen {
+        Image                            color;
+        vk::UniqueImageView              colorView;
+        Buffer                           readback;
+        std::uint64_t                    readbackValue = 0;
+        std::optional<std::uint64_t>     frameNumber;
+    };
+    std::vector<Offscreen>               offscreens;
+    std::unique_ptr<Timeline>            timelineReadback;
+    ReadbackCallback                     readback;
+    std::uint64_t                        frameNumber;
+    struct Frame {
+        vk::UniqueCommandBuffer          commandBufferGraphics;
+        vk::UniqueCommandBuffer          commandBufferCompute;
+        vk::UniqueCommandBuffer          commandBufferTransfer;
+        vk::UniqueSemaphore              acquireSemaphore;
+        vk::UniqueSemaphore              renderSemaphore;
+        std::uint64_t                    retireValue = 0;
+        bool                             computeBegun = false;
+        std::unique_ptr<LinearArena>     arena;
+        std::optional<FrameTiming>       timing;
+    };
+    std::vector<Frame>                   frames;
+    std::size_t                          frameIndex;
+    std::uint64_t                        frameSerial;
+    std::mutex                           frameDataMutex;
+    std::unique_ptr<Recorder>            recorder;
+    std::unique_ptr<RenderGraph>         graph;
+    vk::ClearColorValue                  clearColor;
+    std::vector<vk::CommandBuffer>       secondaries;
+    struct PassImageResource {
+        GraphImage                       image;
+        bool                             depth;
+        std::optional<std::uint32_t>     descriptor;
+    };
+    std::vector<PassImageResource>       passImages;
+    std::vector<PassImage>               mainSamples;
+    TransientStats                       transientStats{};
+    bool                                 profiling;
+    std::unique_ptr<TimestampProfiler>   profiler;
+    std::deque<FrameTiming>              timings;
+    std::uint64_t                        frameCount;
+    double                               frameBegin;
+    std::optional<std::uint32_t>         frameZone;
+    bool                                 frameBegun;
+    std::optional<std::uint32_t>         imageIndex;
+    std::optional<SyncPoint>             uploadPoint;
+    bool                                 memoryBudget;
+    bool                                 indirectCount;
+    bool                                 samplerAnisotropy;
+    std::uint64_t                        deviceLocalBytes;
+    ResidencyScheduler                   scheduler;
+    std::vector<std::uint32_t>           streamingPending;
+    std::size_t                          streamingFrameBytes;
+    float                                streamingBudget;
+    StreamingStats                       streamingStats{};
+    Impl(SharedWindow window, const DeviceOptions& options) :
+    window(window), presentPolicy(options.presentPolicy), imageCount(options.imageCount), presentMode(vk::PresentModeKHR::eFifo),
+    swapchainDirty(false), offscreenExtent(std::max(options.offscreenWidth, 1u), std::max(options.offscreenHeight, 1u)), frameNumber(0),
+    frames(std::max<std::size_t>(options.framesInFlight, 1)), frameIndex(0), frameSerial(0), profiling(options.profiling),
+    frameCount(0), frameBegin(0.0), frameBegun(false), streamingFrameBytes(options.streamingFrameBytes), streamingBudget(options.streamingBudget) {
+        auto selection = TakePreloaded(!window, options);
+        if (!selection) selection = SelectDevice(!window, options);
+        instance          = std::move(selection->instance);
+        phyDevice         = selection->phyDevice;
+        topology          = selection->traits.topology;
+        memoryBudget      = selection->traits.memoryBudget;
+        indirectCount     = selection->traits.indirectCount;
+        deviceLocalBytes  = selection->traits.deviceLocalBytes;
+        samplerAnisotropy = phyDevice.getFeatures().samplerAnisotropy;
+        depthFormat       = ChooseDepthFormat(phyDevice, options.depthBits, options.stencil);
+        stencilFormat     = options.stencil ? depthFormat : vk::Format::eUndefined;
+        lgcDevice         = CreateLogicalDevice();
+        // The swapchain and the pipeline cache file take the longest, so they are created while the rest is set up.
+        auto present = window ? Job::Submit([this] {
+            STARLIGHT_ZONE("CreateSwapchain");
+            surface       = CreateSurface();
+            swapchainDesc = DescribeSwapchain();
+            swapchain     = CreateSwapchain();
             CreateImageViews();
-            CreateRenderPass();
-            CreateFramebuffers();
+        }) : Job::Handle();
+        auto pipelines = Job::Submit([this, &options] {
+            pipelineCache = std::make_unique<PipelineCache>(phyDevice, *lgcDevice, options.cacheDirectory);
+        });
+        std::exception_ptr error;
+        try {
+            allocator     = std::make_unique<Allocator>(phyDevice, *lgcDevice);
+            uploader      = CreateUploader(options.stagingSize);
+            deletions     = std::make_unique<DeletionQueue>(std::vector<const Timeline*>{ timelineGraphics.get(), timelineCompute.get(), &uploader->GetTimeline() });
+            descriptors   = std::make_unique<DescriptorHeap>(phyDevice, *lgcDevice);
+            shaders       = std::make_unique<ShaderCache>(*lgcDevice);
+            if (window) {
+                CreateSyncPrimitive();
+            } else {
+                CreateOffscreens();
+                timelineReadback = std::make_unique<Timeline>(*lgcDevice);
+            }
             CreateCommandBuffers();
-            CreateSyncPrimitive();
+            CreateFrameArenas();
+            recorder = std::make_unique<Recorder>(*lgcDevice, topology.graphicsFamily, frames.size());
+            graph    = std::make_unique<RenderGraph>(*lgcDevice, *allocator, frames.size());
+            if (profiling) {
+                profiler = std::make_unique<TimestampProfiler>(phyDevice, *lgcDevice, frames.size());
+                graph->SetProfiler(profiler.get(), topology.graphicsFamily, "graphics");
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        for (const auto& job : { present, pipelines }) {
+            try {
+                Job::Wait(job);
+            } catch (...) {
+                if (!error) error = std::current_exception();
+            }
+        }
+        if (error) std::rethrow_exception(error);
+        if (window) {
             window->PollEvents();
             window->ShowWindow();
         }
     }
-    vk::UniqueInstance CreateInstance(void) {
-        auto requiredLyrCount = static_cast<std::uint32_t>(0);
-        auto requiredLyrNames = GetRequiredInstanceLyrs(&requiredLyrCount, !window);
-        auto requiredExtCount = static_cast<std::uint32_t>(0);
-        auto requiredExtNames = GetRequiredInstanceExts(&requiredExtCount, !window);
-        std::span lyrNames(requiredLyrNames, requiredLyrCount);
-        std::span extNames(requiredExtNames, requiredExtCount);
-        auto appName = Config::GetAppName();
-        auto sysName = Version::Name;
-        auto appVer = VK_MAKE_VERSION(Config::GetAppMajor(), Config::GetAppMinor(), Config::GetAppPatch());
-        auto sysVer = VK_MAKE_VERSION(Version::Major       , Version::Minor       , Version::Patch       );
-        vk::ApplicationInfo    appInfo(appName.c_str(), appVer, sysName, sysVer, VK_API_VERSION_1_3);
-        vk::InstanceCreateInfo insInfo(vk::InstanceCreateFlags(), &appInfo, lyrNames, extNames);
-        return vk::createInstanceUnique(insInfo);
-    }
-    vk::PhysicalDevice ChoosePhysicalDevice(void) {
-        auto devices = instance->enumeratePhysicalDevices() |
-        std::ranges::views::filter([&](const vk::PhysicalDevice& device) {
-            auto queueFamilyProperties = device.getQueueFamilyProperties();
-            vk::QueueFlags queueFlags;
-            for (const auto& queueFamilyProperty : queueFamilyProperties) {
-                queueFlags |= queueFamilyProperty.queueFlags;
-            }
-            if (queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer)) {
-                if (!window) return true;
-                for (std::uint32_t i = 0, size = queueFamilyProperties.size(); i < size; ++i) {
-                    if (queueFamilyProperties[i].queueFlags & vk::QueueFlagBits::eGraphics) {
-                        if (glfwGetPhysicalDevicePresentationSupport(*instance, device, i)) return true;
-                    }
-                }
-            }
-            return false;
-        });
-        auto device = std::ranges::max_element(devices, {}, [](const auto &device) {
-            auto deviceProperty = device.getProperties(); 
-            auto memoryProperty = device.getMemoryProperties(); 
-            std::size_t deviceType = 0;
-            std::size_t memorySize = 0;
-            switch (deviceProperty.deviceType) {
-            case vk::PhysicalDeviceType::eDiscreteGpu:
-                deviceType = 2;
-                break;
-            case vk::PhysicalDeviceType::eIntegratedGpu:
-                deviceType = 1;
-                break;
-            default:
-                break;
-            }
-            for (const auto& heap : std::span(memoryProperty.memoryHeaps).first(memoryProperty.memoryHeapCount)) {
-                if (heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal) memorySize += heap.size;
-            }
-            return std::make_tuple(deviceType, memorySize);
-        });
-        if (device != devices.end()) return *device;
-        throw std::runtime_error("No suitable physical device found");
+    ~Impl() {
+        if (lgcDevice) lgcDevice->waitIdle();
     }
     vk::UniqueDevice CreateLogicalDevice(void) {
-        // TODO: The queue selection logic has room for improvement
-        auto queueFamilyGraphics   = static_cast<std::uint32_t>(0);
-        auto queueFamilyCompute    = static_cast<std::uint32_t>(0);
-        auto queueFamilyTransfer   = static_cast<std::uint32_t>(0);
         auto queueFamilyProperties = phyDevice.getQueueFamilyProperties();
-        for (std::uint32_t i = 0, size = queueFamilyProperties.size(); i < size; ++i) {
-            if (queueFamilyProperties[i].queueFlags & vk::QueueFlagBits::eGraphics) queueFamilyGraphics = i;
-            if (queueFamilyProperties[i].queueFlags & vk::QueueFlagBits::eCompute ) queueFamilyCompute  = i;
-            if (queueFamilyProperties[i].queueFlags & vk::QueueFlagBits::eTransfer) queueFamilyTransfer = i;
-        }
         std::vector<std::uint32_t> queueCountList(queueFamilyProperties.size());
-        auto queueIndexGraphics = queueCountList[queueFamilyGraphics]++;
-        auto queueIndexCompute  = queueCountList[queueFamilyCompute ]++;
-        auto queueIndexTransfer = queueCountList[queueFamilyTransfer]++;
+        for (auto [family, index] : { std::pair(topology.graphicsFamily, topology.graphicsIndex),
+                                      std::pair(topology.computeFamily,  topology.computeIndex ),
+                                      std::pair(topology.transferFamily, topology.transferIndex) }) {
+            queueCountList[family] = std::max(queueCountList[family], index + 1);
+        }
         std::vector<vk::DeviceQueueCreateInfo> queueInfos;
         std::vector<std::vector<float>> queuePrioritiesList;
-        for (std::size_t i = 0, size = queueCountList.size(); i < size; ++i) if (queueCountList[i]) {
-            if (queueCountList[i] > queueFamilyProperties[i].queueCount) {
-                throw std::runtime_error("Attempted to create more queues than supported");
-            }
+        for (std::uint32_t i = 0, size = queueCountList.size(); i < size; ++i) if (queueCountList[i]) {
             const auto& queuePriorities = queuePrioritiesList.emplace_back(queueCountList[i], 1.0f);
             queueInfos.emplace_back(vk::DeviceQueueCreateFlags(), i, queuePriorities);
         }
         auto device = [this, &queueInfos] {
             std::vector<const char*> lyrNames;
             std::vector<const char*> extNames;
-            extNames.emplace_back("VK_KHR_swapchain");
-            vk::DeviceCreateInfo info(vk::DeviceCreateFlags(), queueInfos, lyrNames, extNames);
-            return phyDevice.createDeviceUnique(info);
+            if (window) extNames.emplace_back("VK_KHR_swapchain");
+            if (memoryBudget) extNames.emplace_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+            vk::PhysicalDeviceFeatures features;
+            features.multiDrawIndirect         = indirectCount ? VK_TRUE : VK_FALSE;
+            features.drawIndirectFirstInstance = indirectCount ? VK_TRUE : VK_FALSE;
+            features.samplerAnisotropy         = samplerAnisotropy ? VK_TRUE : VK_FALSE;
+            vk::DeviceCreateInfo info(vk::DeviceCreateFlags(), queueInfos, lyrNames, extNames, &features);
+            vk::PhysicalDeviceVulkan12Features features12;
+            features12.timelineSemaphore                             = VK_TRUE;
+            features12.hostQueryReset                                = profiling ? VK_TRUE : VK_FALSE;
+            features12.descriptorIndexing                            = VK_TRUE;
+            features12.shaderSampledImageArrayNonUniformIndexing     = VK_TRUE;
+            features12.shaderStorageBufferArrayNonUniformIndexing    = VK_TRUE;
+            features12.descriptorBindingSampledImageUpdateAfterBind  = VK_TRUE;
+            features12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+            features12.descriptorBindingUpdateUnusedWhilePending     = VK_TRUE;
+            features12.descriptorBindingPartiallyBound               = VK_TRUE;
+            features12.runtimeDescriptorArray                        = VK_TRUE;
+            features12.drawIndirectCount                             = indirectCount ? VK_TRUE : VK_FALSE;
+            vk::PhysicalDeviceVulkan13Features features13;
+            features13.synchronization2  = VK_TRUE;
+            features13.dynamicRendering  = VK_TRUE;
+            vk::StructureChain<vk::DeviceCreateInfo, vk::PhysicalDeviceVulkan12Features, vk::PhysicalDeviceVulkan13Features> chain(info, features12, features13);
+            return phyDevice.createDeviceUnique(chain.get<vk::DeviceCreateInfo>());
         }();
         {
             vk::CommandPoolCreateInfo info(vk::CommandPoolCreateFlagBits::eResetCommandBuffer);
-            info.setQueueFamilyIndex(queueFamilyGraphics);
+            info.setQueueFamilyIndex(topology.graphicsFamily);
             commandPoolGraphics = device->createCommandPoolUnique(info);
-            info.setQueueFamilyIndex(queueFamilyCompute );
+            info.setQueueFamilyIndex(topology.computeFamily );
             commandPoolCompute  = device->createCommandPoolUnique(info);
-            info.setQueueFamilyIndex(queueFamilyTransfer);
+            info.setQueueFamilyIndex(topology.transferFamily);
             commandPoolTransfer = device->createCommandPoolUnique(info);
         }
-        queueGraphics = device->getQueue(queueFamilyGraphics, queueIndexGraphics);
-        queueCompute  = device->getQueue(queueFamilyCompute,  queueIndexCompute );
-        queueTransfer = device->getQueue(queueFamilyTransfer, queueIndexTransfer);
+        auto mutexGraphics = std::make_shared<std::mutex>();
+        auto mutexCompute  = topology.sharedCompute ? mutexGraphics : std::make_shared<std::mutex>();
+        auto mutexTransfer = std::make_shared<std::mutex>();
+        if (topology.sharedTransfer) {
+            auto sameAsGraphics = topology.transferFamily == topology.graphicsFamily && topology.transferIndex == topology.graphicsIndex;
+            mutexTransfer = sameAsGraphics ? mutexGraphics : mutexCompute;
+        }
+        queueGraphics    = Queue(device->getQueue(topology.graphicsFamily, topology.graphicsIndex), mutexGraphics);
+        queueCompute     = Queue(device->getQueue(topology.computeFamily,  topology.computeIndex ), mutexCompute );
+        queueTransfer    = Queue(device->getQueue(topology.transferFamily, topology.transferIndex), mutexTransfer);
+        timelineGraphics = std::make_unique<Timeline>(*device);
+        timelineCompute  = std::make_unique<Timeline>(*device);
         return device;
     }
+    std::vector<std::uint32_t> GetQueueFamilies(void) const {
+        std::vector<std::uint32_t> families{ topology.graphicsFamily };
+        for (auto family : { topology.computeFamily, topology.transferFamily }) {
+            if (std::ranges::find(families, family) == families.end()) families.push_back(family);
+        }
+        return families;
+    }
+    std::unique_ptr<Uploader> CreateUploader(vk::DeviceSize capacity) {
+        auto alignment = phyDevice.getProperties().limits.optimalBufferCopyOffsetAlignment;
+        return std::make_unique<Uploader>(*lgcDevice, *allocator, queueTransfer, topology.transferFamily, topology.graphicsFamily, alignment, capacity);
+    }
     vk::UniqueSurfaceKHR CreateSurface(void) {
         VkSurfaceKHR surface;
         auto handle = std::any_cast<GLFWwindow*>(window->GetHandle());
@@ -212,167 +542,496 @@ struct Device::Impl {
         }
         return vk::UniqueSurfaceKHR(surface, vk::ObjectDestroy<vk::Instance, vk::DispatchLoaderStatic>(*instance));
     }
+    vk::SurfaceFormatKHR ChooseSurfaceFormat(void) {
+        auto formats = phyDevice.getSurfaceFormatsKHR(*surface);
+        if (formats.empty()) throw std::runtime_error("No surface format available");
+        for (const auto& format : formats) {
+            if (format.colorSpace != vk::ColorSpaceKHR::eSrgbNonlinear) continue;
+            if (format.format == vk::Format::eB8G8R8A8Unorm || format.format == vk::Format::eR8G8B8A8Unorm) return format;
+        }
+        return formats[0];
+    }
+    vk::PresentModeKHR ChoosePresentMode(void) {
+        auto modes = phyDevice.getSurfacePresentModesKHR(*surface);
+        for (auto candidate : GetPresentModeCandidates(presentPolicy)) {
+            if (std::ranges::find(modes, candidate) != modes.end()) return candidate;
+        }
+        return vk::PresentModeKHR::eFifo;
+    }
+    vk::Extent2D GetWindowExtent(void) {
+        auto [width, height] = window->GetFramebufferSize();
+        return vk::Extent2D(static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height));
+    }
+    SwapchainDesc DescribeSwapchain(void) {
+        SwapchainDesc desc;
+        desc.capabilities = phyDevice.getSurfaceCapabilitiesKHR(*surface);
+        desc.format       = ChooseSurfaceFormat();
+        desc.windowExtent = GetWindowExtent();
+        const auto& cap   = desc.capabilities;
+        if (cap.currentExtent.width != std::numeric_limits<std::uint32_t>::max()) {
+            desc.extent = cap.currentExtent;
+        } else if (desc.windowExtent.width && desc.windowExtent.height) {
+            desc.extent.width  = std::clamp(desc.windowExtent.width,  cap.minImageExtent.width,  cap.maxImageExtent.width );
+            desc.extent.height = std::clamp(desc.windowExtent.height, cap.minImageExtent.height, cap.maxImageExtent.height);
+        }
+        return desc;
+    }
     vk::UniqueSwapchainKHR CreateSwapchain(void) {
-        // TODO: Review and optimize these parameters later
-        auto fmt = phyDevice.getSurfaceFormatsKHR(*surface)[0];
-        auto cap = phyDevice.getSurfaceCapabilitiesKHR(*surface);
+        const auto& fmt = swapchainDesc.format;
+        const auto& cap = swapchainDesc.capabilities;
+        auto maxImageCount = cap.maxImageCount ? cap.maxImageCount : std::numeric_limits<std::uint32_t>::max();
+        auto compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque;
+        if (!(cap.supportedCompositeAlpha & compositeAlpha)) {
+            for (auto alpha : { vk::CompositeAlphaFlagBitsKHR::ePreMultiplied, vk::CompositeAlphaFlagBitsKHR::ePostMultiplied, vk::CompositeAlphaFlagBitsKHR::eInherit }) {
+                if (cap.supportedCompositeAlpha & alpha) {
+                    compositeAlpha = alpha;
+                    break;
+                }
+            }
+        }
+        presentMode = ChoosePresentMode();
         vk::SwapchainCreateInfoKHR info;
         info.surface          = *surface;
-        info.minImageCount    = std::clamp(2u, cap.minImageCount, cap.maxImageCount);
+        info.minImageCount    = std::clamp(static_cast<std::uint32_t>(imageCount), cap.minImageCount, maxImageCount);
         info.imageFormat      = fmt.format;
         info.imageColorSpace  = fmt.colorSpace;
-        info.imageExtent      = cap.currentExtent;
+        info.imageExtent      = swapchainDesc.extent;
         info.imageArrayLayers = 1;
-        info.imageUsage       = cap.supportedUsageFlags;
-        info.presentMode      = vk::PresentModeKHR::eFifo;
+        info.imageUsage       = cap.supportedUsageFlags & (vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferDst);
+        info.preTransform     = cap.currentTransform;
+        info.compositeAlpha   = compositeAlpha;
+        info.presentMode      = presentMode;
         info.clipped          = VK_TRUE;
+        info.oldSwapchain     = *swapchain;
         return lgcDevice->createSwapchainKHRUnique(info);
     }
-    void CreateDepthStencil(void) {
-        // TODO: Review and optimize these parameters later
-        // TODO: Add support for headless mode
-        auto cap = phyDevice.getSurfaceCapabilitiesKHR(*surface);
-        vk::ImageCreateInfo info;
-        info.imageType       = vk::ImageType::e2D;
-        info.format          = vk::Format::eD32SfloatS8Uint;
-        info.extent          = vk::Extent3D(cap.currentExtent, 1);
-        info.mipLevels       = 1;
-        info.arrayLayers     = 1;
-        info.usage           = vk::ImageUsageFlagBits::eDepthStencilAttachment;
-        depthStencil         = lgcDevice->createImageUnique(info);
-        auto requirements    = lgcDevice->getImageMemoryRequirements(*depthStencil);
-        auto properties      = phyDevice.getMemoryProperties();
-        auto memoryTypeIndex = 0u;
-        for (std::uint32_t i = 0, size = properties.memoryTypeCount; i < size; ++i) {
-            if (requirements.memoryTypeBits & 1) {
-                const auto& types = properties.memoryTypes[i];
-                if (types.propertyFlags & vk::MemoryPropertyFlagBits::eDeviceLocal) {
-                    memoryTypeIndex = i;
-                    break;
-                }
+    bool RecreateSwapchain(void) {
+        auto desc = DescribeSwapchain();
+        if (!desc.extent.width || !desc.extent.height) return false;
+        swapchainDesc = desc;
+        auto next = CreateSwapchain();
+        deletions->Push(std::exchange(colorImageViews, {}));
+        deletions->Push(std::exchange(swapchain, std::move(next)));
+        CreateImageViews();
+        swapchainDirty = false;
+        return true;
+    }
+    void CollectRetirements(void) {
+        descriptors->Collect(timelineGraphics->GetCompleted());
+        deletions->Collect();
+    }
+    std::uint64_t GetRetireValue(void) const {
+        return timelineGraphics->GetPending().value + (frameBegun && imageIndex ? 1 : 0);
+    }
+    template <typename T>
+    void Retire(T&& object) {
+        uploader->Flush();
+        std::array values{ GetRetireValue(), timelineCompute->GetPending().value, uploader->GetTimeline().GetPending().value };
+        deletions->Push(std::forward<T>(object), values);
+    }
+    bool AcquireImage(vk::Semaphore semaphore) {
+        for (std::size_t attempt = 0; attempt < 2; ++attempt) {
+            if (swapchainDirty && !RecreateSwapchain()) return false;
+            try {
+                auto result = lgcDevice->acquireNextImageKHR(*swapchain, std::numeric_limits<std::uint64_t>::max(), semaphore, nullptr);
+                if (result.result == vk::Result::eSuboptimalKHR) swapchainDirty = true;
+                imageIndex = result.value;
+                return true;
+            } catch (const vk::OutOfDateKHRError&) {
+                swapchainDirty = true;
             }
-            requirements.memoryTypeBits >>= 1;
         }
-        vk::MemoryAllocateInfo allocInfo(requirements.size, memoryTypeIndex);
-        depthStencilMemory = lgcDevice->allocateMemoryUnique(allocInfo);
-        lgcDevice->bindImageMemory(*depthStencil, *depthStencilMemory, 0);
+        return false;
     }
     void CreateImageViews(void) {
         // TODO: Review and optimize these parameters later
-        // TODO: Add support for headless mode
         vk::ComponentMapping components(vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eG, vk::ComponentSwizzle::eB, vk::ComponentSwizzle::eA);
-        auto fmt    = phyDevice.getSurfaceFormatsKHR(*surface)[0];
-        auto images = lgcDevice->getSwapchainImagesKHR(*swapchain);
-        for (const auto& image : images) {
+        swapchainImages = lgcDevice->getSwapchainImagesKHR(*swapchain);
+        swapchainDesc.imageCount = swapchainImages.size();
+        for (const auto& image : swapchainImages) {
             vk::ImageSubresourceRange subresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
-            vk::ImageViewCreateInfo info(vk::ImageViewCreateFlags(), image, vk::ImageViewType::e2D, fmt.format, components, subresourceRange);
+            vk::ImageViewCreateInfo info(vk::ImageViewCreateFlags(), image, vk::ImageViewType::e2D, swapchainDesc.format.format, components, subresourceRange);
             colorImageViews.emplace_back(lgcDevice->createImageViewUnique(info));
         }
-        vk::ImageSubresourceRange subresourceRange(vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil, 0, 1, 0, 1);
-        vk::ImageViewCreateInfo info(vk::ImageViewCreateFlags(), *depthStencil, vk::ImageViewType::e2D, vk::Format::eD32SfloatS8Uint, components, subresourceRange);
-        depthImageView = lgcDevice->createImageViewUnique(info);
     }
-    void CreateRenderPass(void) {
-        // TODO: Review and optimize these parameters later
-        // TODO: Add support for headless mode
-        auto fmt = phyDevice.getSurfaceFormatsKHR(*surface)[0];
-        std::array<vk::AttachmentDescription, 2> attachments;
-        std::array<vk::SubpassDescription,    1> subpasses;
-        auto& colorAttachment         = attachments[0];
-        auto& depthAttachment         = attachments[1];
-        colorAttachment.format        = fmt.format;
-        colorAttachment.loadOp        = vk::AttachmentLoadOp::eClear;
-        colorAttachment.finalLayout   = vk::ImageLayout::ePresentSrcKHR;
-        depthAttachment.format        = vk::Format::eD32SfloatS8Uint;
-        depthAttachment.loadOp        = vk::AttachmentLoadOp::eClear;
-        depthAttachment.finalLayout   = vk::ImageLayout::eDepthStencilAttachmentOptimal;
-        std::array<vk::AttachmentReference, 1> colorReference;
-        colorReference[0] = { 0, vk::ImageLayout::eColorAttachmentOptimal        };
-        std::array<vk::AttachmentReference, 1> depthReference;
-        depthReference[0] = { 1, vk::ImageLayout::eDepthStencilAttachmentOptimal };
-        subpasses[0].setPipelineBindPoint(vk::PipelineBindPoint::eGraphics);
-        subpasses[0].setColorAttachments       (colorReference       );
-        subpasses[0].setPDepthStencilAttachment(depthReference.data());
-        vk::RenderPassCreateInfo info(vk::RenderPassCreateFlags(), attachments, subpasses);
-        renderPass = lgcDevice->createRenderPassUnique(info);
-    }
-    void CreateFramebuffers(void) {
-        auto cap = phyDevice.getSurfaceCapabilitiesKHR(*surface);
-        vk::FramebufferCreateInfo info;
-        info.renderPass = *renderPass;
-        info.width      = cap.currentExtent.width;
-        info.height     = cap.currentExtent.height;
-        info.layers     = 1;
-        for (const auto& view : colorImageViews) {
-            std::array<vk::ImageView, 2> attachments{ *view, *depthImageView };
-            info.setAttachments(attachments);
-            framebuffers.emplace_back(lgcDevice->createFramebufferUnique(info));
+    void CreateOffscreens(void) {
+        using enum vk::ImageUsageFlagBits;
+        std::array families{ topology.graphicsFamily, topology.transferFamily };
+        vk::ComponentMapping components(vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eG, vk::ComponentSwizzle::eB, vk::ComponentSwizzle::eA);
+        vk::ImageSubresourceRange colorRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+        vk::BufferCreateInfo readbackInfo(vk::BufferCreateFlags(), GetReadbackSize(), vk::BufferUsageFlagBits::eTransferDst);
+        offscreens.resize(frames.size());
+        for (auto& offscreen : offscreens) {
+            vk::ImageCreateInfo info;
+            info.imageType   = vk::ImageType::e2D;
+            info.format      = offscreenFormat;
+            info.extent      = vk::Extent3D(offscreenExtent, 1);
+            info.mipLevels   = 1;
+            info.arrayLayers = 1;
+            info.usage       = eColorAttachment | eTransferSrc;
+            if (families[0] != families[1]) info.setSharingMode(vk::SharingMode::eConcurrent).setQueueFamilyIndices(families);
+            offscreen.color     = allocator->CreateImage(info, MemoryUsage::GpuOnly);
+            offscreen.colorView = lgcDevice->createImageViewUnique(vk::ImageViewCreateInfo(vk::ImageViewCreateFlags(), *offscreen.color.image, vk::ImageViewType::e2D, offscreenFormat, components, colorRange));
+            offscreen.readback  = allocator->CreateBuffer(readbackInfo, MemoryUsage::GpuToCpu);
+        }
+    }
+    vk::DeviceSize GetReadbackSize(void) const {
+        return static_cast<vk::DeviceSize>(offscreenExtent.width) * offscreenExtent.height * 4;
+    }
+    vk::Format GetColorFormat(void) const {
+        return window ? swapchainDesc.format.format : offscreenFormat;
+    }
+    ImportedImage GetTarget(void) const {
+        auto extent = GetRenderExtent();
+        if (window) {
+            return { swapchainImages[*imageIndex], *colorImageViews[*imageIndex], { GetColorFormat(), extent },
+                     vk::ImageLayout::eUndefined, vk::ImageLayout::ePresentSrcKHR, vk::PipelineStageFlagBits2::eColorAttachmentOutput };
         }
+        const auto& offscreen = offscreens[*imageIndex];
+        return { *offscreen.color.image, *offscreen.colorView, { GetColorFormat(), extent },
+                 vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferSrcOptimal, vk::PipelineStageFlagBits2::eNone };
+    }
+    vk::Extent2D GetRenderExtent(void) const {
+        return window ? swapchainDesc.extent : offscreenExtent;
     }
     void CreateCommandBuffers(void) {
         // TODO: Review and optimize these parameters later
         vk::CommandBufferAllocateInfo info;
-        info.commandPool        = *commandPoolGraphics;
-        info.level              = vk::CommandBufferLevel::ePrimary;
-        info.commandBufferCount = colorImageViews.size();
-        commandBuffersGraphics  = lgcDevice->allocateCommandBuffersUnique(info);
-        info.commandPool        = *commandPoolCompute;
-        info.level              = vk::CommandBufferLevel::ePrimary;
-        info.commandBufferCount = colorImageViews.size();
-        commandBuffersCompute   = lgcDevice->allocateCommandBuffersUnique(info);
-        info.commandPool        = *commandPoolTransfer;
         info.level              = vk::CommandBufferLevel::ePrimary;
-        info.commandBufferCount = colorImageViews.size();
-        commandBuffersTransfer  = lgcDevice->allocateCommandBuffersUnique(info);
+        info.commandBufferCount = 1;
+        for (auto& frame : frames) {
+            info.commandPool            = *commandPoolGraphics;
+            frame.commandBufferGraphics = std::move(lgcDevice->allocateCommandBuffersUnique(info).front());
+            info.commandPool            = *commandPoolCompute;
+            frame.commandBufferCompute  = std::move(lgcDevice->allocateCommandBuffersUnique(info).front());
+            info.commandPool            = *commandPoolTransfer;
+            frame.commandBufferTransfer = std::move(lgcDevice->allocateCommandBuffersUnique(info).front());
+        }
     }
     void CreateSyncPrimitive(void) {
-        // TODO: Review and optimize these parameters later
-        for (std::size_t i = 0, size = colorImageViews.size(); i < size; ++i) {
-            vk::FenceCreateInfo info(vk::FenceCreateFlagBits::eSignaled);
-            presentFences.push_back(lgcDevice->createFenceUnique(info));
-        }
-        presentCompletedSemaphore = lgcDevice->createSemaphoreUnique({});
-        renderCompletedSemaphore  = lgcDevice->createSemaphoreUnique({});
-    }
-    void Clear(float r, float g, float b, float a) {
-        // TODO: Temporary implementation for debug
-        auto cap = phyDevice.getSurfaceCapabilitiesKHR(*surface);
-        std::uint32_t imageIndex;
-        lgcDevice->acquireNextImageKHR(*swapchain, std::numeric_limits<std::uint64_t>::max(), *presentCompletedSemaphore, nullptr, &imageIndex);
-        lgcDevice->waitForFences(1, &presentFences[imageIndex].get(), VK_TRUE, std::numeric_limits<std::uint64_t>::max());
-        std::array<vk::ClearValue, 2> clearValues;
-        clearValues[0].color.float32[0]     =   r;
-        clearValues[0].color.float32[1]     =   g;
-        clearValues[0].color.float32[2]     =   b;
-        clearValues[0].color.float32[3]     =   a;
-        clearValues[1].depthStencil.depth   = 1.0;
-        clearValues[1].depthStencil.stencil =   0;
-        vk::CommandBufferBeginInfo info;
-        commandBuffersGraphics[imageIndex]->begin(info);
-        vk::Rect2D renderArea({ 0, 0 }, cap.currentExtent);
-        vk::RenderPassBeginInfo rpInfo(*renderPass, *framebuffers[imageIndex], renderArea, clearValues);
-        commandBuffersGraphics[imageIndex]->beginRenderPass(rpInfo, vk::SubpassContents::eInline);
-        // Draw here
-        commandBuffersGraphics[imageIndex]->endRenderPass();
-        commandBuffersGraphics[imageIndex]->end();
-        std::array<vk::SubmitInfo, 1> submitInfos;
-        vk::PipelineStageFlags waitStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-        submitInfos[0].commandBufferCount   = 1;
-        submitInfos[0].pCommandBuffers      = &commandBuffersGraphics[imageIndex].get();
-        submitInfos[0].pWaitDstStageMask    = &waitStageMask;
-        submitInfos[0].waitSemaphoreCount   = 1;
-        submitInfos[0].pWaitSemaphores      = &presentCompletedSemaphore.get();
-        submitInfos[0].signalSemaphoreCount = 1;
-        submitInfos[0].pSignalSemaphores    = &renderCompletedSemaphore.get();
-        lgcDevice->resetFences(1, &presentFences[imageIndex].get());
-        queueGraphics.submit(submitInfos, *presentFences[imageIndex]);
+        for (auto& frame : frames) {
+            frame.acquireSemaphore = lgcDevice->createSemaphoreUnique({});
+            frame.renderSemaphore  = lgcDevice->createSemaphoreUnique({});
+        }
+    }
+    void CreateFrameArenas(void) {
+        using enum vk::BufferUsageFlagBits;
+        for (auto& frame : frames) {
+            frame.arena = std::make_unique<LinearArena>(*allocator, frameArenaSize, eUniformBuffer | eStorageBuffer | eVertexBuffer | eIndexBuffer | eIndirectBuffer | eTransferSrc);
+        }
+    }
+    void SubmitReadback(Frame& frame, Offscreen& offscreen, const SyncPoint& renderPoint) {
+        auto& commandBuffer = *frame.commandBufferTransfer;
+        commandBuffer.reset();
+        commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+        vk::BufferImageCopy region;
+        region.imageSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+        region.imageExtent      = vk::Extent3D(offscreenExtent, 1);
+        auto zone = profiler ? profiler->Begin(commandBuffer, topology.transferFamily, "transfer", "readback") : std::nullopt;
+        commandBuffer.copyImageToBuffer(*offscreen.color.image, vk::ImageLayout::eTransferSrcOptimal, *offscreen.readback.buffer, region);
+        vk::MemoryBarrier2 barrier(vk::PipelineStageFlagBits2::eCopy, vk::AccessFlagBits2::eTransferWrite, vk::PipelineStageFlagBits2::eHost, vk::AccessFlagBits2::eHostRead);
+        commandBuffer.pipelineBarrier2(vk::DependencyInfo().setMemoryBarriers(barrier));
+        if (profiler) profiler->End(commandBuffer, zone);
+        commandBuffer.end();
+        auto readbackPoint = timelineReadback->Next();
+        Submission submission;
+        submission.Wait(renderPoint, vk::PipelineStageFlagBits2::eCopy);
+        submission.Execute(commandBuffer);
+        submission.Signal(readbackPoint);
+        queueTransfer.Submit(submission);
+        offscreen.readbackValue = readbackPoint.value;
+        offscreen.frameNumber   = frameNumber++;
+    }
+    void DeliverReadback(Offscreen& offscreen) {
+        if (!offscreen.frameNumber) return;
+        timelineReadback->Wait(offscreen.readbackValue);
+        auto number = *std::exchange(offscreen.frameNumber, std::nullopt);
+        if (readback) readback(number, std::span(static_cast<const std::byte*>(offscreen.readback.allocation.GetMapped()), GetReadbackSize()));
+    }
+    void ResolveTiming(std::size_t slot) {
+        if (!profiler) return;
+        auto  zones = profiler->BeginSlot(slot);
+        auto& frame = frames[slot];
+        if (!frame.timing) return;
+        auto timing = *std::exchange(frame.timing, std::nullopt);
+        timing.zones = std::move(zones);
+        for (const auto& zone : timing.zones) timing.gpuTime = std::max(timing.gpuTime, zone.end);
+        timings.push_back(std::move(timing));
+        if (timings.size() > maxTimings) timings.pop_front();
+    }
+    void FinishFrames(void) {
+        if (frameBegun) throw std::runtime_error("The frame has already begun");
+        timelineGraphics->Wait(timelineGraphics->GetPending().value);
+        for (std::size_t i = 0; i < offscreens.size(); ++i) DeliverReadback(offscreens[(frameIndex + i) % offscreens.size()]);
+        for (std::size_t i = 0; i < frames.size(); ++i) ResolveTiming((frameIndex + i) % frames.size());
+    }
+    std::pair<Image, vk::UniqueImageView> CreateTextureImage(const vk::Extent3D& extent, std::uint32_t mipLevels, TextureFormat format) {
+        vk::ImageCreateInfo info;
+        info.imageType   = vk::ImageType::e2D;
+        info.format      = ToFormat(format);
+        info.extent      = extent;
+        info.mipLevels   = mipLevels;
+        info.arrayLayers = 1;
+        info.usage       = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
+        auto image = allocator->CreateImage(info, MemoryUsage::GpuOnly);
+        vk::ComponentMapping components(vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eG, vk::ComponentSwizzle::eB, vk::ComponentSwizzle::eA);
+        vk::ImageSubresourceRange subresourceRange(vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, 1);
+        vk::ImageViewCreateInfo viewInfo(vk::ImageViewCreateFlags(), *image.image, vk::ImageViewType::e2D, info.format, components, subresourceRange);
+        auto view = lgcDevice->createImageViewUnique(viewInfo);
+        return { std::move(image), std::move(view) };
+    }
+    std::uint64_t UploadMipChain(Texture& texture, vk::Image image, std::uint32_t mipLevel) {
+        std::uint64_t token = 0;
+        for (auto level = mipLevel; level < texture.mipLevels; ++level) {
+            auto extent = GetMipExtent(texture.extent, level);
+            auto data   = texture.source(level);
+            if (data.size() != extent.width * extent.height * GetTexelSize(texture.format)) throw std::runtime_error("The mip source does not match the mip level");
+            vk::ImageSubresourceLayers subresource(vk::ImageAspectFlagBits::eColor, level - mipLevel, 0, 1);
+            token = uploader->CopyImage(image, subresource, extent, data, vk::ImageLayout::eShaderReadOnlyOptimal);
+        }
+        return token;
+    }
+    std::size_t GetStreamingBudget(void) {
+        auto limit = static_cast<std::size_t>(static_cast<double>(deviceLocalBytes) * streamingBudget);
+        if (!memoryBudget) return limit;
+        auto chain = phyDevice.getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2, vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        const auto& properties = chain.get<vk::PhysicalDeviceMemoryProperties2>().memoryProperties;
+        const auto& budget     = chain.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        std::size_t available = 0;
+        for (std::uint32_t i = 0; i < properties.memoryHeapCount; ++i) {
+            if (!(properties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal)) continue;
+            if (budget.heapBudget[i] > budget.heapUsage[i]) available += budget.heapBudget[i] - budget.heapUsage[i];
+        }
+        return std::min(limit, scheduler.GetResidentBytes() + available);
+    }
+    void UpdateStreaming(void) {
+        STARLIGHT_ZONE("Streaming");
+        std::erase_if(streamingPending, [this](std::uint32_t id) {
+            auto& texture = textures.Get(id);
+            if (!uploader->IsComplete(texture.pending->token)) return false;
+            deletions->Push(std::exchange(texture.view, std::move(texture.pending->view)));
+            deletions->Push(std::exchange(texture.image, std::move(texture.pending->image)));
+            descriptors->Free(DescriptorKind::SampledImage, std::exchange(texture.descriptor, descriptors->AddImage(*texture.view, vk::ImageLayout::eShaderReadOnlyOptimal)), GetRetireValue());
+            texture.residentMip = texture.pending->mipLevel;
+            texture.pending.reset();
+            scheduler.Complete(id);
+            return true;
+        });
+        auto budget  = GetStreamingBudget();
+        auto changes = scheduler.Schedule(budget, streamingFrameBytes);
+        std::size_t uploaded = 0;
+        for (const auto& change : changes) {
+            auto& texture = textures.Get(change.texture);
+            if (texture.pending) throw std::runtime_error("The texture already has a pending upload");
+            auto [image, view] = CreateTextureImage(GetMipExtent(texture.extent, change.mipLevel), texture.mipLevels - change.mipLevel, texture.format);
+            auto token = UploadMipChain(texture, *image.image, change.mipLevel);
+            texture.pending = Texture::Pending{ std::move(image), std::move(view), change.mipLevel, token };
+            streamingPending.push_back(change.texture);
+            uploaded += change.bytes;
+        }
+        streamingStats = { scheduler.GetResidentBytes(), budget, uploaded, streamingPending.size() };
+    }
+    void BeginFrame(float r, float g, float b, float a) {
+        if (frameBegun) throw std::runtime_error("The frame has already begun");
+        auto& frame = frames[frameIndex];
+        frameBegin = GetProfilerTime();
+        ++frameSerial;
+        {
+            STARLIGHT_ZONE("WaitRetire");
+            timelineGraphics->Wait(frame.retireValue);
+        }
+        if (!window) DeliverReadback(offscreens[frameIndex]);
+        ResolveTiming(frameIndex);
+        CollectRetirements();
+        frame.arena->Reset();
+        recorder->BeginFrame(frameIndex);
+        UpdateStreaming();
+        uploader->Flush();
+        passImages.clear();
+        mainSamples.clear();
+        if (window) {
+            if (GetWindowExtent() != swapchainDesc.windowExtent) swapchainDirty = true;
+            STARLIGHT_ZONE("AcquireImage");
+            if (!AcquireImage(*frame.acquireSemaphore)) {
+                frameBegun = true;
+                return;
+            }
+        } else {
+            imageIndex = static_cast<std::uint32_t>(frameIndex);
+        }
+        try {
+            clearColor = vk::ClearColorValue(r, g, b, a);
+            secondaries.clear();
+            auto& commandBuffer = *frame.commandBufferGraphics;
+            commandBuffer.reset();
+            commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+            frameZone   = profiler ? profiler->Begin(commandBuffer, topology.graphicsFamily, "graphics", "frame") : std::nullopt;
+            uploadPoint = uploader->RecordAcquires(commandBuffer);
+        } catch (...) {
+            imageIndex.reset();
+            throw;
+        }
+        frameBegun = true;
+    }
+    PassImageResource& GetPassImage(PassImage image) {
+        auto index = std::to_underlying(image);
+        if (index >= passImages.size()) throw std::runtime_error("Invalid pass image handle");
+        return passImages[index];
+    }
+    PassImage CreatePassImage(const PassImageDesc& desc) {
+        if (!frameBegun) throw std::runtime_error("The frame has not begun");
+        if (!imageIndex) return PassImage{};
+        auto extent = GetRenderExtent();
+        if (desc.width ) extent.width  = desc.width;
+        if (desc.height) extent.height = desc.height;
+        auto image = graph->Create({ desc.depth ? depthFormat : ToFormat(desc.format), extent });
+        passImages.push_back({ image, desc.depth, std::nullopt });
+        return static_cast<PassImage>(passImages.size() - 1);
+    }
+    std::uint32_t GetPassImageIndex(PassImage image) {
+        if (!frameBegun) throw std::runtime_error("The frame has not begun");
+        if (!imageIndex) return 0;
+        auto& resource = GetPassImage(image);
+        if (resource.depth && stencilFormat != vk::Format::eUndefined) throw std::runtime_error("A depth image with stencil cannot be sampled");
+        if (!resource.descriptor) {
+            // The GPU reads the index no later than this frame, so it is retired with the frame right away
+            resource.descriptor = descriptors->ReserveImage();
+            descriptors->Free(DescriptorKind::SampledImage, *resource.descriptor, GetRetireValue());
+        }
+        return *resource.descriptor;
+    }
+    void WritePassImages(std::span<const PassImage> images) {
+        for (auto image : images) {
+            const auto& resource = passImages[std::to_underlying(image)];
+            if (resource.descriptor) descriptors->SetImage(*resource.descriptor, graph->GetView(resource.image), vk::ImageLayout::eShaderReadOnlyOptimal);
+        }
+    }
+    void AddPass(const std::string& name, const PassDesc& desc, const PassCallback& record) {
+        if (!frameBegun) throw std::runtime_error("The frame has not begun");
+        if (!imageIndex) return;
+        if (desc.colors.empty() && !desc.depth) throw std::runtime_error("The pass has no attachment");
+        std::vector<GraphImage> colors;
+        for (auto image : desc.colors) colors.push_back(GetPassImage(image).image);
+        auto depth = desc.depth ? std::optional(GetPassImage(*desc.depth).image) : std::nullopt;
+        std::vector<PassImage> samples(desc.samples.begin(), desc.samples.end());
+        for (auto image : samples) GetPassImage(image);
+        auto& pass = graph->AddPass(name);
+        for (auto image : colors) pass.Color(image, desc.clear ? std::optional(vk::ClearColorValue(0.0f, 0.0f, 0.0f, 0.0f)) : std::nullopt);
+        if (depth) pass.Depth(*depth, desc.clear ? std::optional(vk::ClearDepthStencilValue(1.0f, 0)) : std::nullopt);
+        for (auto image : samples) pass.Sample(passImages[std::to_underlying(image)].image);
+        pass.Execute([this, record, samples = std::move(samples)](vk::CommandBuffer commandBuffer) {
+            WritePassImages(samples);
+            descriptors->Bind(commandBuffer, vk::PipelineBindPoint::eGraphics);
+            record(commandBuffer);
+        });
+    }
+    void RecordParallel(std::size_t count, const RecordCallback& record, std::span<const PassImage> samples) {
+        STARLIGHT_ZONE("Record");
+        if (!frameBegun) throw std::runtime_error("The frame has not begun");
+        if (!imageIndex) return;
+        for (auto image : samples) GetPassImage(image);
+        for (auto image : samples) {
+            if (std::ranges::find(mainSamples, image) == mainSamples.end()) mainSamples.push_back(image);
+        }
+        recorder->Reserve(count);
+        auto colorFormat = GetColorFormat();
+        vk::CommandBufferInheritanceRenderingInfo rendering;
+        rendering.setColorAttachmentFormats(colorFormat);
+        rendering.depthAttachmentFormat   = depthFormat;
+        rendering.stencilAttachmentFormat = stencilFormat;
+        rendering.rasterizationSamples    = vk::SampleCountFlagBits::e1;
+        vk::CommandBufferInheritanceInfo inheritance;
+        inheritance.pNext = &rendering;
+        std::vector<vk::CommandBuffer> commandBuffers(count);
+        auto recordContext = [&](std::size_t index) {
+            auto commandBuffer = recorder->Allocate(index);
+            commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue, &inheritance));
+            descriptors->Bind(commandBuffer, vk::PipelineBindPoint::eGraphics);
+            record(index, commandBuffer);
+            commandBuffer.end();
+            commandBuffers[index] = commandBuffer;
+        };
+        Job::ParallelFor(count, recordContext);
+        secondaries.insert(secondaries.end(), commandBuffers.begin(), commandBuffers.end());
+    }
+    vk::CommandBuffer BeginCompute(void) {
+        auto& frame = frames[frameIndex];
+        auto& commandBuffer = *frame.commandBufferCompute;
+        if (!std::exchange(frame.computeBegun, true)) {
+            commandBuffer.reset();
+            commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+        }
+        return commandBuffer;
+    }
+    std::optional<SyncPoint> SubmitCompute(Frame& frame) {
+        if (!std::exchange(frame.computeBegun, false)) return std::nullopt;
+        auto& commandBuffer = *frame.commandBufferCompute;
+        commandBuffer.end();
+        auto computePoint = timelineCompute->Next();
+        Submission submission;
+        if (uploadPoint) submission.Wait(*uploadPoint, vk::PipelineStageFlagBits2::eAllCommands);
+        submission.Execute(commandBuffer);
+        submission.Signal(computePoint);
+        queueCompute.Submit(submission);
+        return computePoint;
+    }
+    void EndFrame(void) {
+        if (!frameBegun) throw std::runtime_error("The frame has not begun");
+        frameBegun = false;
+        if (!imageIndex) return;
+        auto& frame = frames[frameIndex];
+        auto& commandBuffer = *frame.commandBufferGraphics;
+        auto target = graph->Import(GetTarget());
+        auto depth  = graph->Create({ depthFormat, GetRenderExtent() });
+        auto& mainPass = graph->AddPass("main")
+            .Color(target, clearColor)
+            .Depth(depth, vk::ClearDepthStencilValue(1.0f, 0))
+            .Secondary();
+        for (auto image : mainSamples) mainPass.Sample(passImages[std::to_underlying(image)].image);
+        mainPass.Execute([this](vk::CommandBuffer primary) {
+            WritePassImages(mainSamples);
+            if (!secondaries.empty()) primary.executeCommands(secondaries);
+        });
+        graph->Execute(commandBuffer);
+        auto memory = graph->GetMemory();
+        transientStats = { static_cast<std::size_t>(memory.requestedBytes), static_cast<std::size_t>(memory.allocatedBytes) };
+        if (profiler) profiler->End(commandBuffer, frameZone);
+        commandBuffer.end();
+        auto computePoint = SubmitCompute(frame);
+        auto retirePoint  = timelineGraphics->Next();
+        Submission submission;
+        if (window) submission.Wait(*frame.acquireSemaphore, vk::PipelineStageFlagBits2::eColorAttachmentOutput);
+        if (uploadPoint) submission.Wait(*uploadPoint, vk::PipelineStageFlagBits2::eAllCommands);
+        if (computePoint) submission.Wait(*computePoint, vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eVertexShader);
+        submission.Execute(commandBuffer);
+        if (window) submission.Signal(*frame.renderSemaphore, vk::PipelineStageFlagBits2::eAllCommands);
+        submission.Signal(retirePoint);
+        {
+            STARLIGHT_ZONE("Submit");
+            queueGraphics.Submit(submission);
+        }
+        frame.retireValue = retirePoint.value;
+        if (profiling) frame.timing = FrameTiming{ frameCount++, frameBegin, GetProfilerTime(), 0.0, {} };
+        auto index = *imageIndex;
+        imageIndex.reset();
+        if (!window) {
+            SubmitReadback(frame, offscreens[frameIndex], retirePoint);
+            frameIndex = (frameIndex + 1) % frames.size();
+            return;
+        }
+        frameIndex = (frameIndex + 1) % frames.size();
         vk::PresentInfoKHR presentInfo;
         presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores    = &renderCompletedSemaphore.get();
+        presentInfo.pWaitSemaphores    = &frame.renderSemaphore.get();
         presentInfo.swapchainCount     = 1;
         presentInfo.pSwapchains        = &swapchain.get();
-        presentInfo.pImageIndices      = &imageIndex;
-        queueGraphics.presentKHR(presentInfo);
+        presentInfo.pImageIndices      = &index;
+        STARLIGHT_ZONE("Present");
+        try {
+            if (queueGraphics.Present(presentInfo) == vk::Result::eSuboptimalKHR) swapchainDirty = true;
+        } catch (const vk::OutOfDateKHRError&) {
+            swapchainDirty = true;
+        }
     }
 };
 
@@ -381,14 +1040,331 @@ Device(nullptr) {
 }
 
 Device::Device(SharedWindow window) :
-pImpl(std::make_unique<Impl>(window)) {
+Device(window, DeviceOptions()) {
+}
+
+Device::Device(SharedWindow window, const DeviceOptions& options) :
+pImpl(std::make_unique<Impl>(window, options)) {
 }
 
 Device::~Device() {
 }
 
+void Device::Preload(bool windowed, const DeviceOptions& options) {
+    std::lock_guard lock(preloadMutex);
+    if (preloaded) return;
+    if (windowed) InitializeWindowSystem();
+    auto selection = std::make_shared<std::optional<Selection>>();
+    auto job = Job::Submit([selection, headless = !windowed, options] {
+        selection->emplace(SelectDevice(headless, options));
+    });
+    preloaded = Preloaded{ !windowed, static_cast<bool>(options.gpuScorer), options.cacheDirectory, job, selection };
+}
+
+std::vector<GpuInfo> Device::EnumerateGpus(void) {
+    auto instance = CreateInstance(true);
+    auto devices  = instance->enumeratePhysicalDevices();
+    std::vector<GpuInfo> infos;
+    for (std::size_t i = 0; i < devices.size(); ++i) {
+        if (IsSuitableDevice(*instance, devices[i], true)) infos.push_back(GetGpuInfo(devices[i], i));
+    }
+    return infos;
+}
+
+std::vector<std::unique_ptr<Device>> Device::CreateHeadlessDevices(const DeviceOptions& options) {
+    auto score = options.gpuScorer ? options.gpuScorer : GpuScorer(DefaultGpuScore);
+    std::vector<std::unique_ptr<Device>> devices;
+    for (const auto& info : EnumerateGpus()) {
+        if (score(info) < 0) continue;
+        auto pinned = options;
+        pinned.gpuScorer = [index = info.index](const GpuInfo& candidate) {
+            return candidate.index == index ? 0 : -1;
+        };
+        devices.push_back(std::make_unique<Device>(nullptr, pinned));
+    }
+    if (devices.empty()) throw std::runtime_error("No suitable physical device found");
+    return devices;
+}
+
+GpuInfo Device::GetGpuInfo(void) {
+    auto devices = pImpl->instance->enumeratePhysicalDevices();
+    auto found   = std::ranges::find(devices, pImpl->phyDevice);
+    return Core::GetGpuInfo(pImpl->phyDevice, found - devices.begin());
+}
+
+std::int64_t DefaultGpuScore(const GpuInfo& info) {
+    std::int64_t rank = 0;
+    switch (info.type) {
+    case GpuType::Discrete:
+        rank = 2;
+        break;
+    case GpuType::Integrated:
+        rank = 1;
+        break;
+    default:
+        break;
+    }
+    auto memory = std::min<std::uint64_t>(info.deviceMemory >> 20, (std::uint64_t(1) << 40) - 1);
+    return (rank << 40) | static_cast<std::int64_t>(memory);
+}
+
+void Device::ConfigureSwapchain(PresentPolicy policy, std::size_t imageCount) {
+    if (!pImpl->window    ) throw std::runtime_error("The device has no swapchain");
+    if (pImpl->frameBegun) throw std::runtime_error("The frame has already begun");
+    pImpl->presentPolicy = policy;
+    pImpl->imageCount    = imageCount;
+    if (!pImpl->RecreateSwapchain()) pImpl->swapchainDirty = true;
+}
+
+PresentPolicy Device::GetPresentPolicy(void) {
+    return ToPresentPolicy(pImpl->presentMode);
+}
+
+std::size_t Device::GetImageCount(void) {
+    return pImpl->swapchainDesc.imageCount;
+}
+
+QueueTopology Device::GetQueueTopology(void) {
+    return pImpl->topology;
+}
+
+BufferHandle Device::CreateBuffer(std::size_t size, BufferUsage usage) {
+    vk::BufferCreateInfo info(vk::BufferCreateFlags(), size, ToBufferUsage(usage));
+    auto storage  = static_cast<std::uint32_t>(usage) & static_cast<std::uint32_t>(BufferUsage::Storage);
+    auto families = pImpl->GetQueueFamilies();
+    if (storage && families.size() > 1) info.setSharingMode(vk::SharingMode::eConcurrent).setQueueFamilyIndices(families);
+    BufferResource resource;
+    resource.buffer = pImpl->allocator->CreateBuffer(info, MemoryUsage::GpuOnly);
+    resource.size   = size;
+    if (storage) {
+        resource.descriptor = pImpl->descriptors->AddBuffer(*resource.buffer.buffer, 0, VK_WHOLE_SIZE);
+    }
+    return static_cast<BufferHandle>(pImpl->buffers.Add(std::move(resource)));
+}
+
+void Device::DestroyBuffer(BufferHandle buffer) {
+    auto& target = pImpl->buffers.Get(std::to_underlying(buffer));
+    if (target.descriptor) pImpl->descriptors->Free(DescriptorKind::StorageBuffer, *target.descriptor, pImpl->GetRetireValue());
+    pImpl->Retire(std::move(target.buffer));
+    pImpl->buffers.Remove(std::to_underlying(buffer));
+}
+
+TextureHandle Device::CreateTexture(std::uint32_t width, std::uint32_t height, std::uint32_t mipLevels, TextureFormat format) {
+    Texture texture;
+    texture.extent    = vk::Extent3D(width, height, 1);
+    texture.mipLevels = std::max(mipLevels, 1u);
+    texture.format    = format;
+    std::tie(texture.image, texture.view) = pImpl->CreateTextureImage(texture.extent, texture.mipLevels, format);
+    texture.descriptor = pImpl->descriptors->AddImage(*texture.view, vk::ImageLayout::eShaderReadOnlyOptimal);
+    return static_cast<TextureHandle>(pImpl->textures.Add(std::move(texture)));
+}
+
+void Device::DestroyTexture(TextureHandle texture) {
+    auto& target = pImpl->textures.Get(std::to_underlying(texture));
+    if (target.source) {
+        pImpl->scheduler.Remove(std::to_underlying(texture));
+        std::erase(pImpl->streamingPending, std::to_underlying(texture));
+    }
+    pImpl->descriptors->Free(DescriptorKind::SampledImage, target.descriptor, pImpl->GetRetireValue());
+    pImpl->Retire(std::move(target));
+    pImpl->textures.Remove(std::to_underlying(texture));
+}
+
+TextureHandle Device::CreateStreamingTexture(std::uint32_t width, std::uint32_t height, std::uint32_t mipLevels, TextureFormat format, const MipSource& source) {
+    if (!source) throw std::runtime_error("The mip source is empty");
+    Texture texture;
+    texture.extent      = vk::Extent3D(width, height, 1);
+    texture.mipLevels   = std::max(mipLevels, 1u);
+    texture.format      = format;
+    texture.source      = source;
+    texture.residentMip = texture.mipLevels - 1;
+    std::tie(texture.image, texture.view) = pImpl->CreateTextureImage(GetMipExtent(texture.extent, texture.residentMip), 1, format);
+    pImpl->UploadMipChain(texture, *texture.image.image, texture.residentMip);
+    texture.descriptor = pImpl->descriptors->AddImage(*texture.view, vk::ImageLayout::eShaderReadOnlyOptimal);
+    std::vector<std::size_t> mipSizes;
+    for (std::uint32_t level = 0; level < texture.mipLevels; ++level) {
+        auto extent = GetMipExtent(texture.extent, level);
+        mipSizes.push_back(extent.width * extent.height * GetTexelSize(format));
+    }
+    auto handle = pImpl->textures.Add(std::move(texture));
+    pImpl->scheduler.Add(handle, std::move(mipSizes));
+    return static_cast<TextureHandle>(handle);
+}
+
+void Device::RequestTextureMip(TextureHandle texture, std::uint32_t mipLevel, float priority) {
+    pImpl->scheduler.Request(std::to_underlying(texture), mipLevel, priority);
+}
+
+std::uint32_t Device::GetResidentMip(TextureHandle texture) {
+    auto& target = pImpl->textures.Get(std::to_underlying(texture));
+    if (!target.source) throw std::runtime_error("The texture is not streamed");
+    return target.residentMip;
+}
+
+StreamingStats Device::GetStreamingStats(void) {
+    return pImpl->streamingStats;
+}
+
+SamplerHandle Device::CreateSampler(const SamplerDesc& desc) {
+    auto filter  = desc.filter == SamplerFilter::Nearest ? vk::Filter::eNearest : vk::Filter::eLinear;
+    auto mipmap  = desc.filter == SamplerFilter::Nearest ? vk::SamplerMipmapMode::eNearest : vk::SamplerMipmapMode::eLinear;
+    auto address = vk::SamplerAddressMode::eRepeat;
+    if (desc.address == SamplerAddress::MirroredRepeat) address = vk::SamplerAddressMode::eMirroredRepeat;
+    if (desc.address == SamplerAddress::ClampToEdge   ) address = vk::SamplerAddressMode::eClampToEdge;
+    auto anisotropy = std::min(desc.anisotropy, pImpl->phyDevice.getProperties().limits.maxSamplerAnisotropy);
+    vk::SamplerCreateInfo info(vk::SamplerCreateFlags(), filter, filter, mipmap, address, address, address);
+    info.anisotropyEnable = anisotropy > 1.0f && pImpl->samplerAnisotropy ? VK_TRUE : VK_FALSE;
+    info.maxAnisotropy    = info.anisotropyEnable ? anisotropy : 1.0f;
+    info.maxLod           = VK_LOD_CLAMP_NONE;
+    SamplerResource resource;
+    resource.sampler    = pImpl->lgcDevice->createSamplerUnique(info);
+    resource.descriptor = pImpl->descriptors->AddSampler(*resource.sampler);
+    return static_cast<SamplerHandle>(pImpl->samplers.Add(std::move(resource)));
+}
+
+void Device::DestroySampler(SamplerHandle sampler) {
+    auto& target = pImpl->samplers.Get(std::to_underlying(sampler));
+    pImpl->descriptors->Free(DescriptorKind::Sampler, target.descriptor, pImpl->GetRetireValue());
+    pImpl->Retire(std::move(target.sampler));
+    pImpl->samplers.Remove(std::to_underlying(sampler));
+}
+
+std::uint32_t Device::GetBindlessIndex(TextureHandle texture) {
+    return pImpl->textures.Get(std::to_underlying(texture)).descriptor;
+}
+
+std::uint32_t Device::GetBindlessIndex(BufferHandle buffer) {
+    auto& target = pImpl->buffers.Get(std::to_underlying(buffer));
+    if (!target.descriptor) throw std::runtime_error("The buffer is not a storage buffer");
+    return *target.descriptor;
+}
+
+std::uint32_t Device::GetBindlessIndex(SamplerHandle sampler) {
+    return pImpl->samplers.Get(std::to_underlying(sampler)).descriptor;
+}
+
+std::any Device::GetBindlessLayout(void) {
+    return pImpl->descriptors->GetPipelineLayout();
+}
+
+std::any Device::LoadShader(const std::filesystem::path& path) {
+    return pImpl->shaders->Load(path);
+}
+
+IndirectHandle Device::CreateIndirectBatch(const IndirectBatchDesc& desc) {
+    if (!pImpl->indirectCount) throw std::runtime_error("The GPU does not support drawing with an indirect count");
+    if (desc.maxDraws > pImpl->phyDevice.getProperties().limits.maxDrawIndirectCount) throw std::runtime_error("The indirect batch has too many draws");
+    std::array families{ pImpl->topology.graphicsFamily, pImpl->topology.computeFamily };
+    auto batch = std::make_unique<IndirectBatch>(*pImpl->lgcDevice, *pImpl->allocator, *pImpl->descriptors, pImpl->pipelineCache->Get(),
+                                                 std::span(families).first(families[0] != families[1] ? 2 : 1), pImpl->frames.size(),
+                                                 pImpl->shaders->Load(desc.cullShader), desc.maxDraws, desc.workgroupSize);
+    return static_cast<IndirectHandle>(pImpl->indirectBatches.Add(std::move(batch)));
+}
+
+void Device::DestroyIndirectBatch(IndirectHandle batch) {
+    pImpl->Retire(std::move(pImpl->indirectBatches.Get(std::to_underlying(batch))));
+    pImpl->indirectBatches.Remove(std::to_underlying(batch));
+}
+
+void Device::CullIndirectBatch(IndirectHandle batch, std::uint32_t instanceCount, std::span<const std::byte> constants) {
+    STARLIGHT_ZONE("Cull");
+    if (!pImpl->frameBegun) throw std::runtime_error("The frame has not begun");
+    auto& target = *pImpl->indirectBatches.Get(std::to_underlying(batch));
+    if (!pImpl->imageIndex) return;
+    auto commandBuffer = pImpl->BeginCompute();
+    auto zone = pImpl->profiler ? pImpl->profiler->Begin(commandBuffer, pImpl->topology.computeFamily, "compute", "cull") : std::nullopt;
+    target.RecordCull(commandBuffer, pImpl->frameIndex, pImpl->frameSerial, instanceCount, constants);
+    if (pImpl->profiler) pImpl->profiler->End(commandBuffer, zone);
+}
+
+void Device::DrawIndirectBatch(IndirectHandle batch, BufferHandle indexBuffer, std::any commandBuffer) {
+    const auto& target = *pImpl->indirectBatches.Get(std::to_underlying(batch));
+    auto buffer = *pImpl->buffers.Get(std::to_underlying(indexBuffer)).buffer.buffer;
+    auto commandBufferGraphics = std::any_cast<vk::CommandBuffer>(commandBuffer);
+    commandBufferGraphics.bindIndexBuffer(buffer, 0, vk::IndexType::eUint32);
+    target.RecordDraw(commandBufferGraphics, pImpl->frameIndex, pImpl->frameSerial);
+}
+
+UploadToken Device::UploadBuffer(BufferHandle buffer, std::size_t offset, std::span<const std::byte> data) {
+    auto& target = pImpl->buffers.Get(std::to_underlying(buffer));
+    if (offset > target.size || data.size() > target.size - offset) throw std::runtime_error("The upload exceeds the buffer");
+    return pImpl->uploader->CopyBuffer(*target.buffer.buffer, offset, data);
+}
+
+UploadToken Device::UploadTexture(TextureHandle texture, std::uint32_t mipLevel, std::span<const std::byte> data) {
+    auto& target = pImpl->textures.Get(std::to_underlying(texture));
+    if (target.source) throw std::runtime_error("The texture is streamed");
+    if (mipLevel >= target.mipLevels) throw std::runtime_error("The mip level exceeds the texture");
+    auto extent = GetMipExtent(target.extent, mipLevel);
+    if (data.size() != extent.width * extent.height * GetTexelSize(target.format)) throw std::runtime_error("The upload does not match the mip level");
+    vk::ImageSubresourceLayers subresource(vk::ImageAspectFlagBits::eColor, mipLevel, 0, 1);
+    return pImpl->uploader->CopyImage(*target.image.image, subresource, extent, data, vk::ImageLayout::eShaderReadOnlyOptimal);
+}
+
+UploadToken Device::FlushUploads(void) {
+    return pImpl->uploader->Flush();
+}
+
+bool Device::IsUploadComplete(UploadToken token) {
+    return pImpl->uploader->IsComplete(token);
+}
+
+void Device::WaitUpload(UploadToken token) {
+    pImpl->uploader->Wait(token);
+}
+
+void Device::BeginFrame(float r, float g, float b) {
+    pImpl->BeginFrame(r, g, b, 1.0f);
+}
+
+void Device::Record(std::size_t count, const RecordCallback& record, std::span<const PassImage> samples) {
+    pImpl->RecordParallel(count, record, samples);
+}
+
+FrameData Device::AllocateFrameData(std::size_t size, std::size_t alignment) {
+    if (!pImpl->frameBegun) throw std::runtime_error("The frame has not begun");
+    std::lock_guard lock(pImpl->frameDataMutex);
+    auto range = pImpl->frames[pImpl->frameIndex].arena->Allocate(size, alignment);
+    return { std::span(static_cast<std::byte*>(range.mapped), size), range.buffer, static_cast<std::size_t>(range.offset) };
+}
+
+PassImage Device::CreatePassImage(const PassImageDesc& desc) {
+    return pImpl->CreatePassImage(desc);
+}
+
+std::uint32_t Device::GetBindlessIndex(PassImage image) {
+    return pImpl->GetPassImageIndex(image);
+}
+
+void Device::AddPass(const std::string& name, const PassDesc& desc, const PassCallback& record) {
+    pImpl->AddPass(name, desc, record);
+}
+
+TransientStats Device::GetTransientStats(void) {
+    return pImpl->transientStats;
+}
+
+void Device::EndFrame(void) {
+    pImpl->EndFrame();
+}
+
+void Device::SetReadbackCallback(const ReadbackCallback& readback) {
+    pImpl->readback = readback;
+}
+
+void Device::FinishFrames(void) {
+    pImpl->FinishFrames();
+}
+
+std::vector<FrameTiming> Device::TakeFrameTimings(void) {
+    std::vector<FrameTiming> timings(std::make_move_iterator(pImpl->timings.begin()), std::make_move_iterator(pImpl->timings.end()));
+    pImpl->timings.clear();
+    return timings;
+}
+
 void Device::Clear(float r, float g, float b) {
-    pImpl->Clear(r, g, b, 1.0f);
+    BeginFrame(r, g, b);
+    EndFrame();
 }
 
 } // namespace Starlight::Core
@@ -26,11 +26,296 @@
 #ifndef STARLIGHT_CORE_DEVICE_HPP
 #define STARLIGHT_CORE_DEVICE_HPP
 
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+#include "profiler.hpp"
 #include "window.hpp"
 
 namespace Starlight::Core {
 
+/**
+ * @brief Latency policy of the presentation.
+ *
+ * This enumeration describes how rendered images are handed over to the display.
+ * If the surface does not support the requested policy, the device falls back to the nearest supported one.
+ * VSync is always supported.
+ */
+enum class PresentPolicy {
+    VSync,       ///< Wait for the vertical blank and queue every image (no tearing, highest latency).
+    Mailbox,     ///< Wait for the vertical blank but replace the queued image (no tearing, low latency).
+    Immediate,   ///< Present without waiting for the vertical blank (tearing, lowest latency).
+    FifoRelaxed, ///< Wait for the vertical blank unless the frame is late (tearing only when late).
+};
+
+/**
+ * @brief Handle of a buffer owned by the GPU device.
+ */
+enum class BufferHandle : std::uint32_t {};
+
+/**
+ * @brief Handle of a texture owned by the GPU device.
+ */
+enum class TextureHandle : std::uint32_t {};
+
+/**
+ * @brief Handle of a sampler owned by the GPU device.
+ */
+enum class SamplerHandle : std::uint32_t {};
+
+/**
+ * @brief Handle of an indirect batch owned by the GPU device.
+ */
+enum class IndirectHandle : std::uint32_t {};
+
+/**
+ * @brief Filter of a sampler.
+ */
+enum class SamplerFilter {
+    Nearest, ///< Sample the nearest texel and mip level.
+    Linear,  ///< Interpolate between the texels and the mip levels.
+};
+
+/**
+ * @brief Addressing mode of a sampler outside the texture.
+ */
+enum class SamplerAddress {
+    Repeat,         ///< Tile the texture.
+    MirroredRepeat, ///< Tile the texture, mirrored every other tile.
+    ClampToEdge,    ///< Repeat the texels at the edge.
+};
+
+/**
+ * @brief A structure to hold the description of a sampler.
+ */
+struct SamplerDesc final {
+    SamplerFilter  filter     = SamplerFilter::Linear;   ///< The filter for magnification, minification and mip levels.
+    SamplerAddress address    = SamplerAddress::Repeat;  ///< The addressing mode of all coordinates.
+    float          anisotropy = 0.0f;                    ///< The maximum anisotropy, or 0 to disable anisotropic filtering.
+};
+
+/**
+ * @brief A structure to hold the description of an indirect batch.
+ */
+struct IndirectBatchDesc final {
+    std::span<const std::uint32_t> cullShader;         ///< The SPIR-V code of the culling compute shader, see CreateIndirectBatch.
+    std::uint32_t                  maxDraws      = 0;  ///< The capacity of the draw list.
+    std::uint32_t                  workgroupSize = 64; ///< The local size of the culling shader, specialized through the constant with ID 0.
+};
+
+/**
+ * @brief Completion token of an upload.
+ *
+ * Tokens increase monotonically, so an upload with a smaller token completes no later than one with a larger token.
+ */
+using UploadToken = std::uint64_t;
+
+/**
+ * @brief Usage of a buffer.
+ *
+ * The values can be combined with the `|` operator.
+ */
+enum class BufferUsage : std::uint32_t {
+    Vertex   = 1 << 0, ///< The buffer is used as a vertex buffer.
+    Index    = 1 << 1, ///< The buffer is used as an index buffer.
+    Uniform  = 1 << 2, ///< The buffer is used as a uniform buffer.
+    Storage  = 1 << 3, ///< The buffer is used as a storage buffer, shared by the graphics, compute and transfer queues.
+    Indirect = 1 << 4, ///< The buffer is used as an indirect command buffer.
+};
+
+/**
+ * @brief Combine two buffer usages.
+ *
+ * @param lhs The first usage.
+ * @param rhs The second usage.
+ *
+ * @return The combined usage.
+ */
+constexpr BufferUsage operator|(BufferUsage lhs, BufferUsage rhs) {
+    return static_cast<BufferUsage>(static_cast<std::uint32_t>(lhs) | static_cast<std::uint32_t>(rhs));
+}
+
+/**
+ * @brief Format of a texture.
+ */
+enum class TextureFormat {
+    R8Unorm,     ///< 8-bit single channel, normalized.
+    RGBA8Unorm,  ///< 8-bit four channels, normalized.
+    RGBA8Srgb,   ///< 8-bit four channels, sRGB encoded.
+    RGBA16Float, ///< 16-bit four channels, floating point.
+};
+
+/**
+ * @brief Handle of a transient image declared for the current frame.
+ *
+ * The handle is only valid until the frame ends.
+ */
+enum class PassImage : std::uint32_t {};
+
+/**
+ * @brief A structure to hold the description of a transient image of a frame.
+ *
+ * Transient images are owned by the render graph of the device, and those whose passes do not overlap share the same memory.
+ */
+struct PassImageDesc final {
+    TextureFormat format = TextureFormat::RGBA8Unorm; ///< The format of a color image, ignored for a depth image.
+    bool          depth  = false;                     ///< Whether the image is a depth image in the depth format chosen from the options.
+    std::uint32_t width  = 0;                         ///< The width of the image, or 0 for the width of the render target.
+    std::uint32_t height = 0;                         ///< The height of the image, or 0 for the height of the render target.
+};
+
+/**
+ * @brief A structure to hold the declaration of a pass of a frame.
+ */
+struct PassDesc final {
+    std::span<const PassImage> colors  = {};   ///< The color attachments, in the order of the fragment shader outputs.
+    std::optional<PassImage>   depth   = {};   ///< The depth attachment, if any.
+    std::span<const PassImage> samples = {};   ///< The images that the fragment shaders sample, written by earlier passes.
+    bool                       clear   = true; ///< Whether the attachments are cleared to zero and the depth to one, instead of keeping their contents.
+};
+
+/**
+ * @brief A structure to hold the queue topology of the GPU device.
+ *
+ * This structure describes which queue family and queue each kind of work is submitted to.
+ * Dedicated families are preferred, so transfers run on the copy engine and compute runs asynchronously to graphics.
+ * If the hardware lacks them, the work falls back to a shared family or even to the same queue.
+ */
+struct QueueTopology final {
+    std::uint32_t graphicsFamily;    ///< The queue family index of the graphics queue.
+    std::uint32_t computeFamily;     ///< The queue family index of the compute queue.
+    std::uint32_t transferFamily;    ///< The queue family index of the transfer queue.
+    std::uint32_t graphicsIndex;     ///< The queue index of the graphics queue in its family.
+    std::uint32_t computeIndex;      ///< The queue index of the compute queue in its family.
+    std::uint32_t transferIndex;     ///< The queue index of the transfer queue in its family.
+    bool          dedicatedCompute;  ///< Whether the compute family lacks graphics support (async compute).
+    bool          dedicatedTransfer; ///< Whether the transfer family lacks graphics and compute support (DMA engine).
+    bool          sharedCompute;     ///< Whether the compute queue is the same queue as the graphics queue.
+    bool          sharedTransfer;    ///< Whether the transfer queue is the same queue as the graphics or compute queue.
+};
+
+/**
+ * @brief Kind of a GPU.
+ */
+enum class GpuType {
+    Other,      ///< A GPU of an unknown kind.
+    Integrated, ///< A GPU embedded in or tightly coupled with the host.
+    Discrete,   ///< A GPU on a separate card.
+    Virtual,    ///< A virtual GPU in a virtualized environment.
+    Cpu,        ///< A software implementation running on the host.
+};
+
+/**
+ * @brief The PCI address of a GPU.
+ */
+struct PciAddress final {
+    std::uint32_t domain;   ///< The PCI domain.
+    std::uint32_t bus;      ///< The PCI bus.
+    std::uint32_t device;   ///< The PCI device.
+    std::uint32_t function; ///< The PCI function.
+};
+
+/**
+ * @brief A structure to describe a GPU.
+ *
+ * This structure describes a GPU that is suitable for a Device.
+ * It is passed to the scoring function of the GPU selection.
+ */
+struct GpuInfo final {
+    std::size_t               index;         ///< The index of the GPU in the enumeration order.
+    std::string               name;          ///< The name of the GPU.
+    std::uint32_t             vendorID;      ///< The PCI vendor ID.
+    std::uint32_t             deviceID;      ///< The PCI device ID.
+    GpuType                   type;          ///< The kind of the GPU.
+    std::uint64_t             deviceMemory;  ///< The total size of the device local memory heaps.
+    std::uint32_t             driverVersion; ///< The version of the driver, encoded in a vendor-specific way.
+    std::optional<PciAddress> pciAddress;    ///< The PCI address, if the driver reports it.
+};
+
+/**
+ * @brief Function type to score a GPU.
+ *
+ * The suitable GPU with the highest score is chosen, and a GPU with a negative score is never chosen.
+ *
+ * Signature:
+ * @code
+ * std::int64_t score(const GpuInfo& info);
+ * @endcode
+ *
+ * @param info The description of the GPU.
+ *
+ * @return The score of the GPU.
+ */
+using GpuScorer = std::function<std::int64_t(const GpuInfo&)>;
+
+/**
+ * @brief Score a GPU with the default heuristic.
+ *
+ * Discrete GPUs rank above integrated GPUs, which rank above the others,
+ * and GPUs of the same kind are ranked by the size of their device local memory.
+ *
+ * @param info The description of the GPU.
+ *
+ * @return The score of the GPU, which is never negative.
+ */
+std::int64_t DefaultGpuScore(const GpuInfo& info);
+
+/**
+ * @brief A structure to hold the state of the texture streaming.
+ */
+struct StreamingStats final {
+    std::size_t residentBytes;   ///< The number of bytes that the resident mip levels of the streamed textures occupy.
+    std::size_t budgetBytes;     ///< The number of bytes that the streamed textures may occupy in the last frame.
+    std::size_t uploadedBytes;   ///< The number of bytes scheduled for upload in the last frame.
+    std::size_t pendingTextures; ///< The number of streamed textures whose uploads are in flight.
+};
+
+/**
+ * @brief A structure to hold the memory of the transient images of a frame.
+ */
+struct TransientStats final {
+    std::size_t requestedBytes; ///< The number of bytes that the transient images of the last frame would occupy without aliasing.
+    std::size_t allocatedBytes; ///< The number of bytes that they occupy, with the images whose passes do not overlap sharing memory.
+};
+
+/**
+ * @brief A structure to hold a range of the per-frame data.
+ */
+struct FrameData final {
+    std::span<std::byte> data;   ///< The host memory of the range, which the GPU reads without a flush.
+    std::any             buffer; ///< A `std::any` object holding the `vk::Buffer` of the range.
+    std::size_t          offset; ///< The offset of the range in the buffer.
+};
+
+/**
+ * @brief A structure to hold the options of the GPU device.
+ *
+ * This structure contains the parameters used to initialize the GPU device.
+ * Every member has a default value, so only the options of interest need to be set.
+ */
+struct DeviceOptions final {
+    std::size_t           framesInFlight = 2;                    ///< The number of frames that the CPU may record ahead of the GPU (clamped to 1 or more).
+    PresentPolicy         presentPolicy  = PresentPolicy::VSync; ///< The requested latency policy of the swapchain.
+    std::size_t           imageCount     = 2;                    ///< The requested number of swapchain images (clamped to the surface limits).
+    std::size_t           stagingSize    = 64 << 20;             ///< The size of the staging ring buffer used for uploads.
+    std::filesystem::path cacheDirectory = "cache";              ///< The directory to persist the pipeline cache and the GPU selection in, or empty to disable persistence.
+    std::uint32_t         offscreenWidth  = 1280;                ///< The width of the offscreen images rendered without a window.
+    std::uint32_t         offscreenHeight = 720;                 ///< The height of the offscreen images rendered without a window.
+    GpuScorer             gpuScorer;                             ///< The function to score the GPUs, or empty to use DefaultGpuScore.
+    std::uint32_t         depthBits       = 24;                  ///< The minimum number of bits of the depth buffer, for the cheapest supported depth format that has them.
+    bool                  stencil         = false;               ///< Whether the depth buffer needs a stencil aspect.
+    bool                  profiling       = false;               ///< Whether to measure the CPU and GPU time of the frames, see Device::TakeFrameTimings.
+    std::size_t           streamingFrameBytes = 16 << 20;        ///< The number of bytes that the texture streaming may upload per frame (at most the staging size).
+    float                 streamingBudget     = 0.5f;            ///< The fraction of the device local memory that the streamed textures may occupy.
+};
+
 /**
  * @brief Manage the GPU device.
  *
@@ -40,13 +325,22 @@ namespace Starlight::Core {
  * Usage:
  * - Create an instance of Device with or without a window.
  * - If a window is provided, the device will be associated with the window for rendering.
- * - If no window is provided (or nullptr is passed), the device can be used for computations but not for rendering to a window.
+ * - If no window is provided (or nullptr is passed), the device renders into a ring of offscreen images instead of a swapchain,
+ *   one per frame in flight, and reads every frame back to host memory on the transfer queue. The windowing system is never initialized.
+ * - The GPU chosen by the default scorer is remembered in the cache directory, and reused while the same GPUs and drivers are present.
+ * - Call Preload before creating the window to create the instance and choose the GPU in the meantime.
+ * - A frame may render transient images in passes added with AddPass, such as a G-buffer, which the main pass of Record then samples.
+ * - For compute-only batch work without graphics queues or render targets, use ComputeDevice instead.
  * - The destructor will automatically clean up the device resources when the object is destroyed.
  *
  * Example1:
  * @code{.cpp}
- * Starlight::Core::Device device;
- * // Use the device for computations...
+ * Starlight::Core::Device device(nullptr, { .framesInFlight = 8, .offscreenWidth = 1920, .offscreenHeight = 1080 });
+ * device.SetReadbackCallback([](std::uint64_t frame, std::span<const std::byte> pixels) {
+ *     // Encode or store the pixels of the frame...
+ * });
+ * for (int i = 0; i < 1000; ++i) device.Clear(0.0f, 0.0f, 0.0f);
+ * device.FinishFrames();
  * @endcode
  *
  * Example2:
@@ -55,9 +349,71 @@ namespace Starlight::Core {
  * Starlight::Core::Device device(window);
  * // Use the device for computations and rendering to the window...
  * @endcode
+ *
+ * Example3:
+ * @code{.cpp}
+ * Starlight::Core::DeviceOptions options;
+ * options.gpuScorer = [](const Starlight::Core::GpuInfo& info) -> std::int64_t {
+ *     return info.pciAddress && info.pciAddress->bus == 3 ? 0 : -1;
+ * };
+ * Starlight::Core::Device device(nullptr, options);
+ * // Use the device on the GPU at PCI bus 3...
+ * @endcode
  */
 class Device final {
 public:
+    /**
+     * @brief Callback function type for recording commands.
+     *
+     * This callback function is called on a worker thread to record a part of the frame.
+     * It receives the index of the part and the platform-specific command buffer as parameters.
+     * The command buffer is a secondary command buffer that continues the dynamic rendering of the frame,
+     * which has one color attachment in the format of the target and a depth attachment in the format chosen from the options,
+     * and is held by a `std::any` object in the same way as Window::GetHandle.
+     *
+     * Signature:
+     * @code
+     * void record(std::size_t index, std::any commandBuffer);
+     * @endcode
+     *
+     * @param index         The index of the part, between 0 and the requested count.
+     * @param commandBuffer The command buffer to record into.
+     */
+    using RecordCallback = std::function<void(std::size_t, std::any)>;
+
+    /**
+     * @brief Callback function type for reading back offscreen frames.
+     *
+     * This callback function is called when an offscreen frame has been copied to host memory.
+     * It receives the sequence number of the frame, counted from 0, and the tightly packed RGBA8 pixels of the frame.
+     * The pixels are only valid during the call.
+     *
+     * Signature:
+     * @code
+     * void readback(std::uint64_t frame, std::span<const std::byte> pixels);
+     * @endcode
+     *
+     * @param frame  The sequence number of the frame.
+     * @param pixels The pixels of the frame.
+     */
+    using ReadbackCallback = std::function<void(std::uint64_t, std::span<const std::byte>)>;
+
+    /**
+     * @brief Callback function type for recording a pass.
+     *
+     * This callback function is called by EndFrame while the rendering of the pass is active,
+     * with the bindless descriptor set bound for graphics.
+     * The command buffer is the primary command buffer of the frame, held by a `std::any` object in the same way as RecordCallback.
+     *
+     * Signature:
+     * @code
+     * void record(std::any commandBuffer);
+     * @endcode
+     *
+     * @param commandBuffer The command buffer to record into.
+     */
+    using PassCallback = std::function<void(std::any)>;
+
     /**
      * @brief Construct a new Device object.
      *
@@ -82,11 +438,653 @@ public:
      */
     Device(SharedWindow window);
 
+    /**
+     * @brief Construct a new Device object.
+     *
+     * This constructor initializes the GPU device for operation with a window and the given options.
+     * If the window is null, the device will be set up for headless operation.
+     * If the device fails to initialize, a `std::runtime_error` exception is thrown.
+     *
+     * @param window  The window to render to, or null for headless operation.
+     * @param options The options of the device.
+     *
+     * @throw std::runtime_error If the device fails to initialize.
+     */
+    Device(SharedWindow window, const DeviceOptions& options);
+
     /**
      * @brief Destruct the Device object.
      */
     ~Device();
 
+    /**
+     * @brief Start initializing a Device in the background.
+     *
+     * This function creates the Vulkan instance and chooses the GPU on a worker thread,
+     * so the work overlaps with the creation of the window and the loading of the assets.
+     * The next Device constructed takes over the result if the presence of its window and the cache directory match, and waits for it if it is not ready yet.
+     * The result is discarded instead if either the Preload or the Device is given a scoring function, since two scorers cannot be compared.
+     * This function must be called on the main thread, because it initializes the windowing system for a windowed device.
+     * It does nothing if a background initialization is already pending.
+     *
+     * Example:
+     * @code{.cpp}
+     * Starlight::Core::Device::Preload(true);
+     * auto window = Starlight::Core::CreateSharedWindow("My Window", 1280, 720, true);
+     * Starlight::Core::Device device(window);
+     * @endcode
+     *
+     * @param windowed Whether the Device will be constructed with a window.
+     * @param options  The options of the Device.
+     */
+    static void Preload(bool windowed, const DeviceOptions& options = DeviceOptions());
+
+    /**
+     * @brief Enumerate the GPUs suitable for a Device.
+     *
+     * This function lists every GPU that supports the required Vulkan version and queues, in the enumeration order.
+     * The presentation support is not checked, so a GPU listed here may not be able to render to a window.
+     *
+     * @return The descriptions of the GPUs.
+     *
+     * @throw std::runtime_error If the Vulkan instance fails to create.
+     */
+    static std::vector<GpuInfo> EnumerateGpus(void);
+
+    /**
+     * @brief Create a headless Device object per GPU.
+     *
+     * This function creates a headless device on every suitable GPU that the scoring function of the options does not reject.
+     * The devices are independent, so the work can be distributed across them, for example one job per device.
+     *
+     * Example:
+     * @code{.cpp}
+     * auto devices = Starlight::Core::Device::CreateHeadlessDevices({ .framesInFlight = 8 });
+     * Starlight::Core::Job::ParallelFor(devices.size(), [&](std::size_t index) {
+     *     // Render a share of the frames on devices[index]...
+     * });
+     * @endcode
+     *
+     * @param options The options of the devices.
+     *
+     * @return The devices, in the enumeration order of the GPUs.
+     *
+     * @throw std::runtime_error If no device is created or a device fails to initialize.
+     */
+    static std::vector<std::unique_ptr<Device>> CreateHeadlessDevices(const DeviceOptions& options);
+
+    /**
+     * @brief Get the description of the GPU of this device.
+     *
+     * @return The description of the GPU.
+     */
+    GpuInfo GetGpuInfo(void);
+
+    /**
+     * @brief Reconfigure the swapchain.
+     *
+     * This method recreates the swapchain with the requested latency policy and number of images.
+     * The policy is negotiated against the present modes that the surface supports,
+     * and the number of images is clamped to the limits of the surface.
+     * The old swapchain is retired without waiting for the GPU to become idle.
+     * If the device has no window or a frame has begun, a `std::runtime_error` exception is thrown.
+     *
+     * @param policy     The requested latency policy.
+     * @param imageCount The requested number of swapchain images.
+     *
+     * @throw std::runtime_error If the device has no window, a frame has begun or the swapchain fails to create.
+     */
+    void ConfigureSwapchain(PresentPolicy policy, std::size_t imageCount);
+
+    /**
+     * @brief Get the latency policy of the swapchain.
+     *
+     * This method returns the policy that was actually negotiated, which may differ from the requested one.
+     *
+     * @return The negotiated latency policy.
+     */
+    PresentPolicy GetPresentPolicy(void);
+
+    /**
+     * @brief Get the number of swapchain images.
+     *
+     * This method returns the number of images that the swapchain actually owns.
+     * It returns 0 if the device has no window.
+     *
+     * @return The number of swapchain images.
+     */
+    std::size_t GetImageCount(void);
+
+    /**
+     * @brief Get the queue topology of the device.
+     *
+     * This method returns which queue families and queues the device submits graphics, compute and transfer work to.
+     *
+     * @return The queue topology.
+     */
+    QueueTopology GetQueueTopology(void);
+
+    /**
+     * @brief Create a buffer.
+     *
+     * This method creates a buffer in device local memory.
+     * The contents of the buffer are undefined until uploaded.
+     *
+     * @param size  The size of the buffer in bytes.
+     * @param usage The usage of the buffer.
+     *
+     * @return The handle of the buffer.
+     *
+     * @throw std::runtime_error If the buffer fails to create.
+     */
+    BufferHandle CreateBuffer(std::size_t size, BufferUsage usage);
+
+    /**
+     * @brief Destroy a buffer.
+     *
+     * The buffer is destroyed once the GPU has finished the work submitted so far and the frame being recorded, and this method does not wait.
+     *
+     * @param buffer The handle of the buffer.
+     */
+    void DestroyBuffer(BufferHandle buffer);
+
+    /**
+     * @brief Create a texture.
+     *
+     * This method creates a 2D texture in device local memory that can be sampled by shaders.
+     * The contents of the texture are undefined until uploaded.
+     *
+     * @param width     The width of the texture.
+     * @param height    The height of the texture.
+     * @param mipLevels The number of mip levels of the texture.
+     * @param format    The format of the texture.
+     *
+     * @return The handle of the texture.
+     *
+     * @throw std::runtime_error If the texture fails to create.
+     */
+    TextureHandle CreateTexture(std::uint32_t width, std::uint32_t height, std::uint32_t mipLevels, TextureFormat format);
+
+    /**
+     * @brief Destroy a texture.
+     *
+     * The texture is destroyed once the GPU has finished the work submitted so far and the frame being recorded, and this method does not wait.
+     *
+     * @param texture The handle of the texture.
+     */
+    void DestroyTexture(TextureHandle texture);
+
+    /**
+     * @brief Function type to provide the texels of a mip level of a streamed texture.
+     *
+     * This function is called on the thread that begins a frame whenever a mip level needs to be uploaded.
+     * The returned texels must be tightly packed and stay valid until the function is called again.
+     *
+     * Signature:
+     * @code
+     * std::span<const std::byte> source(std::uint32_t mipLevel);
+     * @endcode
+     *
+     * @param mipLevel The mip level to provide.
+     *
+     * @return The texels of the mip level.
+     */
+    using MipSource = std::function<std::span<const std::byte>(std::uint32_t)>;
+
+    /**
+     * @brief Create a streamed texture.
+     *
+     * This method creates a texture whose resident mip levels follow the requests of RequestTextureMip.
+     * Only the coarsest mip level is uploaded at first.
+     * At the start of each frame, the most important requested mip levels are uploaded within `streamingFrameBytes`,
+     * and the least important textures are demoted when the streamed textures exceed their residency budget.
+     * The budget is `streamingBudget` of the device local memory, and is lowered to what the driver reports as available
+     * if `VK_EXT_memory_budget` is supported.
+     * A change of the resident mip levels reallocates the image with the new mip chain and uploads all of its levels,
+     * so the view of the texture changes when the uploads complete, and the old image is destroyed once the frames that use it have retired.
+     * The texture cannot be uploaded with UploadTexture.
+     *
+     * @param width     The width of the texture.
+     * @param height    The height of the texture.
+     * @param mipLevels The number of mip levels of the texture.
+     * @param format    The format of the texture.
+     * @param source    The function to provide the texels of the mip levels.
+     *
+     * @return The handle of the texture.
+     *
+     * @throw std::runtime_error If the texture fails to create or the source provides texels of the wrong size.
+     */
+    TextureHandle CreateStreamingTexture(std::uint32_t width, std::uint32_t height, std::uint32_t mipLevels, TextureFormat format, const MipSource& source);
+
+    /**
+     * @brief Request a mip level of a streamed texture for the current frame.
+     *
+     * The renderer should call this method every frame for each streamed texture it samples, for example from the mip feedback of the previous frame.
+     * The priority of a texture that is not requested decays every frame.
+     * This method is thread safe, so it may be called from Record callbacks.
+     *
+     * @param texture  The handle of the streamed texture.
+     * @param mipLevel The finest mip level that was sampled.
+     * @param priority The priority of the request, such as the screen coverage of the texture.
+     */
+    void RequestTextureMip(TextureHandle texture, std::uint32_t mipLevel, float priority);
+
+    /**
+     * @brief Get the finest resident mip level of a streamed texture.
+     *
+     * Level 0 of the view of the texture is this mip level, so shaders should offset the sampled level of detail by it.
+     *
+     * @param texture The handle of the streamed texture.
+     *
+     * @return The mip level.
+     *
+     * @throw std::runtime_error If the handle is invalid or the texture is not streamed.
+     */
+    std::uint32_t GetResidentMip(TextureHandle texture);
+
+    /**
+     * @brief Get the state of the texture streaming.
+     *
+     * @return The state of the texture streaming.
+     */
+    StreamingStats GetStreamingStats(void);
+
+    /**
+     * @brief Create a sampler.
+     *
+     * @param desc The description of the sampler.
+     *
+     * @return The handle of the sampler.
+     *
+     * @throw std::runtime_error If the sampler fails to create.
+     */
+    SamplerHandle CreateSampler(const SamplerDesc& desc);
+
+    /**
+     * @brief Destroy a sampler.
+     *
+     * The sampler is destroyed once the GPU has finished the work submitted so far and the frame being recorded, and this method does not wait.
+     *
+     * @param sampler The handle of the sampler.
+     */
+    void DestroySampler(SamplerHandle sampler);
+
+    /**
+     * @brief Get the bindless index of a texture.
+     *
+     * All textures are in the array of sampled images at `set = 0, binding = 0` of the bindless descriptor set,
+     * so a draw only passes the index, for example in push constants.
+     * The index of a streamed texture changes when its resident mip levels change, so it should be read every frame.
+     *
+     * @param texture The handle of the texture.
+     *
+     * @return The index of the texture.
+     *
+     * @throw std::runtime_error If the handle is invalid.
+     */
+    std::uint32_t GetBindlessIndex(TextureHandle texture);
+
+    /**
+     * @brief Get the bindless index of a storage buffer.
+     *
+     * The buffers created with BufferUsage::Storage are in the array at `set = 0, binding = 1`.
+     *
+     * @param buffer The handle of the buffer.
+     *
+     * @return The index of the buffer.
+     *
+     * @throw std::runtime_error If the handle is invalid or the buffer is not a storage buffer.
+     */
+    std::uint32_t GetBindlessIndex(BufferHandle buffer);
+
+    /**
+     * @brief Get the bindless index of a sampler.
+     *
+     * The samplers are in the array at `set = 0, binding = 2`.
+     *
+     * @param sampler The handle of the sampler.
+     *
+     * @return The index of the sampler.
+     *
+     * @throw std::runtime_error If the handle is invalid.
+     */
+    std::uint32_t GetBindlessIndex(SamplerHandle sampler);
+
+    /**
+     * @brief Get the pipeline layout of the bindless descriptor set.
+     *
+     * Pipelines must be created with this layout to use the bindless descriptors.
+     * It has the bindless descriptor set at `set = 0` and 128 bytes of push constants for all stages.
+     * The layout is returned as a `std::any` object holding a `vk::PipelineLayout`.
+     *
+     * @return A `std::any` object holding the pipeline layout.
+     */
+    std::any GetBindlessLayout(void);
+
+    /**
+     * @brief Load a shader module from a precompiled SPIR-V file.
+     *
+     * The file is memory-mapped while the module is created.
+     * Shader modules are deduplicated by their code, so loading the same code again returns the same module.
+     * The module is owned by the device, and is returned as a `std::any` object holding a `vk::ShaderModule`.
+     *
+     * @param path The path of the SPIR-V file, such as one compiled by the build from the `shaders` directory.
+     *
+     * @return A `std::any` object holding the shader module.
+     *
+     * @throw std::runtime_error If the file cannot be mapped or is not SPIR-V.
+     */
+    std::any LoadShader(const std::filesystem::path& path);
+
+    /**
+     * @brief Create an indirect batch.
+     *
+     * An indirect batch culls instances on the compute queue and draws the visible ones with a single indirect draw,
+     * so the CPU cost of a frame does not depend on the number of instances.
+     * The culling shader declares `layout(local_size_x_id = 0) in;` and uses the layout of GetBindlessLayout and reads the instances from storage buffers through their bindless indices.
+     * For each visible instance it appends a `VkDrawIndexedIndirectCommand` to the draw list with an atomic add on the draw count,
+     * and the `firstInstance` of the command is visible to the vertex shader as `gl_InstanceIndex`.
+     * The push constants begin with the bindless indices of the draw list and the draw count, the number of instances, and the capacity of the draw list,
+     * followed by up to 112 bytes of the constants passed to CullIndirectBatch:
+     *
+     * @code{.glsl}
+     * layout(push_constant) uniform Cull {
+     *     uint drawList;
+     *     uint drawCount;
+     *     uint instanceCount;
+     *     uint maxDraws;
+     *     uint user[28];
+     * };
+     * @endcode
+     *
+     * @param desc The description of the indirect batch.
+     *
+     * @return The handle of the indirect batch.
+     *
+     * @throw std::runtime_error If the GPU cannot draw with an indirect count, or the batch fails to create.
+     */
+    IndirectHandle CreateIndirectBatch(const IndirectBatchDesc& desc);
+
+    /**
+     * @brief Destroy an indirect batch.
+     *
+     * The batch is destroyed once the GPU has finished the work submitted so far and the frame being recorded, and this method does not wait.
+     *
+     * @param batch The handle of the indirect batch.
+     */
+    void DestroyIndirectBatch(IndirectHandle batch);
+
+    /**
+     * @brief Cull the instances of an indirect batch for the current frame.
+     *
+     * This method records the culling on the compute queue, which is submitted by EndFrame before the graphics queue,
+     * and the graphics queue waits for it before reading the draw list.
+     * It must be called between BeginFrame and EndFrame, and does nothing if the frame is skipped.
+     *
+     * @param batch         The handle of the indirect batch.
+     * @param instanceCount The number of instances to cull.
+     * @param constants     The constants of the culling shader, such as the frustum and the bindless indices of the instance buffers.
+     *
+     * @throw std::runtime_error If a frame has not begun, the handle is invalid, or the constants are larger than 112 bytes.
+     */
+    void CullIndirectBatch(IndirectHandle batch, std::uint32_t instanceCount, std::span<const std::byte> constants);
+
+    /**
+     * @brief Draw the instances of an indirect batch that survived the culling of the current frame.
+     *
+     * This method is called from a Record callback with its command buffer, after binding a graphics pipeline.
+     * The batch must have been culled in the frame with CullIndirectBatch, otherwise a `std::runtime_error` exception is thrown.
+     *
+     * @param batch         The handle of the indirect batch.
+     * @param indexBuffer   The handle of the index buffer, which holds 32-bit indices.
+     * @param commandBuffer The command buffer passed to the Record callback.
+     *
+     * @throw std::runtime_error If a handle is invalid or the batch has not been culled in the frame.
+     */
+    void DrawIndirectBatch(IndirectHandle batch, BufferHandle indexBuffer, std::any commandBuffer);
+
+    /**
+     * @brief Upload data to a buffer.
+     *
+     * This method copies the data into the staging buffer and records the copy on the transfer queue.
+     * The copies are submitted in batches at the start of each frame or by FlushUploads,
+     * and the buffer can be used by the GPU once the returned token is complete.
+     *
+     * @param buffer The handle of the destination buffer.
+     * @param offset The offset in the destination buffer.
+     * @param data   The data to upload.
+     *
+     * @return The completion token of the upload.
+     *
+     * @throw std::runtime_error If the handle is invalid.
+     */
+    UploadToken UploadBuffer(BufferHandle buffer, std::size_t offset, std::span<const std::byte> data);
+
+    /**
+     * @brief Upload data to a mip level of a texture.
+     *
+     * This method behaves like UploadBuffer, and overwrites the whole mip level with tightly packed texels.
+     *
+     * @param texture  The handle of the destination texture.
+     * @param mipLevel The mip level to overwrite.
+     * @param data     The texels to upload.
+     *
+     * @return The completion token of the upload.
+     *
+     * @throw std::runtime_error If the handle is invalid, the texture is streamed, or the data is larger than the staging buffer.
+     */
+    UploadToken UploadTexture(TextureHandle texture, std::uint32_t mipLevel, std::span<const std::byte> data);
+
+    /**
+     * @brief Submit the pending uploads.
+     *
+     * @return The completion token of the submitted uploads.
+     */
+    UploadToken FlushUploads(void);
+
+    /**
+     * @brief Check if an upload is complete.
+     *
+     * @param token The completion token of the upload.
+     *
+     * @return true if the upload is complete, false otherwise.
+     */
+    bool IsUploadComplete(UploadToken token);
+
+    /**
+     * @brief Wait for an upload to complete.
+     *
+     * If the upload has not been submitted yet, it is submitted first.
+     *
+     * @param token The completion token of the upload.
+     */
+    void WaitUpload(UploadToken token);
+
+    /**
+     * @brief Begin a frame.
+     *
+     * This method waits for the frame slot to retire, acquires the next swapchain image,
+     * and begins the command buffer of the frame. The image is cleared with the given color when the frame ends.
+     * Without a window, the offscreen image of the frame slot is rendered to instead,
+     * and the readback of the frame that last used the slot is delivered first.
+     * If the window has been resized or the swapchain is out of date, the swapchain is recreated first,
+     * and the resources of the old swapchain are destroyed once the frames that use them have retired.
+     * If the window has no drawable area, for example while it is minimized, the frame is skipped:
+     * Record does not call its callback and EndFrame presents nothing.
+     * If a frame has already begun, a `std::runtime_error` exception is thrown.
+     *
+     * @param r The red component of the clear color.
+     * @param g The green component of the clear color.
+     * @param b The blue component of the clear color.
+     *
+     * @throw std::runtime_error If the frame fails to begin.
+     */
+    void BeginFrame(float r, float g, float b);
+
+    /**
+     * @brief Record a part of the frame on multiple threads.
+     *
+     * This method calls `record` for each index between 0 and `count` concurrently on the worker threads of the job system.
+     * Each call records into its own command buffer from its own command pool,
+     * and the command buffers are executed in the order of their indices, after the command buffers of any previous call in the frame.
+     * The bindless descriptor set is already bound for graphics in each command buffer, see GetBindlessLayout.
+     * The parts belong to the main pass, which renders to the target after the passes added with AddPass,
+     * and may sample the transient images given in `samples` through their bindless indices.
+     * The method returns after all calls have returned.
+     * If a frame has not begun, a `std::runtime_error` exception is thrown.
+     *
+     * @param count   The number of parts to record.
+     * @param record  The callback function to record a part.
+     * @param samples The transient images that the parts sample.
+     *
+     * @throw std::runtime_error If a frame has not begun or an image is invalid.
+     */
+    void Record(std::size_t count, const RecordCallback& record, std::span<const PassImage> samples = {});
+
+    /**
+     * @brief Allocate a range of the per-frame data.
+     *
+     * The range is host-visible memory of the current frame, such as uniforms, vertices or indirect commands written each frame,
+     * and can be bound as a uniform, storage, vertex, index or indirect buffer.
+     * It stays valid until the frame slot is reused by a later BeginFrame, after the GPU has finished with it, so no upload is needed.
+     * Each slot holds 4 MiB of data.
+     * It must be called between BeginFrame and EndFrame, and is thread safe, so it may be called from the Record callbacks.
+     *
+     * @param size      The size of the range in bytes.
+     * @param alignment The alignment of the offset in bytes, where 0 is treated as 1.
+     *
+     * @return The range.
+     *
+     * @throw std::runtime_error If a frame has not begun or the data of the frame is exhausted.
+     */
+    FrameData AllocateFrameData(std::size_t size, std::size_t alignment);
+
+    /**
+     * @brief Declare a transient image for the current frame.
+     *
+     * The image is created by the render graph when the frame ends, and its contents are undefined at the start of the frame.
+     * It must be called between BeginFrame and EndFrame, and returns a handle that is never used if the frame is skipped.
+     *
+     * @param desc The description of the image.
+     *
+     * @return The handle of the image.
+     *
+     * @throw std::runtime_error If a frame has not begun.
+     */
+    PassImage CreatePassImage(const PassImageDesc& desc);
+
+    /**
+     * @brief Get the bindless index of a transient image.
+     *
+     * The index can be used in the current frame by the passes that sample the image,
+     * and is written once the render graph has created the image, before those passes run.
+     * A depth image can only be sampled if the options request no stencil.
+     * It is not thread safe, so get the indices before Record rather than from its callbacks.
+     *
+     * @param image The handle of the image.
+     *
+     * @return The index of the image in the array at `binding = 0`.
+     *
+     * @throw std::runtime_error If a frame has not begun, the handle is invalid, or the image cannot be sampled.
+     */
+    std::uint32_t GetBindlessIndex(PassImage image);
+
+    /**
+     * @brief Add a pass to the current frame.
+     *
+     * The passes are recorded by EndFrame in the order they are added, before the main pass of Record,
+     * with the layout transitions and barriers derived from the declarations.
+     * A pass whose attachments are never sampled by a later pass or the main pass is culled and its callback is not called.
+     * It must be called between BeginFrame and EndFrame, and does nothing if the frame is skipped.
+     *
+     * Example:
+     * @code{.cpp}
+     * device.BeginFrame(0.0f, 0.0f, 0.0f);
+     * auto albedo = device.CreatePassImage({ .format = Starlight::Core::TextureFormat::RGBA8Unorm });
+     * auto normal = device.CreatePassImage({ .format = Starlight::Core::TextureFormat::RGBA16Float });
+     * auto depth  = device.CreatePassImage({ .depth = true });
+     * std::array gbuffer{ albedo, normal };
+     * device.AddPass("gbuffer", { .colors = gbuffer, .depth = depth }, [](std::any commandBuffer) { DrawScene(commandBuffer); });
+     * auto albedoIndex = device.GetBindlessIndex(albedo);
+     * device.Record(1, [&](std::size_t, std::any commandBuffer) { DrawLighting(commandBuffer, albedoIndex); }, gbuffer);
+     * device.EndFrame();
+     * @endcode
+     *
+     * @param name   The name of the pass, used as the name of its profiler zone.
+     * @param desc   The declaration of the pass.
+     * @param record The callback function to record the pass.
+     *
+     * @throw std::runtime_error If a frame has not begun, an image is invalid, or the pass has no attachment.
+     */
+    void AddPass(const std::string& name, const PassDesc& desc, const PassCallback& record);
+
+    /**
+     * @brief Get the memory of the transient images of the last frame.
+     *
+     * The transient images include the depth buffer of the main pass and the images declared with CreatePassImage.
+     *
+     * @return The memory of the transient images.
+     */
+    TransientStats GetTransientStats(void);
+
+    /**
+     * @brief End a frame.
+     *
+     * This method records the passes added with AddPass and the main pass that executes the recorded command buffers with dynamic rendering,
+     * submits the frame and presents the swapchain image.
+     * Without a window, the offscreen image is copied to host memory on the transfer queue instead.
+     * If a frame has not begun, a `std::runtime_error` exception is thrown.
+     *
+     * @throw std::runtime_error If a frame has not begun.
+     */
+    void EndFrame(void);
+
+    /**
+     * @brief Set the readback callback function.
+     *
+     * This method sets the callback function to be called with the pixels of each offscreen frame.
+     * The callback is called on the thread that calls BeginFrame or FinishFrames, in the order of the frames.
+     * Frames are only read back when the device has no window.
+     *
+     * @param readback The readback callback function.
+     */
+    void SetReadbackCallback(const ReadbackCallback& readback);
+
+    /**
+     * @brief Wait for the submitted frames to finish.
+     *
+     * This method waits for the GPU to finish the submitted frames, delivers their pending readbacks and resolves their timings.
+     * If a frame has begun, a `std::runtime_error` exception is thrown.
+     *
+     * @throw std::runtime_error If a frame has begun.
+     */
+    void FinishFrames(void);
+
+    /**
+     * @brief Take the timings of the profiled frames.
+     *
+     * This method returns the timings resolved since the previous call, in the order of the frames.
+     * The GPU time of a frame is measured as zones with timestamp queries: the whole graphics command buffer, each pass,
+     * and the readback on the transfer queue without a window.
+     * The timings of a frame are resolved without waiting for the GPU when its frame slot is begun again or FinishFrames is called,
+     * so they lag behind by the number of frames in flight.
+     * Up to 1024 frames are kept between calls, and older frames are dropped.
+     * If profiling is disabled in the options, nothing is returned.
+     *
+     * Example:
+     * @code{.cpp}
+     * Starlight::Core::Device device(window, { .profiling = true });
+     * // Render some frames...
+     * device.FinishFrames();
+     * auto timings = device.TakeFrameTimings();
+     * std::ofstream stream("trace.json");
+     * Starlight::Core::WriteChromeTrace(stream, timings);
+     * @endcode
+     *
+     * @return The timings of the frames.
+     */
+    std::vector<FrameTiming> TakeFrameTimings(void);
+
     // Debug implementation
     void Clear(float r, float g, float b);
 
@@ -0,0 +1,616 @@
+/**
+ * @file
+ * @brief
+ * Schedule the rendering passes of a frame.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include "graph.hpp"
+
+namespace Starlight::Core {
+
+static constexpr std::size_t noPass = std::numeric_limits<std::size_t>::max();
+
+struct ImageState {
+    vk::ImageLayout         layout = vk::ImageLayout::eUndefined;
+    vk::PipelineStageFlags2 stages = vk::PipelineStageFlagBits2::eNone;
+    vk::AccessFlags2        access = vk::AccessFlagBits2::eNone;
+};
+
+static constexpr vk::AccessFlags2 writeAccess =
+    vk::AccessFlagBits2::eColorAttachmentWrite | vk::AccessFlagBits2::eDepthStencilAttachmentWrite | vk::AccessFlagBits2::eShaderWrite |
+    vk::AccessFlagBits2::eShaderStorageWrite   | vk::AccessFlagBits2::eTransferWrite               | vk::AccessFlagBits2::eHostWrite   |
+    vk::AccessFlagBits2::eMemoryWrite;
+
+static bool IsWrite(vk::AccessFlags2 access) {
+    return !!(access & writeAccess);
+}
+
+static bool IsRead(vk::AccessFlags2 access) {
+    return !!(access & ~writeAccess);
+}
+
+static bool HasDepth(vk::Format format) {
+    switch (format) {
+    case vk::Format::eD16Unorm:
+    case vk::Format::eX8D24UnormPack32:
+    case vk::Format::eD32Sfloat:
+    case vk::Format::eD16UnormS8Uint:
+    case vk::Format::eD24UnormS8Uint:
+    case vk::Format::eD32SfloatS8Uint:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool HasStencil(vk::Format format) {
+    switch (format) {
+    case vk::Format::eS8Uint:
+    case vk::Format::eD16UnormS8Uint:
+    case vk::Format::eD24UnormS8Uint:
+    case vk::Format::eD32SfloatS8Uint:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static vk::ImageAspectFlags GetAspect(vk::Format format) {
+    vk::ImageAspectFlags aspect;
+    if (HasDepth  (format)) aspect |= vk::ImageAspectFlagBits::eDepth;
+    if (HasStencil(format)) aspect |= vk::ImageAspectFlagBits::eStencil;
+    return aspect ? aspect : vk::ImageAspectFlagBits::eColor;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::Color(GraphImage image, std::optional<vk::ClearColorValue> clear) {
+    uses.push_back({ image, Kind::Color, clear ? std::optional<vk::ClearValue>(*clear) : std::nullopt, vk::PipelineStageFlagBits2::eColorAttachmentOutput });
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::Depth(GraphImage image, std::optional<vk::ClearDepthStencilValue> clear) {
+    uses.push_back({ image, Kind::Depth, clear ? std::optional<vk::ClearValue>(*clear) : std::nullopt, vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests });
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::Sample(GraphImage image, vk::PipelineStageFlags2 stages) {
+    uses.push_back({ image, Kind::Sample, std::nullopt, stages });
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::Read(GraphBuffer buffer, vk::PipelineStageFlags2 stages, vk::AccessFlags2 access) {
+    bufferUses.push_back({ buffer, stages, access });
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::Write(GraphBuffer buffer, vk::PipelineStageFlags2 stages, vk::AccessFlags2 access) {
+    bufferUses.push_back({ buffer, stages, access });
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::Secondary(void) {
+    secondary = true;
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::SideEffect(void) {
+    sideEffect = true;
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::Execute(ExecuteCallback execute) {
+    this->execute = std::move(execute);
+    return *this;
+}
+
+struct RenderGraph::Impl {
+    struct ImageResource {
+        GraphImageDesc               desc;
+        std::optional<ImportedImage> imported;
+        vk::Image                    image;
+        vk::ImageView                view;
+        ImageState                   state;
+        vk::ImageUsageFlags          usage;
+        std::size_t                  firstPass = noPass;
+        std::size_t                  lastPass  = 0;
+        bool                         lazy      = false;
+        std::size_t                  slot      = 0;
+    };
+    struct BufferResource {
+        GraphBufferDesc              desc;
+        vk::Buffer                   buffer;
+        vk::PipelineStageFlags2      stages;
+        vk::AccessFlags2             access;
+        std::size_t                  firstPass = noPass;
+        std::size_t                  lastPass  = 0;
+        std::size_t                  slot      = 0;
+    };
+    struct Key {
+        bool                         buffer;
+        vk::Format                   format;
+        vk::Extent2D                 extent;
+        vk::DeviceSize               size;
+        std::uint32_t                usage;
+        bool                         lazy;
+        std::size_t                  firstPass;
+        std::size_t                  lastPass;
+        bool operator==(const Key&) const = default;
+    };
+    struct Slot {
+        Allocation                   memory;
+        vk::MemoryRequirements       requirements;
+        bool                         linear;
+        bool                         lazy;
+        std::vector<std::pair<std::size_t, std::size_t>> lifetimes;
+        vk::PipelineStageFlags2      stages;
+        vk::AccessFlags2             access;
+    };
+    struct Plan {
+        std::vector<Key>                 keys;
+        std::vector<Slot>                slots;
+        std::vector<vk::UniqueImage>     images;
+        std::vector<vk::UniqueImageView> views;
+        std::vector<vk::UniqueBuffer>    buffers;
+        std::vector<std::size_t>         imageSlots;
+        std::vector<std::size_t>         bufferSlots;
+        GraphMemory                      memory{};
+        std::uint64_t                    lastFrame = 0;
+    };
+    vk::Device                         device;
+    Allocator&                         allocator;
+    std::size_t                        retireLatency;
+    std::uint64_t                      frame;
+    std::vector<ImageResource>         images;
+    std::vector<BufferResource>        buffers;
+    std::deque<Pass>                   passes;
+    std::vector<bool>                  alive;
+    std::vector<std::unique_ptr<Plan>> plans;
+    Plan*                              plan;
+    GraphMemory                        memory{};
+    TimestampProfiler*                 profiler;
+    std::uint32_t                      family;
+    std::string                        queue;
+    Impl(vk::Device device, Allocator& allocator, std::size_t retireLatency) :
+    device(device), allocator(allocator), retireLatency(retireLatency), frame(0), plan(nullptr), profiler(nullptr), family(0) {
+    }
+    ImageResource& Get(GraphImage image) {
+        auto index = static_cast<std::size_t>(image);
+        if (index >= images.size()) throw std::runtime_error("Invalid graph image handle");
+        return images[index];
+    }
+    BufferResource& Get(GraphBuffer buffer) {
+        auto index = static_cast<std::size_t>(buffer);
+        if (index >= buffers.size()) throw std::runtime_error("Invalid graph buffer handle");
+        return buffers[index];
+    }
+    static ImageState GetRequiredState(const Pass::Use& use, bool load) {
+        using enum vk::AccessFlagBits2;
+        switch (use.kind) {
+        case Pass::Kind::Color:
+            return { vk::ImageLayout::eColorAttachmentOptimal,        use.stages, eColorAttachmentWrite | (load ? eColorAttachmentRead : eNone) };
+        case Pass::Kind::Depth:
+            return { vk::ImageLayout::eDepthStencilAttachmentOptimal, use.stages, eDepthStencilAttachmentWrite | eDepthStencilAttachmentRead };
+        default:
+            return { vk::ImageLayout::eShaderReadOnlyOptimal,         use.stages, eShaderSampledRead };
+        }
+    }
+    void Validate(void) {
+        for (auto& pass : passes) {
+            for (auto i = pass.uses.begin(); i != pass.uses.end(); ++i) {
+                auto& resource = Get(i->image);
+                auto  depth    = HasDepth(resource.desc.format) || HasStencil(resource.desc.format);
+                if (i->kind == Pass::Kind::Color && depth) throw std::runtime_error("A depth image cannot be a color attachment");
+                if (i->kind == Pass::Kind::Depth && !depth) throw std::runtime_error("A color image cannot be a depth attachment");
+                if (std::any_of(pass.uses.begin(), i, [i](const Pass::Use& use) { return use.image == i->image; })) {
+                    throw std::runtime_error("An image is used twice in a pass");
+                }
+            }
+            for (const auto& use : pass.bufferUses) Get(use.buffer);
+        }
+    }
+    void Cull(void) {
+        std::vector<bool> imageNeeded(images.size());
+        std::vector<bool> bufferNeeded(buffers.size());
+        for (std::size_t i = 0; i < images.size(); ++i) {
+            imageNeeded[i] = images[i].imported && images[i].imported->finalLayout != vk::ImageLayout::eUndefined;
+        }
+        alive.assign(passes.size(), false);
+        for (auto index = passes.size(); index-- > 0;) {
+            const auto& pass = passes[index];
+            auto live = pass.sideEffect;
+            for (const auto& use : pass.uses) {
+                if (use.kind != Pass::Kind::Sample && imageNeeded[static_cast<std::size_t>(use.image)]) live = true;
+            }
+            for (const auto& use : pass.bufferUses) {
+                if (IsWrite(use.access) && bufferNeeded[static_cast<std::size_t>(use.buffer)]) live = true;
+            }
+            if (!live) continue;
+            alive[index] = true;
+            for (const auto& use : pass.uses) {
+                auto kept = use.kind == Pass::Kind::Sample || !use.clear;
+                imageNeeded[static_cast<std::size_t>(use.image)] = kept;
+            }
+            for (const auto& use : pass.bufferUses) {
+                if (IsRead(use.access)) bufferNeeded[static_cast<std::size_t>(use.buffer)] = true;
+            }
+        }
+    }
+    void Analyze(void) {
+        for (std::size_t index = 0; index < passes.size(); ++index) {
+            if (!alive[index]) continue;
+            for (const auto& use : passes[index].uses) {
+                auto& resource = images[static_cast<std::size_t>(use.image)];
+                resource.firstPass = std::min(resource.firstPass, index);
+                resource.lastPass  = std::max(resource.lastPass,  index);
+                switch (use.kind) {
+                case Pass::Kind::Color:
+                    resource.usage |= vk::ImageUsageFlagBits::eColorAttachment;
+                    break;
+                case Pass::Kind::Depth:
+                    resource.usage |= vk::ImageUsageFlagBits::eDepthStencilAttachment;
+                    break;
+                default:
+                    resource.usage |= vk::ImageUsageFlagBits::eSampled;
+                    break;
+                }
+            }
+            for (const auto& use : passes[index].bufferUses) {
+                auto& resource = buffers[static_cast<std::size_t>(use.buffer)];
+                resource.firstPass = std::min(resource.firstPass, index);
+                resource.lastPass  = std::max(resource.lastPass,  index);
+            }
+        }
+        for (auto& resource : images) {
+            resource.lazy = !resource.imported && resource.firstPass == resource.lastPass && !(resource.usage & vk::ImageUsageFlagBits::eSampled);
+            if (resource.lazy) resource.usage |= vk::ImageUsageFlagBits::eTransientAttachment;
+        }
+    }
+    std::vector<Key> GetKeys(void) const {
+        std::vector<Key> keys;
+        for (const auto& resource : images) {
+            if (resource.imported || resource.firstPass == noPass) continue;
+            keys.push_back({ false, resource.desc.format, resource.desc.extent, 0, static_cast<std::uint32_t>(resource.usage), resource.lazy, resource.firstPass, resource.lastPass });
+        }
+        for (const auto& resource : buffers) {
+            if (resource.firstPass == noPass) continue;
+            keys.push_back({ true, vk::Format::eUndefined, vk::Extent2D(), resource.desc.size, static_cast<std::uint32_t>(resource.desc.usage), false, resource.firstPass, resource.lastPass });
+        }
+        return keys;
+    }
+    std::unique_ptr<Plan> CreatePlan(std::vector<Key> keys) {
+        auto created = std::make_unique<Plan>();
+        created->keys = std::move(keys);
+        std::vector<vk::MemoryRequirements> requirements;
+        for (const auto& key : created->keys) {
+            if (key.buffer) {
+                vk::BufferCreateInfo info(vk::BufferCreateFlags(), key.size, vk::BufferUsageFlags(key.usage));
+                created->buffers.push_back(device.createBufferUnique(info));
+                requirements.push_back(device.getBufferMemoryRequirements(*created->buffers.back()));
+            } else {
+                vk::ImageCreateInfo info;
+                info.imageType   = vk::ImageType::e2D;
+                info.format      = key.format;
+                info.extent      = vk::Extent3D(key.extent, 1);
+                info.mipLevels   = 1;
+                info.arrayLayers = 1;
+                info.usage       = vk::ImageUsageFlags(key.usage);
+                created->images.push_back(device.createImageUnique(info));
+                requirements.push_back(device.getImageMemoryRequirements(*created->images.back()));
+            }
+        }
+        std::vector<std::size_t> order(created->keys.size());
+        for (std::size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::ranges::stable_sort(order, [&](std::size_t a, std::size_t b) { return requirements[a].size > requirements[b].size; });
+        std::vector<std::size_t> assigned(created->keys.size());
+        for (auto i : order) {
+            const auto& key     = created->keys[i];
+            const auto& request = requirements[i];
+            auto overlaps = [&key](const std::pair<std::size_t, std::size_t>& lifetime) {
+                return key.firstPass <= lifetime.second && lifetime.first <= key.lastPass;
+            };
+            auto found = std::ranges::find_if(created->slots, [&](const Slot& slot) {
+                return slot.linear == key.buffer && slot.lazy == key.lazy &&
+                       (slot.requirements.memoryTypeBits & request.memoryTypeBits) && std::ranges::none_of(slot.lifetimes, overlaps);
+            });
+            if (found == created->slots.end()) {
+                auto& slot = created->slots.emplace_back();
+                slot.requirements = request;
+                slot.linear       = key.buffer;
+                slot.lazy         = key.lazy;
+                found = created->slots.end() - 1;
+            }
+            found->requirements.size           = std::max(found->requirements.size,      request.size     );
+            found->requirements.alignment      = std::max(found->requirements.alignment, request.alignment);
+            found->requirements.memoryTypeBits &= request.memoryTypeBits;
+            found->lifetimes.emplace_back(key.firstPass, key.lastPass);
+            assigned[i] = found - created->slots.begin();
+        }
+        for (const auto& request : requirements) created->memory.requestedBytes += request.size;
+        for (auto& slot : created->slots) {
+            created->memory.allocatedBytes += slot.requirements.size;
+            slot.memory = allocator.Allocate(slot.requirements, slot.lazy ? MemoryUsage::GpuLazy : MemoryUsage::GpuOnly, slot.linear);
+        }
+        auto image  = created->images.begin();
+        auto buffer = created->buffers.begin();
+        for (std::size_t i = 0; i < created->keys.size(); ++i) {
+            const auto& key  = created->keys[i];
+            const auto& slot = created->slots[assigned[i]];
+            if (key.buffer) {
+                device.bindBufferMemory(**buffer++, slot.memory.GetMemory(), slot.memory.GetOffset());
+                created->bufferSlots.push_back(assigned[i]);
+                continue;
+            }
+            device.bindImageMemory(**image, slot.memory.GetMemory(), slot.memory.GetOffset());
+            vk::ComponentMapping components(vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eG, vk::ComponentSwizzle::eB, vk::ComponentSwizzle::eA);
+            vk::ImageSubresourceRange subresourceRange(GetAspect(key.format), 0, 1, 0, 1);
+            vk::ImageViewCreateInfo viewInfo(vk::ImageViewCreateFlags(), **image++, vk::ImageViewType::e2D, key.format, components, subresourceRange);
+            created->views.push_back(device.createImageViewUnique(viewInfo));
+            created->imageSlots.push_back(assigned[i]);
+        }
+        return created;
+    }
+    void Realize(void) {
+        auto keys  = GetKeys();
+        auto found = std::ranges::find_if(plans, [&keys](const std::unique_ptr<Plan>& cached) { return cached->keys == keys; });
+        if (found == plans.end()) found = plans.insert(plans.end(), CreatePlan(std::move(keys)));
+        plan = found->get();
+        plan->lastFrame = frame;
+        memory = plan->memory;
+        std::size_t imageIndex  = 0;
+        std::size_t bufferIndex = 0;
+        for (auto& resource : images) {
+            if (resource.imported || resource.firstPass == noPass) continue;
+            resource.image = *plan->images[imageIndex];
+            resource.view  = *plan->views [imageIndex];
+            resource.slot  =  plan->imageSlots[imageIndex++];
+        }
+        for (auto& resource : buffers) {
+            if (resource.firstPass == noPass) continue;
+            resource.buffer = *plan->buffers[bufferIndex];
+            resource.slot   =  plan->bufferSlots[bufferIndex++];
+        }
+    }
+    bool IsNeededAfter(const ImageResource& resource, std::size_t index) const {
+        if (resource.lastPass > index) return true;
+        return resource.imported && resource.imported->finalLayout != vk::ImageLayout::eUndefined;
+    }
+    void RecordBufferBarriers(const Pass& pass, std::size_t index, std::vector<vk::BufferMemoryBarrier2>& barriers) {
+        std::vector<Pass::BufferUse> merged;
+        for (const auto& use : pass.bufferUses) {
+            auto found = std::ranges::find(merged, use.buffer, &Pass::BufferUse::buffer);
+            if (found == merged.end()) {
+                merged.push_back(use);
+            } else {
+                found->stages |= use.stages;
+                found->access |= use.access;
+            }
+        }
+        for (const auto& use : merged) {
+            auto& resource = buffers[static_cast<std::size_t>(use.buffer)];
+            if (index == resource.firstPass) {
+                const auto& slot = plan->slots[resource.slot];
+                resource.stages = slot.stages;
+                resource.access = slot.access;
+            }
+            if (!IsWrite(resource.access) && !IsWrite(use.access)) {
+                resource.stages |= use.stages;
+                resource.access |= use.access;
+                continue;
+            }
+            if (resource.stages) {
+                barriers.emplace_back(resource.stages, resource.access, use.stages, use.access,
+                                      VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, resource.buffer, 0, VK_WHOLE_SIZE);
+            }
+            resource.stages = use.stages;
+            resource.access = use.access;
+        }
+    }
+    void RetireSlots(const Pass& pass, std::size_t index) {
+        for (const auto& use : pass.uses) {
+            const auto& resource = images[static_cast<std::size_t>(use.image)];
+            if (resource.imported || resource.lastPass != index) continue;
+            auto& slot = plan->slots[resource.slot];
+            slot.stages = resource.state.stages;
+            slot.access = resource.state.access;
+        }
+        for (const auto& use : pass.bufferUses) {
+            const auto& resource = buffers[static_cast<std::size_t>(use.buffer)];
+            if (resource.lastPass != index) continue;
+            auto& slot = plan->slots[resource.slot];
+            slot.stages = resource.stages;
+            slot.access = resource.access;
+        }
+    }
+    void RecordPass(vk::CommandBuffer commandBuffer, std::size_t index) {
+        auto& pass = passes[index];
+        std::vector<vk::ImageMemoryBarrier2>       imageBarriers;
+        std::vector<vk::BufferMemoryBarrier2>      bufferBarriers;
+        std::vector<vk::RenderingAttachmentInfo>   colors;
+        std::optional<vk::RenderingAttachmentInfo> depth;
+        vk::Extent2D extent;
+        auto stencil = false;
+        for (const auto& use : pass.uses) {
+            auto& resource = images[static_cast<std::size_t>(use.image)];
+            if (!resource.imported && index == resource.firstPass) {
+                const auto& slot = plan->slots[resource.slot];
+                resource.state = { vk::ImageLayout::eUndefined, slot.stages, slot.access };
+            }
+            auto attachment = use.kind != Pass::Kind::Sample;
+            auto defined    = resource.state.layout != vk::ImageLayout::eUndefined;
+            auto load       = attachment && !use.clear && defined;
+            auto target     = GetRequiredState(use, load);
+            if (resource.state.layout != target.layout || IsWrite(resource.state.access) || IsWrite(target.access)) {
+                vk::ImageSubresourceRange subresourceRange(GetAspect(resource.desc.format), 0, 1, 0, 1);
+                imageBarriers.emplace_back(resource.state.stages, resource.state.access, target.stages, target.access,
+                                           resource.state.layout, target.layout, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, resource.image, subresourceRange);
+                resource.state = target;
+            } else {
+                resource.state.stages |= target.stages;
+                resource.state.access |= target.access;
+            }
+            if (!attachment) continue;
+            vk::RenderingAttachmentInfo info;
+            info.imageView   = resource.view;
+            info.imageLayout = target.layout;
+            info.loadOp      = use.clear ? vk::AttachmentLoadOp::eClear : load ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eDontCare;
+            info.storeOp     = IsNeededAfter(resource, index) ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare;
+            if (use.clear) info.clearValue = *use.clear;
+            if (use.kind == Pass::Kind::Color) {
+                colors.push_back(info);
+            } else {
+                depth   = info;
+                stencil = HasStencil(resource.desc.format);
+            }
+            extent = resource.desc.extent;
+        }
+        RecordBufferBarriers(pass, index, bufferBarriers);
+        RetireSlots(pass, index);
+        if (!imageBarriers.empty() || !bufferBarriers.empty()) {
+            commandBuffer.pipelineBarrier2(vk::DependencyInfo().setImageMemoryBarriers(imageBarriers).setBufferMemoryBarriers(bufferBarriers));
+        }
+        if (colors.empty() && !depth) {
+            if (pass.execute) pass.execute(commandBuffer);
+            return;
+        }
+        vk::RenderingInfo info;
+        if (pass.secondary) info.flags = vk::RenderingFlagBits::eContentsSecondaryCommandBuffers;
+        info.renderArea = vk::Rect2D({ 0, 0 }, extent);
+        info.layerCount = 1;
+        info.setColorAttachments(colors);
+        if (depth  ) info.setPDepthAttachment  (&*depth);
+        if (stencil) info.setPStencilAttachment(&*depth);
+        commandBuffer.beginRendering(info);
+        if (pass.execute) pass.execute(commandBuffer);
+        commandBuffer.endRendering();
+    }
+    void RecordFinalLayouts(vk::CommandBuffer commandBuffer) {
+        std::vector<vk::ImageMemoryBarrier2> barriers;
+        for (auto& resource : images) {
+            if (!resource.imported) continue;
+            auto layout = resource.imported->finalLayout;
+            if (layout == vk::ImageLayout::eUndefined || layout == resource.state.layout) continue;
+            vk::ImageSubresourceRange subresourceRange(GetAspect(resource.desc.format), 0, 1, 0, 1);
+            barriers.emplace_back(resource.state.stages, resource.state.access, vk::PipelineStageFlagBits2::eNone, vk::AccessFlagBits2::eNone,
+                                  resource.state.layout, layout, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, resource.image, subresourceRange);
+        }
+        if (!barriers.empty()) commandBuffer.pipelineBarrier2(vk::DependencyInfo().setImageMemoryBarriers(barriers));
+    }
+    void Clear(void) {
+        images.clear();
+        buffers.clear();
+        passes.clear();
+        alive.clear();
+        plan = nullptr;
+        std::erase_if(plans, [this](const std::unique_ptr<Plan>& cached) {
+            return frame > cached->lastFrame + retireLatency;
+        });
+        ++frame;
+    }
+};
+
+RenderGraph::RenderGraph(vk::Device device, Allocator& allocator, std::size_t retireLatency) :
+pImpl(std::make_unique<Impl>(device, allocator, retireLatency)) {
+}
+
+RenderGraph::~RenderGraph() {
+}
+
+void RenderGraph::SetProfiler(TimestampProfiler* profiler, std::uint32_t family, const std::string& queue) {
+    pImpl->profiler = profiler;
+    pImpl->family   = family;
+    pImpl->queue    = queue;
+}
+
+GraphImage RenderGraph::Import(const ImportedImage& image) {
+    Impl::ImageResource resource;
+    resource.desc         = image.desc;
+    resource.imported     = image;
+    resource.image        = image.image;
+    resource.view         = image.view;
+    resource.state.layout = image.initialLayout;
+    resource.state.stages = image.readyStages;
+    pImpl->images.push_back(resource);
+    return static_cast<GraphImage>(pImpl->images.size() - 1);
+}
+
+GraphImage RenderGraph::Create(const GraphImageDesc& desc) {
+    Impl::ImageResource resource;
+    resource.desc = desc;
+    pImpl->images.push_back(resource);
+    return static_cast<GraphImage>(pImpl->images.size() - 1);
+}
+
+GraphBuffer RenderGraph::Create(const GraphBufferDesc& desc) {
+    Impl::BufferResource resource;
+    resource.desc = desc;
+    pImpl->buffers.push_back(resource);
+    return static_cast<GraphBuffer>(pImpl->buffers.size() - 1);
+}
+
+vk::ImageView RenderGraph::GetView(GraphImage image) const {
+    const auto& resource = pImpl->Get(image);
+    if (!resource.view) throw std::runtime_error("The graph image is not used by any kept pass");
+    return resource.view;
+}
+
+vk::Buffer RenderGraph::GetBuffer(GraphBuffer buffer) const {
+    const auto& resource = pImpl->Get(buffer);
+    if (!resource.buffer) throw std::runtime_error("The graph buffer is not used by any kept pass");
+    return resource.buffer;
+}
+
+GraphMemory RenderGraph::GetMemory(void) const {
+    return pImpl->memory;
+}
+
+RenderGraph::Pass& RenderGraph::AddPass(const std::string& name) {
+    auto& pass = pImpl->passes.emplace_back();
+    pass.name = name;
+    return pass;
+}
+
+void RenderGraph::Execute(vk::CommandBuffer commandBuffer) {
+    try {
+        pImpl->Validate();
+        pImpl->Cull();
+        pImpl->Analyze();
+        pImpl->Realize();
+        for (std::size_t index = 0; index < pImpl->passes.size(); ++index) {
+            if (!pImpl->alive[index]) continue;
+            auto profiler = pImpl->profiler;
+            auto zone = profiler ? profiler->Begin(commandBuffer, pImpl->family, pImpl->queue, pImpl->passes[index].name) : std::nullopt;
+            pImpl->RecordPass(commandBuffer, index);
+            if (profiler) profiler->End(commandBuffer, zone);
+        }
+        pImpl->RecordFinalLayouts(commandBuffer);
+    } catch (...) {
+        pImpl->Clear();
+        throw;
+    }
+    pImpl->Clear();
+}
+
+} // namespace Starlight::Core
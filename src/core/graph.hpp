@@ -0,0 +1,380 @@
+/**
+ * @file
+ * @brief
+ * Schedule the rendering passes of a frame.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_GRAPH_HPP
+#define STARLIGHT_CORE_GRAPH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include "allocator.hpp"
+#include "timestamp.hpp"
+
+namespace Starlight::Core {
+
+/**
+ * @brief Handle of an image declared in a RenderGraph.
+ *
+ * The handle is only valid until the graph is executed.
+ */
+enum class GraphImage : std::uint32_t {};
+
+/**
+ * @brief Handle of a buffer declared in a RenderGraph.
+ *
+ * The handle is only valid until the graph is executed.
+ */
+enum class GraphBuffer : std::uint32_t {};
+
+/**
+ * @brief A structure to describe an image of a RenderGraph.
+ */
+struct GraphImageDesc final {
+    vk::Format   format; ///< The format of the image.
+    vk::Extent2D extent; ///< The extent of the image.
+};
+
+/**
+ * @brief A structure to describe a buffer of a RenderGraph.
+ */
+struct GraphBufferDesc final {
+    vk::DeviceSize       size;  ///< The size of the buffer in bytes.
+    vk::BufferUsageFlags usage; ///< The usage flags of the buffer.
+};
+
+/**
+ * @brief A structure to hold the memory of the transient resources of a RenderGraph.
+ */
+struct GraphMemory final {
+    vk::DeviceSize requestedBytes; ///< The number of bytes that the transient resources would occupy without aliasing.
+    vk::DeviceSize allocatedBytes; ///< The number of bytes allocated for them, with the resources whose lifetimes do not overlap sharing memory.
+};
+
+/**
+ * @brief A structure to describe an image owned outside of a RenderGraph.
+ *
+ * The graph transitions the image from `initialLayout` to `finalLayout`.
+ * If `initialLayout` is undefined, the previous contents are discarded.
+ */
+struct ImportedImage final {
+    vk::Image               image;         ///< The image.
+    vk::ImageView           view;          ///< The view of the whole image.
+    GraphImageDesc          desc;          ///< The description of the image.
+    vk::ImageLayout         initialLayout; ///< The layout of the image when the graph starts.
+    vk::ImageLayout         finalLayout;   ///< The layout of the image when the graph ends.
+    vk::PipelineStageFlags2 readyStages;   ///< The stages that the image is available to when the graph starts, such as the stages waiting for the acquire semaphore.
+};
+
+/**
+ * @brief Schedule the rendering passes of a frame.
+ *
+ * This class records a frame from passes that declare the images and buffers they write and read.
+ * It derives everything that a fixed `vk::RenderPass` would hardcode:
+ * - The rendering is begun with `vkCmdBeginRendering`, so no render pass or framebuffer objects exist.
+ * - The layout transitions and the memory dependencies between the passes are computed from the declarations,
+ *   and all image and buffer barriers needed before a pass are issued with a single `vkCmdPipelineBarrier2`.
+ * - The load operation is clear if the pass clears the image, load if the contents are defined, and don't care otherwise.
+ * - The store operation is store only if a later pass or the owner of an imported image needs the contents.
+ * - A transient image that is only used as an attachment of a single pass is never stored,
+ *   and is created with `eTransientAttachment` in lazily allocated memory, so it can live in tile memory.
+ *
+ * Passes whose outputs are never read are culled before recording.
+ * The outputs that count are the imported images with a final layout,
+ * and the images and buffers read by passes that are kept.
+ * A pass that has effects outside of the graph, for example a pass without declarations, must be marked with SideEffect.
+ *
+ * Transient images and buffers whose lifetimes do not overlap are aliased onto the same memory,
+ * so the memory of a frame is bounded by the resources alive at the same time rather than by all of them.
+ * The placement is cached per shape of the frame, so a frame shaped like a previous one reuses its resources
+ * with the previous accesses of the memory as the source of the first barriers.
+ * A placement that goes unused for more frames than the retire latency is destroyed.
+ *
+ * Example:
+ * @code{.cpp}
+ * auto target = graph.Import({ image, view, { format, extent }, vk::ImageLayout::eUndefined, vk::ImageLayout::ePresentSrcKHR, vk::PipelineStageFlagBits2::eColorAttachmentOutput });
+ * auto depth  = graph.Create({ vk::Format::eD32Sfloat, extent });
+ * graph.AddPass("main")
+ *     .Color(target, vk::ClearColorValue(0.0f, 0.0f, 0.0f, 1.0f))
+ *     .Depth(depth, vk::ClearDepthStencilValue(1.0f, 0))
+ *     .Execute([](vk::CommandBuffer commandBuffer) { DrawScene(commandBuffer); });
+ * graph.Execute(commandBuffer);
+ * @endcode
+ */
+class RenderGraph final {
+public:
+    /**
+     * @brief Callback function type for recording a pass.
+     *
+     * This callback function is called with the command buffer while the rendering of the pass is active.
+     *
+     * Signature:
+     * @code
+     * void execute(vk::CommandBuffer commandBuffer);
+     * @endcode
+     *
+     * @param commandBuffer The command buffer to record into.
+     */
+    using ExecuteCallback = std::function<void(vk::CommandBuffer)>;
+
+    /**
+     * @brief A pass of a RenderGraph.
+     *
+     * The methods declare how the pass uses the images, and return this pass for chaining.
+     */
+    class Pass final {
+    public:
+        /**
+         * @brief Render to an image as a color attachment.
+         *
+         * @param image The image.
+         * @param clear The color to clear the image with, or nothing to keep the contents.
+         *
+         * @return This pass.
+         */
+        Pass& Color(GraphImage image, std::optional<vk::ClearColorValue> clear = std::nullopt);
+
+        /**
+         * @brief Render to an image as the depth stencil attachment.
+         *
+         * @param image The image.
+         * @param clear The value to clear the image with, or nothing to keep the contents.
+         *
+         * @return This pass.
+         */
+        Pass& Depth(GraphImage image, std::optional<vk::ClearDepthStencilValue> clear = std::nullopt);
+
+        /**
+         * @brief Sample an image in shaders.
+         *
+         * @param image  The image.
+         * @param stages The shader stages that sample the image.
+         *
+         * @return This pass.
+         */
+        Pass& Sample(GraphImage image, vk::PipelineStageFlags2 stages = vk::PipelineStageFlagBits2::eFragmentShader);
+
+        /**
+         * @brief Read a buffer.
+         *
+         * @param buffer The buffer.
+         * @param stages The stages that read the buffer.
+         * @param access The accesses of the stages.
+         *
+         * @return This pass.
+         */
+        Pass& Read(GraphBuffer buffer, vk::PipelineStageFlags2 stages, vk::AccessFlags2 access = vk::AccessFlagBits2::eShaderStorageRead);
+
+        /**
+         * @brief Write a buffer.
+         *
+         * The rest of the buffer is preserved, so the previous writes are not culled.
+         *
+         * @param buffer The buffer.
+         * @param stages The stages that write the buffer.
+         * @param access The accesses of the stages.
+         *
+         * @return This pass.
+         */
+        Pass& Write(GraphBuffer buffer, vk::PipelineStageFlags2 stages, vk::AccessFlags2 access = vk::AccessFlagBits2::eShaderStorageWrite);
+
+        /**
+         * @brief Record the pass into secondary command buffers.
+         *
+         * The rendering is begun for secondary command buffers, so the callback may only execute them.
+         *
+         * @return This pass.
+         */
+        Pass& Secondary(void);
+
+        /**
+         * @brief Keep the pass even if nothing reads its outputs.
+         *
+         * @return This pass.
+         */
+        Pass& SideEffect(void);
+
+        /**
+         * @brief Set the function to record the pass.
+         *
+         * @param execute The callback function to record the pass.
+         *
+         * @return This pass.
+         */
+        Pass& Execute(ExecuteCallback execute);
+
+    private:
+        friend class RenderGraph;
+        enum class Kind {
+            Color,
+            Depth,
+            Sample,
+        };
+        struct Use {
+            GraphImage                    image;
+            Kind                          kind;
+            std::optional<vk::ClearValue> clear;
+            vk::PipelineStageFlags2       stages;
+        };
+        struct BufferUse {
+            GraphBuffer                   buffer;
+            vk::PipelineStageFlags2       stages;
+            vk::AccessFlags2              access;
+        };
+        std::string            name;
+        std::vector<Use>       uses;
+        std::vector<BufferUse> bufferUses;
+        bool                   secondary  = false;
+        bool                   sideEffect = false;
+        ExecuteCallback        execute;
+    };
+
+    /**
+     * @brief Construct a new RenderGraph object.
+     *
+     * @param device        The logical device.
+     * @param allocator     The allocator to create the transient images with.
+     * @param retireLatency The number of frames after which the GPU has finished a frame, usually the number of frames in flight.
+     */
+    RenderGraph(vk::Device device, Allocator& allocator, std::size_t retireLatency);
+
+    /**
+     * @brief Destruct the RenderGraph object.
+     *
+     * The GPU must have finished the executed frames.
+     */
+    ~RenderGraph();
+
+    /**
+     * @brief Set the profiler to measure the passes with.
+     *
+     * Each recorded pass is measured as a zone named after the pass, including the barriers before it.
+     *
+     * @param profiler The profiler, or nullptr to measure nothing.
+     * @param family   The queue family that the executed command buffers are submitted to.
+     * @param queue    The name of the queue.
+     */
+    void SetProfiler(TimestampProfiler* profiler, std::uint32_t family, const std::string& queue);
+
+    /**
+     * @brief Import an image owned outside of the graph.
+     *
+     * @param image The description of the image.
+     *
+     * @return The handle of the image.
+     */
+    GraphImage Import(const ImportedImage& image);
+
+    /**
+     * @brief Declare a transient image owned by the graph.
+     *
+     * The contents of the image are undefined at the start of each frame.
+     *
+     * @param desc The description of the image.
+     *
+     * @return The handle of the image.
+     */
+    GraphImage Create(const GraphImageDesc& desc);
+
+    /**
+     * @brief Declare a transient buffer owned by the graph.
+     *
+     * The contents of the buffer are undefined at the start of each frame.
+     *
+     * @param desc The description of the buffer.
+     *
+     * @return The handle of the buffer.
+     */
+    GraphBuffer Create(const GraphBufferDesc& desc);
+
+    /**
+     * @brief Get the view of an image.
+     *
+     * This method may only be called from the callback of a pass that is being recorded.
+     *
+     * @param image The handle of the image.
+     *
+     * @return The view of the whole image.
+     *
+     * @throw std::runtime_error If the image is invalid or not used by any kept pass.
+     */
+    vk::ImageView GetView(GraphImage image) const;
+
+    /**
+     * @brief Get a buffer.
+     *
+     * This method may only be called from the callback of a pass that is being recorded.
+     *
+     * @param buffer The handle of the buffer.
+     *
+     * @return The buffer.
+     *
+     * @throw std::runtime_error If the buffer is invalid or not used by any kept pass.
+     */
+    vk::Buffer GetBuffer(GraphBuffer buffer) const;
+
+    /**
+     * @brief Get the memory of the transient resources of the last executed frame.
+     *
+     * @return The memory of the transient resources.
+     */
+    GraphMemory GetMemory(void) const;
+
+    /**
+     * @brief Add a pass.
+     *
+     * The passes are executed in the order they are added.
+     * The returned reference is valid until the graph is executed.
+     *
+     * @param name The name of the pass.
+     *
+     * @return The pass.
+     */
+    Pass& AddPass(const std::string& name);
+
+    /**
+     * @brief Record the declared passes.
+     *
+     * This method culls the passes whose outputs are unused, records the rest with their barriers into the command buffer,
+     * transitions the imported images to their final layouts, and clears the declarations for the next frame.
+     *
+     * @param commandBuffer The command buffer to record into.
+     *
+     * @throw std::runtime_error If a declaration is invalid or a transient resource fails to create.
+     */
+    void Execute(vk::CommandBuffer commandBuffer);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_GRAPH_HPP
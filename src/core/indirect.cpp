@@ -0,0 +1,117 @@
+/**
+ * @file
+ * @brief
+ * Cull instances on the GPU and draw the survivors indirectly.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <array>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+#include "indirect.hpp"
+#include "shader.hpp"
+
+namespace Starlight::Core {
+
+struct IndirectBatch::Impl {
+    struct Slot {
+        Buffer                        drawList;
+        Buffer                        drawCount;
+        std::uint32_t                 drawListIndex;
+        std::uint32_t                 drawCountIndex;
+        std::optional<std::uint64_t>  culledFrame;
+    };
+    DescriptorHeap*                   descriptors;
+    vk::UniquePipeline                pipeline;
+    std::vector<Slot>                 slots;
+    std::uint32_t                     maxDraws;
+    std::uint32_t                     workgroupSize;
+};
+
+IndirectBatch::IndirectBatch(vk::Device device, Allocator& allocator, DescriptorHeap& descriptors, vk::PipelineCache cache, std::span<const std::uint32_t> families,
+                             std::size_t slotCount, vk::ShaderModule cullShader, std::uint32_t maxDraws, std::uint32_t workgroupSize) :
+pImpl(std::make_unique<Impl>()) {
+    if (!maxDraws || !workgroupSize) throw std::runtime_error("The indirect batch is empty");
+    pImpl->descriptors   = &descriptors;
+    pImpl->maxDraws      = maxDraws;
+    pImpl->workgroupSize = workgroupSize;
+    using WorkgroupSize = SpecConstant<0, std::uint32_t>;
+    Specialization specialization(WorkgroupSize{ workgroupSize });
+    auto specializationInfo = specialization.GetInfo();
+    vk::PipelineShaderStageCreateInfo stage(vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eCompute, cullShader, "main", &specializationInfo);
+    vk::ComputePipelineCreateInfo info(vk::PipelineCreateFlags(), stage, descriptors.GetPipelineLayout());
+    pImpl->pipeline = device.createComputePipelineUnique(cache, info).value;
+    using enum vk::BufferUsageFlagBits;
+    vk::BufferCreateInfo drawListInfo (vk::BufferCreateFlags(), maxDraws * sizeof(vk::DrawIndexedIndirectCommand), eStorageBuffer | eIndirectBuffer);
+    vk::BufferCreateInfo drawCountInfo(vk::BufferCreateFlags(), sizeof(std::uint32_t), eStorageBuffer | eIndirectBuffer | eTransferDst);
+    if (families.size() > 1) {
+        drawListInfo .setSharingMode(vk::SharingMode::eConcurrent).setQueueFamilyIndices(families);
+        drawCountInfo.setSharingMode(vk::SharingMode::eConcurrent).setQueueFamilyIndices(families);
+    }
+    pImpl->slots.resize(slotCount);
+    for (auto& slot : pImpl->slots) {
+        slot.drawList       = allocator.CreateBuffer(drawListInfo,  MemoryUsage::GpuOnly);
+        slot.drawCount      = allocator.CreateBuffer(drawCountInfo, MemoryUsage::GpuOnly);
+        slot.drawListIndex  = descriptors.AddBuffer(*slot.drawList.buffer,  0, VK_WHOLE_SIZE);
+        slot.drawCountIndex = descriptors.AddBuffer(*slot.drawCount.buffer, 0, VK_WHOLE_SIZE);
+    }
+}
+
+IndirectBatch::~IndirectBatch() {
+    for (const auto& slot : pImpl->slots) {
+        pImpl->descriptors->Free(DescriptorKind::StorageBuffer, slot.drawListIndex,  0);
+        pImpl->descriptors->Free(DescriptorKind::StorageBuffer, slot.drawCountIndex, 0);
+    }
+}
+
+void IndirectBatch::RecordCull(vk::CommandBuffer commandBuffer, std::size_t slot, std::uint64_t frame, std::uint32_t instanceCount, std::span<const std::byte> constants) {
+    if (constants.size() > UserConstantSize) throw std::runtime_error("The culling constants are too large");
+    auto& target = pImpl->slots[slot];
+    target.culledFrame = frame;
+    commandBuffer.fillBuffer(*target.drawCount.buffer, 0, sizeof(std::uint32_t), 0);
+    vk::BufferMemoryBarrier2 barrier;
+    barrier.srcStageMask  = vk::PipelineStageFlagBits2::eClear;
+    barrier.srcAccessMask = vk::AccessFlagBits2::eTransferWrite;
+    barrier.dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader;
+    barrier.dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite;
+    barrier.buffer        = *target.drawCount.buffer;
+    barrier.size          = VK_WHOLE_SIZE;
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo(vk::DependencyFlags(), {}, barrier, {}));
+    if (!instanceCount) return;
+    std::array<std::byte, DescriptorHeap::PushConstantSize> pushConstants{};
+    const std::array<std::uint32_t, 4> header{ target.drawListIndex, target.drawCountIndex, instanceCount, pImpl->maxDraws };
+    std::memcpy(pushConstants.data(), header.data(), sizeof(header));
+    if (!constants.empty()) std::memcpy(pushConstants.data() + sizeof(header), constants.data(), constants.size());
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *pImpl->pipeline);
+    pImpl->descriptors->Bind(commandBuffer, vk::PipelineBindPoint::eCompute);
+    commandBuffer.pushConstants(pImpl->descriptors->GetPipelineLayout(), vk::ShaderStageFlagBits::eAll, 0, sizeof(pushConstants), pushConstants.data());
+    commandBuffer.dispatch((instanceCount + pImpl->workgroupSize - 1) / pImpl->workgroupSize, 1, 1);
+}
+
+void IndirectBatch::RecordDraw(vk::CommandBuffer commandBuffer, std::size_t slot, std::uint64_t frame) const {
+    const auto& target = pImpl->slots[slot];
+    if (target.culledFrame != frame) throw std::runtime_error("The indirect batch has not been culled in the frame");
+    commandBuffer.drawIndexedIndirectCount(*target.drawList.buffer, 0, *target.drawCount.buffer, 0, pImpl->maxDraws, sizeof(vk::DrawIndexedIndirectCommand));
+}
+
+} // namespace Starlight::Core
@@ -0,0 +1,134 @@
+/**
+ * @file
+ * @brief
+ * Cull instances on the GPU and draw the survivors indirectly.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_INDIRECT_HPP
+#define STARLIGHT_CORE_INDIRECT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vulkan/vulkan.hpp>
+#include "allocator.hpp"
+#include "descriptor.hpp"
+
+namespace Starlight::Core {
+
+/**
+ * @brief Cull instances on the GPU and draw the survivors indirectly.
+ *
+ * This class owns a compute pipeline built from a culling shader, and a draw list and a draw count per frame slot.
+ * The culling shader reads the instances, for example from storage buffers in a structure-of-arrays layout,
+ * and appends a `VkDrawIndexedIndirectCommand` for each visible instance and level of detail to the draw list,
+ * counting the draws with an atomic add on the draw count.
+ * The draw list is then consumed by a single `vkCmdDrawIndexedIndirectCount`, so the CPU cost does not depend on the number of instances.
+ * The draw list and the draw count are storage buffers of the bindless descriptor heap,
+ * and the culling shader receives their indices at the start of the push constants:
+ *
+ * @code{.glsl}
+ * layout(push_constant) uniform Cull {
+ *     uint drawList;      // The index of the draw list at binding = 1.
+ *     uint drawCount;     // The index of the draw count at binding = 1.
+ *     uint instanceCount; // The number of instances to cull.
+ *     uint maxDraws;      // The capacity of the draw list.
+ *     uint user[28];      // The constants of the caller, such as the frustum planes and the indices of the instance buffers.
+ * };
+ * @endcode
+ *
+ * The local size of the shader is specialized with the workgroup size through the constant with ID 0,
+ * so the shader declares `layout(local_size_x_id = 0) in;`.
+ * The buffers are shared concurrently by the graphics and compute queue families, so no ownership transfer is needed.
+ * It is not thread safe, except that RecordDraw may be called concurrently.
+ */
+class IndirectBatch final {
+public:
+    /**
+     * @brief The size of the constants of the caller in bytes.
+     */
+    static constexpr std::size_t UserConstantSize = DescriptorHeap::PushConstantSize - 4 * sizeof(std::uint32_t);
+
+    /**
+     * @brief Construct a new IndirectBatch object.
+     *
+     * @param device        The logical device.
+     * @param allocator     The allocator to create the buffers with.
+     * @param descriptors   The bindless descriptor heap, whose pipeline layout the culling shader uses.
+     * @param cache         The pipeline cache to create the culling pipeline through.
+     * @param families      The queue families that access the buffers.
+     * @param slotCount     The number of frame slots.
+     * @param cullShader    The shader module of the culling compute shader.
+     * @param maxDraws      The capacity of the draw list.
+     * @param workgroupSize The number of instances culled by a workgroup.
+     */
+    IndirectBatch(vk::Device device, Allocator& allocator, DescriptorHeap& descriptors, vk::PipelineCache cache, std::span<const std::uint32_t> families,
+                  std::size_t slotCount, vk::ShaderModule cullShader, std::uint32_t maxDraws, std::uint32_t workgroupSize);
+
+    /**
+     * @brief Destruct the IndirectBatch object.
+     *
+     * The GPU must have finished using the buffers.
+     */
+    ~IndirectBatch();
+
+    /**
+     * @brief Record the culling of a frame slot.
+     *
+     * The draw count is cleared and the culling shader is dispatched for the instances.
+     * The slot remembers the frame, which RecordDraw checks.
+     *
+     * @param commandBuffer The compute command buffer.
+     * @param slot          The frame slot.
+     * @param frame         The serial number of the frame.
+     * @param instanceCount The number of instances to cull.
+     * @param constants     The constants of the caller, up to UserConstantSize bytes.
+     *
+     * @throw std::runtime_error If the constants are too large.
+     */
+    void RecordCull(vk::CommandBuffer commandBuffer, std::size_t slot, std::uint64_t frame, std::uint32_t instanceCount, std::span<const std::byte> constants);
+
+    /**
+     * @brief Record the indirect draw of a frame slot.
+     *
+     * The graphics pipeline and the index buffer must be bound.
+     * The submission must wait for the culling before the draw indirect stage.
+     * The slot must have been culled by RecordCull in the same frame,
+     * since the draw list and the draw count otherwise still hold the survivors of the frame that last used the slot.
+     *
+     * @param commandBuffer The graphics command buffer.
+     * @param slot          The frame slot.
+     * @param frame         The serial number of the frame.
+     *
+     * @throw std::runtime_error If the slot has not been culled in the frame.
+     */
+    void RecordDraw(vk::CommandBuffer commandBuffer, std::size_t slot, std::uint64_t frame) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_INDIRECT_HPP
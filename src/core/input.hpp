@@ -0,0 +1,72 @@
+/**
+ * @file
+ * @brief
+ * Describe the input events of a window.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_INPUT_HPP
+#define STARLIGHT_CORE_INPUT_HPP
+
+#include <cstdint>
+
+namespace Starlight::Core {
+
+/**
+ * @brief Type of an input event.
+ */
+enum class InputEventType {
+    Resize,      ///< The framebuffer has been resized to `x` by `y` pixels.
+    Key,         ///< A key has been pressed, repeated or released. `code` is the GLFW key code.
+    Char,        ///< A character has been input. `code` is the Unicode code point.
+    MouseButton, ///< A mouse button has been pressed or released. `code` is the GLFW mouse button.
+    CursorMove,  ///< The cursor has moved to `x` and `y` in screen coordinates relative to the content area.
+    Scroll,      ///< The wheel or the touchpad has scrolled by `x` and `y`.
+    Focus,       ///< The window has gained the focus if `action` is Press, or lost it if `action` is Release.
+};
+
+/**
+ * @brief Action of a key or a mouse button.
+ */
+enum class InputAction : std::int32_t {
+    Release = 0, ///< The key or the button has been released.
+    Press   = 1, ///< The key or the button has been pressed.
+    Repeat  = 2, ///< The key has been held down until it repeated.
+};
+
+/**
+ * @brief A structure to hold an input event.
+ *
+ * The members that the type of the event does not use are 0.
+ */
+struct InputEvent final {
+    InputEventType type;                           ///< The type of the event.
+    double         time   = 0.0;                   ///< The time in milliseconds on the profiler clock when the event was received.
+    std::int32_t   code   = 0;                     ///< The key, the mouse button or the code point.
+    InputAction    action = InputAction::Release;  ///< The action of the key or the mouse button.
+    std::int32_t   mods   = 0;                     ///< The GLFW modifier bits held down.
+    double         x      = 0.0;                   ///< The width, the horizontal position or the horizontal offset.
+    double         y      = 0.0;                   ///< The height, the vertical position or the vertical offset.
+};
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_INPUT_HPP
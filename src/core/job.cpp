@@ -0,0 +1,304 @@
+/**
+ * @file
+ * @brief
+ * Schedule jobs on a pool of worker threads.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "job.hpp"
+#include "profiler.hpp"
+
+namespace Starlight::Core::Job {
+
+struct State final {
+    Task                                task;
+    bool                                main = false;
+    std::atomic<std::size_t>            pending{ 1 };
+    std::atomic<bool>                   done{ false };
+    std::exception_ptr                  exception;
+    std::mutex                          mutex;
+    std::vector<std::shared_ptr<State>> continuations;
+};
+
+using SharedState = std::shared_ptr<State>;
+
+struct Access final {
+    static const SharedState& Get(const Handle& handle) {
+        return handle.state;
+    }
+    static Handle Make(SharedState state) {
+        Handle handle;
+        handle.state = std::move(state);
+        return handle;
+    }
+};
+
+static thread_local std::size_t threadIndex = 0;
+
+/*
+ * The owner pushes and pops at the back, and the thieves steal from the front,
+ * so the owner keeps working on the hot end while the oldest jobs migrate.
+ */
+class WorkQueue final {
+public:
+    void Push(SharedState job) {
+        std::lock_guard lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    SharedState Pop(void) {
+        std::lock_guard lock(mutex);
+        if (jobs.empty()) return {};
+        auto job = std::move(jobs.back());
+        jobs.pop_back();
+        return job;
+    }
+    SharedState Steal(void) {
+        std::lock_guard lock(mutex);
+        if (jobs.empty()) return {};
+        auto job = std::move(jobs.front());
+        jobs.pop_front();
+        return job;
+    }
+
+private:
+    std::mutex              mutex;
+    std::deque<SharedState> jobs;
+};
+
+/*
+ * Queue 0 is shared by the threads outside the pool, and queue N belongs to worker N.
+ * The jobs pinned to the main thread live in a separate queue that only the main thread drains.
+ */
+class Scheduler final {
+public:
+    Scheduler() :
+    mainThread(std::this_thread::get_id()), queues(std::max(std::thread::hardware_concurrency(), 2U)) {
+        for (std::size_t i = 1; i < queues.size(); ++i) workers.emplace_back(&Scheduler::Work, this, i);
+    }
+    ~Scheduler() {
+        stopping = true;
+        Notify(true);
+        for (auto& worker : workers) worker.join();
+    }
+    Handle Submit(Task task, std::span<const Handle> dependencies, bool main) {
+        auto job = std::make_shared<State>();
+        job->task = std::move(task);
+        job->main = main;
+        for (const auto& dependency : dependencies) {
+            const auto& state = Access::Get(dependency);
+            if (!state) continue;
+            std::lock_guard lock(state->mutex);
+            if (state->done) continue;
+            ++job->pending;
+            state->continuations.push_back(job);
+        }
+        Release(job);
+        return Access::Make(std::move(job));
+    }
+    void Wait(const SharedState& job) {
+        while (!job->done) {
+            if (RunOne()) continue;
+            ++waiting;
+            {
+                std::unique_lock lock(mutex);
+                signal.wait(lock, [&] { return job->done || queued > 0 || (IsMainThread() && mainQueued > 0); });
+            }
+            --waiting;
+        }
+        if (job->exception) std::rethrow_exception(job->exception);
+    }
+    void RunMainThread(void) {
+        if (!IsMainThread()) throw std::runtime_error("The main thread jobs must be run on the main thread");
+        while (auto job = StealMain()) Execute(job);
+    }
+    std::size_t GetThreadCount(void) const {
+        return queues.size();
+    }
+
+private:
+    std::thread::id               mainThread;
+    std::vector<WorkQueue>        queues;
+    WorkQueue                     mainJobs;
+    std::atomic<std::size_t>      queued{ 0 };
+    std::atomic<std::size_t>      mainQueued{ 0 };
+    std::atomic<std::size_t>      waiting{ 0 };
+    std::atomic<bool>             stopping{ false };
+    std::mutex                    mutex;
+    std::condition_variable       signal;
+    std::vector<std::thread>      workers;
+    bool IsMainThread(void) const {
+        return std::this_thread::get_id() == mainThread;
+    }
+    void Notify(bool all) {
+        { std::lock_guard lock(mutex); }
+        if (all) signal.notify_all();
+        else     signal.notify_one();
+    }
+    void Schedule(SharedState job) {
+        if (job->main) {
+            ++mainQueued;
+            mainJobs.Push(std::move(job));
+            Notify(true);
+        } else {
+            ++queued;
+            queues[threadIndex].Push(std::move(job));
+            Notify(false);
+        }
+    }
+    void Release(const SharedState& job) {
+        if (--job->pending == 0) Schedule(job);
+    }
+    SharedState Find(void) {
+        if (auto job = queues[threadIndex].Pop()) {
+            --queued;
+            return job;
+        }
+        for (std::size_t i = 1; i < queues.size(); ++i) {
+            if (auto job = queues[(threadIndex + i) % queues.size()].Steal()) {
+                --queued;
+                return job;
+            }
+        }
+        return {};
+    }
+    SharedState StealMain(void) {
+        auto job = mainJobs.Steal();
+        if (job) --mainQueued;
+        return job;
+    }
+    bool RunOne(void) {
+        SharedState job;
+        if (IsMainThread()) job = StealMain();
+        if (!job) job = Find();
+        if (!job) return false;
+        Execute(job);
+        return true;
+    }
+    void Execute(const SharedState& job) {
+        try {
+            STARLIGHT_ZONE("Job");
+            job->task();
+        } catch (...) {
+            job->exception = std::current_exception();
+        }
+        job->task = nullptr;
+        std::vector<SharedState> continuations;
+        {
+            std::lock_guard lock(job->mutex);
+            job->done = true;
+            continuations.swap(job->continuations);
+        }
+        for (const auto& continuation : continuations) Release(continuation);
+        if (waiting > 0) Notify(true);
+    }
+    void Work(std::size_t index) {
+        threadIndex = index;
+        while (!stopping) {
+            if (auto job = Find()) {
+                Execute(job);
+                continue;
+            }
+            std::unique_lock lock(mutex);
+            signal.wait(lock, [&] { return stopping || queued > 0; });
+        }
+    }
+};
+
+static Scheduler& GetScheduler(void) {
+    static Scheduler scheduler;
+    return scheduler;
+}
+
+Handle::Handle() = default;
+
+bool Handle::IsDone(void) const {
+    return !state || state->done;
+}
+
+Handle Submit(Task task, std::span<const Handle> dependencies) {
+    return GetScheduler().Submit(std::move(task), dependencies, false);
+}
+
+Handle Submit(Task task, std::initializer_list<Handle> dependencies) {
+    return GetScheduler().Submit(std::move(task), std::span(dependencies.begin(), dependencies.size()), false);
+}
+
+Handle SubmitMain(Task task, std::span<const Handle> dependencies) {
+    return GetScheduler().Submit(std::move(task), dependencies, true);
+}
+
+void Wait(const Handle& handle) {
+    if (const auto& state = Access::Get(handle)) GetScheduler().Wait(state);
+}
+
+void WaitAll(std::span<const Handle> handles) {
+    std::exception_ptr exception;
+    for (const auto& handle : handles) {
+        try {
+            Wait(handle);
+        } catch (...) {
+            if (!exception) exception = std::current_exception();
+        }
+    }
+    if (exception) std::rethrow_exception(exception);
+}
+
+void ParallelFor(std::size_t count, const std::function<void(std::size_t)>& body) {
+    if (count == 0) return;
+    std::vector<Handle> handles;
+    handles.reserve(count - 1);
+    for (std::size_t i = 1; i < count; ++i) handles.push_back(Submit([&body, i] { body(i); }));
+    std::exception_ptr exception;
+    try {
+        body(0);
+    } catch (...) {
+        exception = std::current_exception();
+    }
+    try {
+        WaitAll(handles);
+    } catch (...) {
+        if (!exception) exception = std::current_exception();
+    }
+    if (exception) std::rethrow_exception(exception);
+}
+
+void RunMainThread(void) {
+    GetScheduler().RunMainThread();
+}
+
+std::size_t GetThreadCount(void) {
+    return GetScheduler().GetThreadCount();
+}
+
+std::size_t GetThreadIndex(void) {
+    return threadIndex;
+}
+
+} // namespace Starlight::Core::Job
@@ -0,0 +1,177 @@
+/**
+ * @file
+ * @brief
+ * Schedule jobs on a pool of worker threads.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_JOB_HPP
+#define STARLIGHT_CORE_JOB_HPP
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <span>
+
+namespace Starlight::Core::Job {
+
+/**
+ * @brief Function type of a job.
+ *
+ * Signature:
+ * @code
+ * void task(void);
+ * @endcode
+ */
+using Task = std::function<void(void)>;
+
+/**
+ * @brief Handle of a submitted job.
+ *
+ * This class is a lightweight reference to a job, which can be copied freely.
+ * It is used to wait for the job and to declare the job as a dependency of other jobs.
+ * A default constructed handle refers to no job and is always done.
+ */
+class Handle final {
+public:
+    /**
+     * @brief Construct a Handle object that refers to no job.
+     */
+    Handle();
+
+    /**
+     * @brief Check if the job has finished.
+     *
+     * @return true if the job has finished or the handle refers to no job, false otherwise.
+     */
+    bool IsDone(void) const;
+
+private:
+    friend struct Access;
+    std::shared_ptr<struct State> state;
+};
+
+/**
+ * @brief Submit a job to the worker threads.
+ *
+ * The job runs on a worker thread after all of its dependencies have finished.
+ * The job system is started when it is used for the first time,
+ * with one worker thread per hardware thread except the one that first used it, which is regarded as the main thread.
+ *
+ * Example:
+ * @code{.cpp}
+ * auto decode = Starlight::Core::Job::Submit([] { DecodeAsset(); });
+ * auto upload = Starlight::Core::Job::Submit([] { UploadAsset(); }, { decode });
+ * Starlight::Core::Job::Wait(upload);
+ * @endcode
+ *
+ * @param task         The function to run.
+ * @param dependencies The jobs that must finish before the job starts.
+ *
+ * @return The handle of the job.
+ */
+Handle Submit(Task task, std::span<const Handle> dependencies = {});
+
+/**
+ * @brief Submit a job to the worker threads.
+ *
+ * This function behaves like the overload taking a span of dependencies.
+ *
+ * @param task         The function to run.
+ * @param dependencies The jobs that must finish before the job starts.
+ *
+ * @return The handle of the job.
+ */
+Handle Submit(Task task, std::initializer_list<Handle> dependencies);
+
+/**
+ * @brief Submit a job pinned to the main thread.
+ *
+ * The job runs on the main thread, in RunMainThread or while the main thread waits for a job.
+ * Use it for the calls that must happen on the main thread, such as the windowing system calls.
+ *
+ * @param task         The function to run.
+ * @param dependencies The jobs that must finish before the job starts.
+ *
+ * @return The handle of the job.
+ */
+Handle SubmitMain(Task task, std::span<const Handle> dependencies = {});
+
+/**
+ * @brief Wait for a job to finish.
+ *
+ * The calling thread runs other jobs while waiting, so waiting inside a job does not starve the pool.
+ * If the job threw an exception, the exception is rethrown.
+ *
+ * @param handle The handle of the job.
+ */
+void Wait(const Handle& handle);
+
+/**
+ * @brief Wait for jobs to finish.
+ *
+ * This function behaves like Wait for each of the jobs.
+ *
+ * @param handles The handles of the jobs.
+ */
+void WaitAll(std::span<const Handle> handles);
+
+/**
+ * @brief Run a function for each index in parallel.
+ *
+ * This function calls `body` for each index between 0 and `count` on the worker threads and the calling thread,
+ * and returns after all calls have returned.
+ * Each index is submitted as its own job, so the function suits coarse-grained work such as recording a command buffer.
+ *
+ * @param count The number of indices.
+ * @param body  The function to call with each index.
+ */
+void ParallelFor(std::size_t count, const std::function<void(std::size_t)>& body);
+
+/**
+ * @brief Run the jobs pinned to the main thread.
+ *
+ * This function runs the main thread jobs that are ready, and returns when none is left.
+ * It must be called on the main thread, typically once per iteration of the main loop.
+ */
+void RunMainThread(void);
+
+/**
+ * @brief Get the number of threads that run jobs.
+ *
+ * @return The number of worker threads plus one for the main thread.
+ */
+std::size_t GetThreadCount(void);
+
+/**
+ * @brief Get the index of the calling thread.
+ *
+ * The index is 0 for the main thread and any other thread outside the pool, and between 1 and GetThreadCount() - 1 for the worker threads.
+ * It can be used to index per-thread data.
+ *
+ * @return The index of the calling thread.
+ */
+std::size_t GetThreadIndex(void);
+
+} // namespace Starlight::Core::Job
+
+#endif // STARLIGHT_CORE_JOB_HPP
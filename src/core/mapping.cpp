@@ -0,0 +1,111 @@
+/**
+ * @file
+ * @brief
+ * Map a file into memory read-only.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <stdexcept>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "mapping.hpp"
+
+namespace Starlight::Core {
+
+struct MappedFile::Impl {
+    const std::byte*          data = nullptr;
+    std::size_t               size = 0;
+#ifdef _WIN32
+    HANDLE                    mapping = nullptr;
+#endif
+    void Map(const std::filesystem::path& path) {
+#ifdef _WIN32
+        auto file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Failed to open " + path.string());
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            CloseHandle(file);
+            throw std::runtime_error("Failed to open " + path.string());
+        }
+        if (!fileSize.QuadPart) {
+            CloseHandle(file);
+            return;
+        }
+        mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!mapping) throw std::runtime_error("Failed to map " + path.string());
+        data = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!data) throw std::runtime_error("Failed to map " + path.string());
+        size = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+        auto file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file < 0) throw std::runtime_error("Failed to open " + path.string());
+        struct stat status;
+        if (fstat(file, &status)) {
+            close(file);
+            throw std::runtime_error("Failed to open " + path.string());
+        }
+        if (!status.st_size) {
+            close(file);
+            return;
+        }
+        auto mapped = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+        close(file);
+        if (mapped == MAP_FAILED) throw std::runtime_error("Failed to map " + path.string());
+        data = static_cast<const std::byte*>(mapped);
+        size = static_cast<std::size_t>(status.st_size);
+#endif
+    }
+    void Unmap(void) {
+#ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+        if (mapping) CloseHandle(mapping);
+#else
+        if (data) munmap(const_cast<std::byte*>(data), size);
+#endif
+    }
+};
+
+MappedFile::MappedFile(const std::filesystem::path& path) :
+pImpl(std::make_unique<Impl>()) {
+    try {
+        pImpl->Map(path);
+    } catch (...) {
+        pImpl->Unmap();
+        throw;
+    }
+}
+
+MappedFile::~MappedFile() {
+    pImpl->Unmap();
+}
+
+std::span<const std::byte> MappedFile::GetData(void) const {
+    return std::span(pImpl->data, pImpl->size);
+}
+
+} // namespace Starlight::Core
@@ -0,0 +1,76 @@
+/**
+ * @file
+ * @brief
+ * Map a file into memory read-only.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_MAPPING_HPP
+#define STARLIGHT_CORE_MAPPING_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+namespace Starlight::Core {
+
+/**
+ * @brief Map a file into memory read-only.
+ *
+ * This class maps a whole file, so reading it does not copy anything
+ * and the pages are shared by all processes that map the same file.
+ * The file must not be modified while it is mapped.
+ */
+class MappedFile final {
+public:
+    /**
+     * @brief Map a file.
+     *
+     * @param path The path of the file.
+     *
+     * @throw std::runtime_error If the file cannot be opened or mapped.
+     */
+    explicit MappedFile(const std::filesystem::path& path);
+
+    /**
+     * @brief Unmap the file.
+     */
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Get the contents of the file.
+     *
+     * @return The contents, which stay valid while this object lives, or an empty span if the file is empty.
+     */
+    std::span<const std::byte> GetData(void) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_MAPPING_HPP
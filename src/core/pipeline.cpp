@@ -0,0 +1,152 @@
+/**
+ * @file
+ * @brief
+ * Cache the GPU pipelines.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include "job.hpp"
+#include "pipeline.hpp"
+
+namespace Starlight::Core {
+
+static std::filesystem::path GetCachePath(const std::filesystem::path& directory, const vk::PhysicalDeviceProperties& properties) {
+    if (directory.empty()) return {};
+    std::ostringstream name;
+    name << "pipeline-" << std::hex << std::setfill('0');
+    name << std::setw(8) << properties.vendorID << '-' << std::setw(8) << properties.deviceID << '-';
+    for (auto byte : properties.pipelineCacheUUID) name << std::setw(2) << static_cast<unsigned>(byte);
+    name << ".bin";
+    return directory / name.str();
+}
+
+static std::vector<std::uint8_t> LoadCacheData(const std::filesystem::path& path, const vk::PhysicalDeviceProperties& properties) {
+    if (path.empty()) return {};
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return {};
+    std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    constexpr auto headerSize = 4 * sizeof(std::uint32_t) + VK_UUID_SIZE;
+    if (data.size() < headerSize) return {};
+    std::uint32_t header[4];
+    std::memcpy(header, data.data(), sizeof(header));
+    if (header[0] < headerSize || header[0] > data.size()              ) return {};
+    if (header[1] != static_cast<std::uint32_t>(vk::PipelineCacheHeaderVersion::eOne)) return {};
+    if (header[2] != properties.vendorID || header[3] != properties.deviceID) return {};
+    if (std::memcmp(data.data() + sizeof(header), properties.pipelineCacheUUID.data(), VK_UUID_SIZE)) return {};
+    return data;
+}
+
+struct PipelineCache::Impl {
+    vk::Device                                          device;
+    std::filesystem::path                               path;
+    vk::UniquePipelineCache                             cache;
+    std::mutex                                          mutex;
+    std::unordered_map<std::string, vk::UniquePipeline> pipelines;
+    std::vector<Job::Handle>                            jobs;
+    std::atomic<bool>                                   stopping = false;
+    Impl(vk::PhysicalDevice phyDevice, vk::Device device, const std::filesystem::path& directory) : device(device) {
+        auto properties = phyDevice.getProperties();
+        path = GetCachePath(directory, properties);
+        auto data = LoadCacheData(path, properties);
+        try {
+            cache = device.createPipelineCacheUnique(vk::PipelineCacheCreateInfo(vk::PipelineCacheCreateFlags(), data.size(), data.data()));
+        } catch (const vk::SystemError&) {
+            if (data.empty()) throw;
+            cache = device.createPipelineCacheUnique(vk::PipelineCacheCreateInfo());
+        }
+    }
+    vk::Pipeline Store(const std::string& name, vk::UniquePipeline pipeline) {
+        std::lock_guard lock(mutex);
+        return pipelines.try_emplace(name, std::move(pipeline)).first->second.get();
+    }
+    bool Contains(const std::string& name) {
+        std::lock_guard lock(mutex);
+        return pipelines.contains(name);
+    }
+};
+
+PipelineCache::PipelineCache(vk::PhysicalDevice phyDevice, vk::Device device, const std::filesystem::path& directory) :
+pImpl(std::make_unique<Impl>(phyDevice, device, directory)) {
+}
+
+PipelineCache::~PipelineCache() {
+    pImpl->stopping = true;
+    std::vector<Job::Handle> jobs;
+    {
+        std::lock_guard lock(pImpl->mutex);
+        jobs.swap(pImpl->jobs);
+    }
+    Job::WaitAll(jobs);
+    try {
+        Save();
+    } catch (const std::exception&) {
+    }
+}
+
+vk::PipelineCache PipelineCache::Get(void) const {
+    return *pImpl->cache;
+}
+
+void PipelineCache::Prewarm(std::vector<PipelineRecipe> recipes) {
+    std::lock_guard lock(pImpl->mutex);
+    std::erase_if(pImpl->jobs, [](const Job::Handle& job) { return job.IsDone(); });
+    for (auto& recipe : recipes) {
+        pImpl->jobs.push_back(Job::Submit([impl = pImpl.get(), recipe = std::move(recipe)] {
+            if (impl->stopping || impl->Contains(recipe.name)) return;
+            try {
+                impl->Store(recipe.name, recipe.create(impl->device, *impl->cache));
+            } catch (const std::exception&) {
+            }
+        }));
+    }
+}
+
+vk::Pipeline PipelineCache::Acquire(const PipelineRecipe& recipe) {
+    {
+        std::lock_guard lock(pImpl->mutex);
+        if (auto found = pImpl->pipelines.find(recipe.name); found != pImpl->pipelines.end()) return *found->second;
+    }
+    return pImpl->Store(recipe.name, recipe.create(pImpl->device, *pImpl->cache));
+}
+
+void PipelineCache::Save(void) {
+    if (pImpl->path.empty()) return;
+    auto data = pImpl->device.getPipelineCacheData(*pImpl->cache);
+    std::error_code error;
+    std::filesystem::create_directories(pImpl->path.parent_path(), error);
+    auto temp = pImpl->path;
+    temp += ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if (!file) return;
+    }
+    std::filesystem::rename(temp, pImpl->path, error);
+}
+
+} // namespace Starlight::Core
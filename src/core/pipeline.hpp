@@ -0,0 +1,123 @@
+/**
+ * @file
+ * @brief
+ * Cache the GPU pipelines.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_PIPELINE_HPP
+#define STARLIGHT_CORE_PIPELINE_HPP
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace Starlight::Core {
+
+/**
+ * @brief A declaration of a pipeline.
+ *
+ * The `create` function is called with the logical device and the pipeline cache, and must create the pipeline through the cache.
+ * It may be called on a worker thread.
+ */
+struct PipelineRecipe final {
+    std::string                                                      name;   ///< The unique name of the pipeline.
+    std::function<vk::UniquePipeline(vk::Device, vk::PipelineCache)> create; ///< The function to create the pipeline.
+};
+
+/**
+ * @brief Cache the GPU pipelines.
+ *
+ * This class owns a `vk::PipelineCache` that persists on disk.
+ * The cache file is keyed by the vendor ID, device ID and pipeline cache UUID of the physical device,
+ * so a cache written by another GPU or driver is never fed to the driver.
+ * It is loaded when constructed and saved when destroyed.
+ * Declared pipelines can be created ahead of their first use on the worker threads by Prewarm.
+ * All methods are thread safe.
+ */
+class PipelineCache final {
+public:
+    /**
+     * @brief Construct a new PipelineCache object.
+     *
+     * If the cache file is missing or invalid, the cache starts empty.
+     *
+     * @param phyDevice The physical device.
+     * @param device    The logical device.
+     * @param directory The directory to keep the cache file in, or empty to keep the cache in memory only.
+     */
+    PipelineCache(vk::PhysicalDevice phyDevice, vk::Device device, const std::filesystem::path& directory);
+
+    /**
+     * @brief Destruct the PipelineCache object.
+     *
+     * The background warm-up is stopped, and the cache is saved.
+     */
+    ~PipelineCache();
+
+    /**
+     * @brief Get the pipeline cache.
+     *
+     * @return The pipeline cache.
+     */
+    vk::PipelineCache Get(void) const;
+
+    /**
+     * @brief Create the declared pipelines on the worker threads.
+     *
+     * Each recipe is submitted as a job to the job system, so the pipelines are compiled in parallel.
+     * The created pipelines are kept by this object and returned by Acquire.
+     * A recipe that fails on a worker thread is retried by Acquire.
+     *
+     * @param recipes The declarations of the pipelines.
+     */
+    void Prewarm(std::vector<PipelineRecipe> recipes);
+
+    /**
+     * @brief Get a pipeline, creating it if necessary.
+     *
+     * If the pipeline has been created by Prewarm or a previous call, it is returned immediately.
+     * Otherwise it is created on the calling thread.
+     *
+     * @param recipe The declaration of the pipeline.
+     *
+     * @return The pipeline, owned by this object.
+     */
+    vk::Pipeline Acquire(const PipelineRecipe& recipe);
+
+    /**
+     * @brief Save the cache to the cache file.
+     *
+     * The file is replaced atomically, so a crash never leaves a truncated cache behind.
+     */
+    void Save(void);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_PIPELINE_HPP
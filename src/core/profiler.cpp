@@ -0,0 +1,257 @@
+/**
+ * @file
+ * @brief
+ * Report the timings of the frames.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <string_view>
+#include "profiler.hpp"
+
+namespace Starlight::Core {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::size_t ringCapacity = 16384;
+constexpr double      bucketWidth  = 0.25;
+constexpr std::size_t bucketCount  = 1024;
+
+struct Event {
+    const char*   name;
+    std::uint64_t begin;
+    std::uint64_t end;
+};
+
+struct Ring {
+    std::mutex         mutex;
+    std::uint32_t      thread;
+    std::vector<Event> events;
+    std::uint64_t      head = 0;
+    std::uint64_t      tail = 0;
+};
+
+struct Registry {
+    std::mutex                         mutex;
+    std::vector<std::shared_ptr<Ring>> rings;
+    std::uint32_t                      threads = 0;
+};
+
+Registry& GetRegistry(void) {
+    static Registry registry;
+    return registry;
+}
+
+Clock::time_point GetEpoch(void) {
+    static const auto epoch = Clock::now();
+    return epoch;
+}
+
+std::uint64_t GetTicks(void) {
+    return static_cast<std::uint64_t>(Clock::now().time_since_epoch().count());
+}
+
+double ToMilliseconds(std::uint64_t ticks) {
+    auto time = Clock::time_point(Clock::duration(static_cast<Clock::rep>(ticks)));
+    return std::chrono::duration<double, std::milli>(time - GetEpoch()).count();
+}
+
+Ring& GetRing(void) {
+    thread_local auto ring = [] {
+        auto& registry = GetRegistry();
+        auto  ring     = std::make_shared<Ring>();
+        ring->events.resize(ringCapacity);
+        std::lock_guard lock(registry.mutex);
+        ring->thread = registry.threads++;
+        registry.rings.push_back(ring);
+        return ring;
+    }();
+    return *ring;
+}
+
+} // namespace
+
+static std::string EscapeJson(std::string_view text) {
+    std::string result;
+    for (auto c : text) {
+        switch (c) {
+        case '"':
+            result += "\\\"";
+            break;
+        case '\\':
+            result += "\\\\";
+            break;
+        case '\n':
+            result += "\\n";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                std::ostringstream code;
+                code << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<unsigned>(c);
+                result += code.str();
+            } else {
+                result += c;
+            }
+            break;
+        }
+    }
+    return result;
+}
+
+static void WriteEvent(std::ostream& stream, bool& first, std::string_view name, std::string_view category, std::size_t track, double begin, double duration) {
+    stream << (first ? "\n" : ",\n");
+    stream << R"({"name":")" << EscapeJson(name) << R"(","cat":")" << category << R"(","ph":"X","pid":0,"tid":)" << track;
+    stream << R"(,"ts":)" << begin * 1000.0 << R"(,"dur":)" << duration * 1000.0 << "}";
+    first = false;
+}
+
+static void WriteTrackName(std::ostream& stream, bool& first, std::size_t track, std::string_view name) {
+    stream << (first ? "\n" : ",\n");
+    stream << R"({"name":"thread_name","ph":"M","pid":0,"tid":)" << track << R"(,"args":{"name":")" << EscapeJson(name) << R"("}})";
+    first = false;
+}
+
+double GetProfilerTime(void) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - GetEpoch()).count();
+}
+
+ScopedZone::ScopedZone(const char* name) :
+name(name), begin(0) {
+    GetEpoch();
+    begin = GetTicks();
+}
+
+ScopedZone::~ScopedZone() {
+    auto  end  = GetTicks();
+    auto& ring = GetRing();
+    std::lock_guard lock(ring.mutex);
+    ring.events[ring.head++ % ringCapacity] = { name, begin, end };
+}
+
+std::vector<CpuZone> CollectCpuZones(void) {
+    auto& registry = GetRegistry();
+    std::lock_guard lock(registry.mutex);
+    std::vector<CpuZone> zones;
+    for (const auto& ring : registry.rings) {
+        std::lock_guard ringLock(ring->mutex);
+        ring->tail = std::max(ring->tail, ring->head > ringCapacity ? ring->head - ringCapacity : 0);
+        for (; ring->tail < ring->head; ++ring->tail) {
+            const auto& event = ring->events[ring->tail % ringCapacity];
+            zones.push_back({ event.name, ring->thread, ToMilliseconds(event.begin), ToMilliseconds(event.end) });
+        }
+    }
+    std::erase_if(registry.rings, [](const std::shared_ptr<Ring>& ring) { return ring.use_count() == 1; });
+    return zones;
+}
+
+struct FrameTimeHistogram::Impl {
+    mutable std::mutex                     mutex;
+    std::vector<double>                    samples;
+    std::size_t                            next  = 0;
+    std::size_t                            count = 0;
+    std::array<std::size_t, bucketCount + 1> buckets{};
+    static std::size_t GetBucket(double milliseconds) {
+        if (!(milliseconds > 0.0)) return 0;
+        return std::min(static_cast<std::size_t>(milliseconds / bucketWidth), bucketCount);
+    }
+    double GetPercentile(double fraction, double max) const {
+        auto rank = std::max<std::size_t>(static_cast<std::size_t>(std::ceil(fraction * count)), 1);
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < bucketCount; ++i) {
+            total += buckets[i];
+            if (total >= rank) return std::min((i + 1) * bucketWidth, max);
+        }
+        return max;
+    }
+};
+
+FrameTimeHistogram::FrameTimeHistogram(std::size_t window) :
+pImpl(std::make_unique<Impl>()) {
+    pImpl->samples.resize(std::max<std::size_t>(window, 1));
+}
+
+FrameTimeHistogram::~FrameTimeHistogram() {
+}
+
+void FrameTimeHistogram::Add(double milliseconds) {
+    std::lock_guard lock(pImpl->mutex);
+    auto& sample = pImpl->samples[pImpl->next];
+    if (pImpl->count == pImpl->samples.size()) {
+        --pImpl->buckets[Impl::GetBucket(sample)];
+    } else {
+        ++pImpl->count;
+    }
+    sample = milliseconds;
+    ++pImpl->buckets[Impl::GetBucket(sample)];
+    pImpl->next = (pImpl->next + 1) % pImpl->samples.size();
+}
+
+FrameTimeStats FrameTimeHistogram::GetStats(void) const {
+    std::lock_guard lock(pImpl->mutex);
+    FrameTimeStats stats;
+    if (!pImpl->count) return stats;
+    stats.count = pImpl->count;
+    stats.max   = *std::max_element(pImpl->samples.begin(), pImpl->samples.begin() + pImpl->count);
+    stats.p50   = pImpl->GetPercentile(0.50, stats.max);
+    stats.p95   = pImpl->GetPercentile(0.95, stats.max);
+    stats.p99   = pImpl->GetPercentile(0.99, stats.max);
+    return stats;
+}
+
+void WriteChromeTrace(std::ostream& stream, std::span<const FrameTiming> frames, std::span<const CpuZone> zones) {
+    std::uint32_t threads = 0;
+    for (const auto& zone : zones) threads = std::max(threads, zone.thread + 1);
+    std::vector<std::string> queues;
+    for (const auto& frame : frames) {
+        for (const auto& zone : frame.zones) {
+            if (std::ranges::find(queues, zone.queue) == queues.end()) queues.push_back(zone.queue);
+        }
+    }
+    std::ostringstream trace;
+    trace << std::fixed << std::setprecision(3);
+    auto first = true;
+    trace << R"({"displayTimeUnit":"ms","traceEvents":[)";
+    WriteTrackName(trace, first, 0, "CPU frames");
+    for (std::uint32_t i = 0; i < threads; ++i) WriteTrackName(trace, first, i + 1, "CPU thread " + std::to_string(i));
+    for (std::size_t i = 0; i < queues.size(); ++i) WriteTrackName(trace, first, threads + i + 1, "GPU " + queues[i]);
+    for (const auto& frame : frames) {
+        WriteEvent(trace, first, "Frame " + std::to_string(frame.frame), "cpu", 0, frame.cpuBegin, frame.cpuEnd - frame.cpuBegin);
+        for (const auto& zone : frame.zones) {
+            auto track = static_cast<std::size_t>(std::ranges::find(queues, zone.queue) - queues.begin()) + threads + 1;
+            WriteEvent(trace, first, zone.name, "gpu", track, frame.cpuEnd + zone.begin, zone.end - zone.begin);
+        }
+    }
+    for (const auto& zone : zones) {
+        WriteEvent(trace, first, zone.name ? zone.name : "", "cpu", zone.thread + 1, zone.begin, zone.end - zone.begin);
+    }
+    trace << "\n]}\n";
+    stream << trace.str();
+}
+
+} // namespace Starlight::Core
@@ -0,0 +1,198 @@
+/**
+ * @file
+ * @brief
+ * Report the timings of the frames.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_PROFILER_HPP
+#define STARLIGHT_CORE_PROFILER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace Starlight::Core {
+
+/**
+ * @brief A structure to hold a span of GPU time measured with timestamp queries.
+ */
+struct GpuZone final {
+    std::string name;  ///< The name of the zone, such as the name of a pass.
+    std::string queue; ///< The name of the queue that executed the zone.
+    double      begin; ///< The start of the zone in milliseconds from the first timestamp of the frame.
+    double      end;   ///< The end of the zone in milliseconds from the first timestamp of the frame.
+};
+
+/**
+ * @brief A structure to hold the CPU and GPU timings of a frame.
+ */
+struct FrameTiming final {
+    std::uint64_t        frame;    ///< The number of the frame, counted from 0 for each device.
+    double               cpuBegin; ///< The time in milliseconds on the profiler clock when the frame began.
+    double               cpuEnd;   ///< The time in milliseconds on the profiler clock when the frame was submitted.
+    double               gpuTime;  ///< The GPU time of the frame in milliseconds from the first to the last timestamp, or 0 if nothing was measured.
+    std::vector<GpuZone> zones;    ///< The GPU zones of the frame.
+};
+
+/**
+ * @brief A structure to hold a span of CPU time measured by a ScopedZone.
+ */
+struct CpuZone final {
+    const char*   name;   ///< The name of the zone.
+    std::uint32_t thread; ///< The index of the thread, in the order that the threads first recorded a zone.
+    double        begin;  ///< The start of the zone in milliseconds on the profiler clock.
+    double        end;    ///< The end of the zone in milliseconds on the profiler clock.
+};
+
+/**
+ * @brief A structure to hold the percentiles of the recent frame times.
+ */
+struct FrameTimeStats final {
+    std::size_t count = 0;   ///< The number of frames in the window.
+    double      p50   = 0.0; ///< The median frame time in milliseconds.
+    double      p95   = 0.0; ///< The 95th percentile of the frame times in milliseconds.
+    double      p99   = 0.0; ///< The 99th percentile of the frame times in milliseconds.
+    double      max   = 0.0; ///< The longest frame time in milliseconds.
+};
+
+/**
+ * @brief Get the time of the profiler clock.
+ *
+ * The profiler clock is a steady clock that starts when the process first uses the profiler.
+ *
+ * @return The time in milliseconds.
+ */
+double GetProfilerTime(void);
+
+/**
+ * @brief Measure the CPU time of a scope.
+ *
+ * This class records a zone from its construction to its destruction into a ring buffer of the calling thread,
+ * which only costs two clock reads and an uncontended lock, so it is cheap enough for hot paths.
+ * Each thread keeps its latest 16384 zones, and older zones are overwritten until they are collected.
+ * Use the STARLIGHT_ZONE macro, which compiles to nothing unless `STARLIGHT_PROFILING` is defined.
+ */
+class ScopedZone final {
+public:
+    /**
+     * @brief Begin a zone.
+     *
+     * @param name The name of the zone, which must outlive the profiler, such as a string literal.
+     */
+    explicit ScopedZone(const char* name);
+
+    /**
+     * @brief End the zone.
+     */
+    ~ScopedZone();
+
+    ScopedZone(const ScopedZone&) = delete;
+    ScopedZone& operator=(const ScopedZone&) = delete;
+
+private:
+    const char*   name;
+    std::uint64_t begin;
+};
+
+#ifdef STARLIGHT_PROFILING
+#define STARLIGHT_ZONE_CONCAT_IMPL(a, b) a##b
+#define STARLIGHT_ZONE_CONCAT(a, b) STARLIGHT_ZONE_CONCAT_IMPL(a, b)
+#define STARLIGHT_ZONE(name) ::Starlight::Core::ScopedZone STARLIGHT_ZONE_CONCAT(starlightZone, __LINE__)(name)
+#else
+#define STARLIGHT_ZONE(name) ((void)0)
+#endif
+
+/**
+ * @brief Collect the CPU zones recorded by all threads.
+ *
+ * This function takes the zones recorded since the previous call out of the ring buffers of the threads,
+ * including the threads that have exited since. It may be called from any thread.
+ *
+ * @return The zones, grouped by thread in the order they ended.
+ */
+std::vector<CpuZone> CollectCpuZones(void);
+
+/**
+ * @brief Count the recent frame times in a histogram.
+ *
+ * This class keeps the frame times of a rolling window in buckets of 0.25 milliseconds up to 256 milliseconds,
+ * so the percentiles are read from the histogram without sorting and with an error of at most one bucket.
+ * Longer frames are counted in an overflow bucket whose percentile is the longest frame time.
+ * All methods are thread safe.
+ */
+class FrameTimeHistogram final {
+public:
+    /**
+     * @brief Construct a new FrameTimeHistogram object.
+     *
+     * @param window The number of recent frames to keep.
+     */
+    explicit FrameTimeHistogram(std::size_t window = 600);
+
+    /**
+     * @brief Destruct the FrameTimeHistogram object.
+     */
+    ~FrameTimeHistogram();
+
+    /**
+     * @brief Add a frame time.
+     *
+     * The oldest frame time is dropped when the window is full.
+     *
+     * @param milliseconds The frame time in milliseconds.
+     */
+    void Add(double milliseconds);
+
+    /**
+     * @brief Get the percentiles of the frame times in the window.
+     *
+     * @return The statistics of the frame times.
+     */
+    FrameTimeStats GetStats(void) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+/**
+ * @brief Write frame timings as a Chrome trace.
+ *
+ * This function writes the frames in the JSON trace event format,
+ * which can be opened with `chrome://tracing` or Perfetto.
+ * The CPU span of each frame is put on its own track, the CPU zones on a track per thread, and the GPU zones on a track per queue.
+ * The GPU clock is not calibrated against the CPU clock,
+ * so the GPU zones of a frame are placed from the time the frame was submitted.
+ *
+ * @param stream The stream to write to.
+ * @param frames The timings of the frames.
+ * @param zones  The CPU zones, such as the ones returned by CollectCpuZones.
+ */
+void WriteChromeTrace(std::ostream& stream, std::span<const FrameTiming> frames, std::span<const CpuZone> zones = {});
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_PROFILER_HPP
@@ -0,0 +1,83 @@
+/**
+ * @file
+ * @brief
+ * Record command buffers on multiple threads.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <array>
+#include <vector>
+#include "recorder.hpp"
+
+namespace Starlight::Core {
+
+struct Recorder::Impl {
+    struct Context {
+        vk::UniqueCommandPool                               pool;
+        std::array<std::vector<vk::UniqueCommandBuffer>, 2> buffers;
+        std::array<std::size_t, 2>                          used{};
+    };
+    vk::Device                        device;
+    std::uint32_t                     family;
+    std::vector<std::vector<Context>> frames;
+    std::size_t                       frameSlot;
+    Impl(vk::Device device, std::uint32_t family, std::size_t frameCount) :
+    device(device), family(family), frames(frameCount), frameSlot(0) {
+    }
+};
+
+Recorder::Recorder(vk::Device device, std::uint32_t family, std::size_t frameCount) :
+pImpl(std::make_unique<Impl>(device, family, frameCount)) {
+}
+
+Recorder::~Recorder() {
+}
+
+void Recorder::BeginFrame(std::size_t frameSlot) {
+    pImpl->frameSlot = frameSlot;
+    for (auto& context : pImpl->frames[frameSlot]) {
+        if (!context.used[0] && !context.used[1]) continue;
+        pImpl->device.resetCommandPool(*context.pool);
+        context.used = {};
+    }
+}
+
+void Recorder::Reserve(std::size_t contextCount) {
+    auto& contexts = pImpl->frames[pImpl->frameSlot];
+    while (contexts.size() < contextCount) {
+        vk::CommandPoolCreateInfo info(vk::CommandPoolCreateFlagBits::eTransient, pImpl->family);
+        contexts.emplace_back().pool = pImpl->device.createCommandPoolUnique(info);
+    }
+}
+
+vk::CommandBuffer Recorder::Allocate(std::size_t context, vk::CommandBufferLevel level) {
+    auto& target  = pImpl->frames[pImpl->frameSlot][context];
+    auto  index   = level == vk::CommandBufferLevel::ePrimary ? 0 : 1;
+    auto& buffers = target.buffers[index];
+    auto& used    = target.used[index];
+    if (used == buffers.size()) {
+        vk::CommandBufferAllocateInfo info(*target.pool, level, 1);
+        buffers.push_back(std::move(pImpl->device.allocateCommandBuffersUnique(info).front()));
+    }
+    return *buffers[used++];
+}
+
+} // namespace Starlight::Core
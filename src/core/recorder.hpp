@@ -0,0 +1,102 @@
+/**
+ * @file
+ * @brief
+ * Record command buffers on multiple threads.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_RECORDER_HPP
+#define STARLIGHT_CORE_RECORDER_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vulkan/vulkan.hpp>
+
+namespace Starlight::Core {
+
+/**
+ * @brief Record command buffers on multiple threads.
+ *
+ * This class owns a transient command pool per recording context and frame slot.
+ * A command pool must only be used by one thread at a time,
+ * so each thread records into its own context and the buffers never contend for a pool.
+ * All pools of a frame slot are reset at once when the slot is reused, instead of resetting individual buffers.
+ *
+ * Usage:
+ * - Call BeginFrame on the main thread once the GPU has retired the frame slot.
+ * - Call Reserve on the main thread with the number of contexts before dispatching the work.
+ * - Call Allocate on each worker thread with its own context index.
+ */
+class Recorder final {
+public:
+    /**
+     * @brief Construct a new Recorder object.
+     *
+     * @param device     The logical device.
+     * @param family     The queue family index that the command buffers are submitted to.
+     * @param frameCount The number of frame slots.
+     */
+    Recorder(vk::Device device, std::uint32_t family, std::size_t frameCount);
+
+    /**
+     * @brief Destruct the Recorder object.
+     */
+    ~Recorder();
+
+    /**
+     * @brief Begin recording a frame slot.
+     *
+     * All command buffers previously allocated for the frame slot are recycled.
+     * The GPU must have finished executing them.
+     *
+     * @param frameSlot The frame slot to record.
+     */
+    void BeginFrame(std::size_t frameSlot);
+
+    /**
+     * @brief Reserve recording contexts for the current frame slot.
+     *
+     * This method is not thread safe and must be called before the contexts are used.
+     *
+     * @param contextCount The number of contexts.
+     */
+    void Reserve(std::size_t contextCount);
+
+    /**
+     * @brief Allocate a command buffer from a context.
+     *
+     * This method may be called concurrently for different contexts.
+     *
+     * @param context The index of the context.
+     * @param level   The level of the command buffer.
+     *
+     * @return The command buffer, in the initial state.
+     */
+    vk::CommandBuffer Allocate(std::size_t context, vk::CommandBufferLevel level = vk::CommandBufferLevel::eSecondary);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_RECORDER_HPP
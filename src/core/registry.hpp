@@ -0,0 +1,70 @@
+/**
+ * @file
+ * @brief
+ * Keep resources in slots addressed by handles.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_REGISTRY_HPP
+#define STARLIGHT_CORE_REGISTRY_HPP
+
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace Starlight::Core {
+
+/**
+ * @brief Keep resources in slots addressed by handles.
+ *
+ * The index of a slot is the value of the handle of its resource, and the slots of removed resources are reused.
+ * It is not thread safe.
+ */
+template <typename T>
+struct Registry {
+    std::vector<std::optional<T>> slots;
+    std::vector<std::uint32_t>    freeSlots;
+    std::uint32_t Add(T&& value) {
+        if (freeSlots.empty()) {
+            slots.emplace_back(std::move(value));
+            return slots.size() - 1;
+        }
+        auto index = freeSlots.back();
+        freeSlots.pop_back();
+        slots[index].emplace(std::move(value));
+        return index;
+    }
+    T& Get(std::uint32_t index) {
+        if (index >= slots.size() || !slots[index]) throw std::runtime_error("Invalid resource handle");
+        return *slots[index];
+    }
+    void Remove(std::uint32_t index) {
+        Get(index);
+        slots[index].reset();
+        freeSlots.push_back(index);
+    }
+};
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_REGISTRY_HPP
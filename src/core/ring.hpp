@@ -0,0 +1,118 @@
+/**
+ * @file
+ * @brief
+ * Pass values between two threads through a lock-free ring buffer.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_RING_HPP
+#define STARLIGHT_CORE_RING_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace Starlight::Core {
+
+/**
+ * @brief A lock-free ring buffer with a single producer and a single consumer.
+ *
+ * This class passes values from one thread to another without locks or allocations.
+ * The producer and the consumer each keep their own index on their own cache line,
+ * and only read the index of the other when the ring looks full or empty, so they rarely share a cache line.
+ * TryPush must only be called by the producer thread and TryPop by the consumer thread.
+ *
+ * @tparam T The type of the values, which is copied into and out of the ring.
+ */
+template <typename T>
+class SpscRing final {
+public:
+    /**
+     * @brief Construct a new SpscRing object.
+     *
+     * @param capacity The number of values the ring holds, rounded up to a power of two.
+     */
+    explicit SpscRing(std::size_t capacity) : slots(std::bit_ceil(std::max<std::size_t>(capacity, 2))), mask(slots.size() - 1) {
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /**
+     * @brief Push a value.
+     *
+     * @param value The value to push.
+     *
+     * @return true if the value has been pushed, false if the ring is full.
+     */
+    bool TryPush(const T& value) {
+        auto tail = producer.index.load(std::memory_order_relaxed);
+        if (tail - producer.cached == slots.size()) {
+            producer.cached = consumer.index.load(std::memory_order_acquire);
+            if (tail - producer.cached == slots.size()) return false;
+        }
+        slots[tail & mask] = value;
+        producer.index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Pop a value.
+     *
+     * @return The oldest value, or nothing if the ring is empty.
+     */
+    std::optional<T> TryPop(void) {
+        auto head = consumer.index.load(std::memory_order_relaxed);
+        if (head == consumer.cached) {
+            consumer.cached = producer.index.load(std::memory_order_acquire);
+            if (head == consumer.cached) return std::nullopt;
+        }
+        std::optional<T> value(slots[head & mask]);
+        consumer.index.store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+    /**
+     * @brief Get the capacity of the ring.
+     *
+     * @return The number of values the ring holds.
+     */
+    std::size_t GetCapacity(void) const {
+        return slots.size();
+    }
+
+private:
+    struct alignas(64) Side {
+        std::atomic<std::size_t> index{ 0 };
+        std::size_t              cached = 0;
+    };
+    std::vector<T>    slots;
+    std::size_t       mask;
+    Side              producer;
+    Side              consumer;
+};
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_RING_HPP
@@ -0,0 +1,144 @@
+/**
+ * @file
+ * @brief
+ * Remember the GPU chosen for the device between runs.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <cstring>
+#include <fstream>
+#include "selection.hpp"
+
+namespace Starlight::Core {
+
+namespace {
+
+constexpr std::uint32_t Magic = 0x44534c53; // "SLSD"
+
+struct Record {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t key;
+    std::uint32_t index;
+    std::uint32_t flags;
+    std::uint64_t deviceLocalBytes;
+    std::uint32_t families[3];
+    std::uint32_t indices[3];
+};
+
+enum RecordFlag : std::uint32_t {
+    MemoryBudget      = 1 << 0,
+    IndirectCount     = 1 << 1,
+    DedicatedCompute  = 1 << 2,
+    DedicatedTransfer = 1 << 3,
+    SharedCompute     = 1 << 4,
+    SharedTransfer    = 1 << 5,
+};
+
+std::uint64_t HashBytes(std::uint64_t hash, const void* data, std::size_t size) {
+    for (auto byte : std::span(static_cast<const unsigned char*>(data), size)) {
+        hash ^= byte;
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+template <typename T>
+std::uint64_t HashValue(std::uint64_t hash, const T& value) {
+    return HashBytes(hash, &value, sizeof(value));
+}
+
+} // namespace
+
+SelectionCache::SelectionCache(const std::filesystem::path& directory, std::span<const vk::PhysicalDevice> devices, bool headless) :
+key(0xcbf29ce484222325), count(devices.size()) {
+    if (directory.empty()) return;
+    path = directory / (headless ? "device-headless.bin" : "device-window.bin");
+    key  = HashValue(key, count);
+    for (auto device : devices) {
+        auto properties = device.getProperties();
+        key = HashValue(key, properties.vendorID);
+        key = HashValue(key, properties.deviceID);
+        key = HashValue(key, properties.driverVersion);
+        key = HashValue(key, properties.apiVersion);
+        key = HashBytes(key, properties.pipelineCacheUUID.data(), VK_UUID_SIZE);
+    }
+}
+
+std::optional<DeviceSelection> SelectionCache::Load(void) const {
+    if (path.empty()) return std::nullopt;
+    std::ifstream file(path, std::ios::binary);
+    Record record;
+    if (!file.read(reinterpret_cast<char*>(&record), sizeof(record))) return std::nullopt;
+    if (record.magic != Magic || record.version != FormatVersion || record.key != key) return std::nullopt;
+    if (record.index >= count) return std::nullopt;
+    DeviceSelection selection;
+    selection.index                      = record.index;
+    selection.topology.graphicsFamily    = record.families[0];
+    selection.topology.computeFamily     = record.families[1];
+    selection.topology.transferFamily    = record.families[2];
+    selection.topology.graphicsIndex     = record.indices[0];
+    selection.topology.computeIndex      = record.indices[1];
+    selection.topology.transferIndex     = record.indices[2];
+    selection.topology.dedicatedCompute  = record.flags & DedicatedCompute;
+    selection.topology.dedicatedTransfer = record.flags & DedicatedTransfer;
+    selection.topology.sharedCompute     = record.flags & SharedCompute;
+    selection.topology.sharedTransfer    = record.flags & SharedTransfer;
+    selection.deviceLocalBytes           = record.deviceLocalBytes;
+    selection.memoryBudget               = record.flags & MemoryBudget;
+    selection.indirectCount              = record.flags & IndirectCount;
+    return selection;
+}
+
+void SelectionCache::Store(const DeviceSelection& selection) const {
+    if (path.empty()) return;
+    const auto& topology = selection.topology;
+    Record record{};
+    record.magic            = Magic;
+    record.version          = FormatVersion;
+    record.key              = key;
+    record.index            = selection.index;
+    record.deviceLocalBytes = selection.deviceLocalBytes;
+    record.families[0]      = topology.graphicsFamily;
+    record.families[1]      = topology.computeFamily;
+    record.families[2]      = topology.transferFamily;
+    record.indices[0]       = topology.graphicsIndex;
+    record.indices[1]       = topology.computeIndex;
+    record.indices[2]       = topology.transferIndex;
+    if (selection.memoryBudget      ) record.flags |= MemoryBudget;
+    if (selection.indirectCount     ) record.flags |= IndirectCount;
+    if (topology.dedicatedCompute   ) record.flags |= DedicatedCompute;
+    if (topology.dedicatedTransfer  ) record.flags |= DedicatedTransfer;
+    if (topology.sharedCompute      ) record.flags |= SharedCompute;
+    if (topology.sharedTransfer     ) record.flags |= SharedTransfer;
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+    auto temp = path;
+    temp += ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        if (!file) return;
+    }
+    std::filesystem::rename(temp, path, error);
+}
+
+} // namespace Starlight::Core
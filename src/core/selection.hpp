@@ -0,0 +1,99 @@
+/**
+ * @file
+ * @brief
+ * Remember the GPU chosen for the device between runs.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_SELECTION_HPP
+#define STARLIGHT_CORE_SELECTION_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vulkan/vulkan.hpp>
+#include "device.hpp"
+
+namespace Starlight::Core {
+
+/**
+ * @brief A structure to hold the physical device chosen for a device and the properties derived from it.
+ */
+struct DeviceSelection final {
+    std::uint32_t index;            ///< The index of the physical device in the order the instance enumerates them.
+    QueueTopology topology;         ///< The queues chosen on the physical device.
+    std::uint64_t deviceLocalBytes; ///< The total size of the device local memory heaps.
+    bool          memoryBudget;     ///< Whether the physical device supports VK_EXT_memory_budget.
+    bool          indirectCount;    ///< Whether the physical device supports drawing with an indirect count.
+};
+
+/**
+ * @brief Cache the device selection on disk.
+ *
+ * Choosing a physical device queries the properties, features, extensions and queue families of every GPU,
+ * which is a large part of the startup time on some drivers.
+ * This class keeps the last selection in a small file, keyed by the identity and driver version of all enumerated GPUs,
+ * so the selection is reused only while the same GPUs with the same drivers are present, in the same order.
+ * The key is computed from the basic properties of the GPUs, which is the only query made when the cache hits.
+ * All methods are thread safe.
+ */
+class SelectionCache final {
+public:
+    /**
+     * @brief The version of the file format.
+     */
+    static constexpr std::uint32_t FormatVersion = 1;
+
+    /**
+     * @brief Construct a new SelectionCache object.
+     *
+     * @param directory The directory to keep the cache file in, or empty to disable the cache.
+     * @param devices   The physical devices enumerated by the instance.
+     * @param headless  Whether the selection is made for a device without a window, which is kept in its own file.
+     */
+    SelectionCache(const std::filesystem::path& directory, std::span<const vk::PhysicalDevice> devices, bool headless);
+
+    /**
+     * @brief Load the cached selection.
+     *
+     * @return The selection, or nothing if the file is missing, invalid or was written for other GPUs.
+     */
+    std::optional<DeviceSelection> Load(void) const;
+
+    /**
+     * @brief Store a selection.
+     *
+     * The file is replaced atomically, and errors are ignored because the cache is only an optimization.
+     *
+     * @param selection The selection to store.
+     */
+    void Store(const DeviceSelection& selection) const;
+
+private:
+    std::filesystem::path path;
+    std::uint64_t         key;
+    std::size_t           count;
+};
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_SELECTION_HPP
@@ -0,0 +1,339 @@
+/**
+ * @file
+ * @brief
+ * Read the settings and the asset manifest from a memory-mapped binary file.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include "mapping.hpp"
+#include "settings.hpp"
+
+namespace Starlight::Core {
+
+static_assert(std::endian::native == std::endian::little, "The settings file is little-endian");
+
+namespace {
+
+constexpr char          Magic[8]  = { 'S', 'T', 'L', 'S', 'E', 'T', 'S', '\0' };
+constexpr std::uint32_t EmptySlot = 0xffffffff;
+
+enum class RecordType : std::uint32_t {
+    Integer = 1,
+    Real    = 2,
+    String  = 3,
+    Asset   = 4,
+};
+
+struct Header {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t recordCount;
+    std::uint32_t indexSize;
+    std::uint32_t stringSize;
+    std::uint64_t fileSize;
+};
+
+struct Record {
+    std::uint64_t hash;
+    std::uint32_t nameOffset;
+    std::uint32_t nameSize;
+    RecordType    type;
+    std::uint32_t reserved;
+    std::uint64_t value;
+};
+
+static_assert(sizeof(Header) == 32);
+static_assert(sizeof(Record) == 32);
+
+std::uint64_t PackString(std::uint32_t offset, std::uint32_t size) {
+    return offset | static_cast<std::uint64_t>(size) << 32;
+}
+
+} // namespace
+
+struct SettingsFile::Impl {
+    std::unique_ptr<MappedFile> file;
+    const std::byte*            data;
+    std::size_t                 size;
+    const Header*               header;
+    const Record*               records;
+    const std::uint32_t*        index;
+    const char*                 strings;
+    void Validate(void) {
+        if (size < sizeof(Header)) throw std::runtime_error("Invalid settings file");
+        header = reinterpret_cast<const Header*>(data);
+        if (std::memcmp(header->magic, Magic, sizeof(Magic))) throw std::runtime_error("Invalid settings file");
+        if (header->version != FormatVersion) throw std::runtime_error("Unsupported settings file version");
+        if (header->fileSize != size) throw std::runtime_error("Truncated settings file");
+        auto indexSize = header->indexSize;
+        if (!std::has_single_bit(indexSize) || indexSize <= header->recordCount) throw std::runtime_error("Invalid settings file");
+        auto expected = sizeof(Header) + std::uint64_t(header->recordCount) * sizeof(Record) + std::uint64_t(indexSize) * sizeof(std::uint32_t) + header->stringSize;
+        if (expected != size) throw std::runtime_error("Invalid settings file");
+        records = reinterpret_cast<const Record*>(data + sizeof(Header));
+        index   = reinterpret_cast<const std::uint32_t*>(records + header->recordCount);
+        strings = reinterpret_cast<const char*>(index + indexSize);
+        for (std::uint32_t i = 0; i < indexSize; ++i) {
+            if (index[i] != EmptySlot && index[i] >= header->recordCount) throw std::runtime_error("Invalid settings file");
+        }
+        for (std::uint32_t i = 0; i < header->recordCount; ++i) {
+            const auto& record = records[i];
+            if (std::uint64_t(record.nameOffset) + record.nameSize > header->stringSize) throw std::runtime_error("Invalid settings file");
+            switch (record.type) {
+            case RecordType::Integer:
+            case RecordType::Real:
+                break;
+            case RecordType::String:
+            case RecordType::Asset:
+                if ((record.value & 0xffffffff) + (record.value >> 32) > header->stringSize) throw std::runtime_error("Invalid settings file");
+                break;
+            default:
+                throw std::runtime_error("Invalid settings file");
+            }
+        }
+    }
+    std::string_view GetName(const Record& record) const {
+        return std::string_view(strings + record.nameOffset, record.nameSize);
+    }
+    std::string_view GetText(const Record& record) const {
+        return std::string_view(strings + (record.value & 0xffffffff), record.value >> 32);
+    }
+    const Record* Find(SettingKey key) const {
+        auto mask = header->indexSize - 1;
+        auto slot = static_cast<std::uint32_t>(key.GetHash()) & mask;
+        for (std::uint32_t probe = 0; probe < header->indexSize; ++probe, slot = (slot + 1) & mask) {
+            auto found = index[slot];
+            if (found == EmptySlot) return nullptr;
+            const auto& record = records[found];
+            if (record.hash == key.GetHash() && GetName(record) == key.GetName()) return &record;
+        }
+        return nullptr;
+    }
+};
+
+SettingsFile::SettingsFile(const std::filesystem::path& path) :
+pImpl(std::make_unique<Impl>()) {
+    pImpl->file = std::make_unique<MappedFile>(path);
+    pImpl->data = pImpl->file->GetData().data();
+    pImpl->size = pImpl->file->GetData().size();
+    pImpl->Validate();
+}
+
+SettingsFile::~SettingsFile() {
+}
+
+std::optional<std::int64_t> SettingsFile::GetInteger(SettingKey key) const {
+    auto record = pImpl->Find(key);
+    if (!record || record->type != RecordType::Integer) return std::nullopt;
+    return std::bit_cast<std::int64_t>(record->value);
+}
+
+std::optional<double> SettingsFile::GetReal(SettingKey key) const {
+    auto record = pImpl->Find(key);
+    if (!record) return std::nullopt;
+    if (record->type == RecordType::Integer) return static_cast<double>(std::bit_cast<std::int64_t>(record->value));
+    if (record->type == RecordType::Real   ) return std::bit_cast<double>(record->value);
+    return std::nullopt;
+}
+
+std::optional<std::string_view> SettingsFile::GetString(SettingKey key) const {
+    auto record = pImpl->Find(key);
+    if (!record || record->type != RecordType::String) return std::nullopt;
+    return pImpl->GetText(*record);
+}
+
+std::optional<std::string_view> SettingsFile::GetAsset(SettingKey key) const {
+    auto record = pImpl->Find(key);
+    if (!record || record->type != RecordType::Asset) return std::nullopt;
+    return pImpl->GetText(*record);
+}
+
+std::vector<std::pair<std::string_view, std::string_view>> SettingsFile::GetAssets(void) const {
+    std::vector<std::pair<std::string_view, std::string_view>> assets;
+    for (std::uint32_t i = 0; i < pImpl->header->recordCount; ++i) {
+        const auto& record = pImpl->records[i];
+        if (record.type == RecordType::Asset) assets.emplace_back(pImpl->GetName(record), pImpl->GetText(record));
+    }
+    return assets;
+}
+
+namespace {
+
+struct Entry {
+    std::string   name;
+    RecordType    type;
+    std::uint64_t value;
+    std::string   text;
+    std::size_t   line;
+};
+
+[[noreturn]] void ThrowSyntaxError(std::size_t line, const std::string& message) {
+    throw std::runtime_error("Settings line " + std::to_string(line) + ": " + message);
+}
+
+std::string_view Trim(std::string_view text) {
+    auto begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string_view::npos) return {};
+    auto end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+std::string ParseQuoted(std::string_view text, std::size_t line) {
+    if (text.size() < 2 || text.front() != '"') ThrowSyntaxError(line, "Expected a string");
+    std::string result;
+    for (std::size_t i = 1; i < text.size(); ++i) {
+        auto c = text[i];
+        if (c == '"') {
+            if (!Trim(text.substr(i + 1)).empty()) ThrowSyntaxError(line, "Unexpected text after the string");
+            return result;
+        }
+        if (c == '\\') {
+            if (++i == text.size()) break;
+            switch (text[i]) {
+            case '"':  result += '"';  break;
+            case '\\': result += '\\'; break;
+            case 'n':  result += '\n'; break;
+            case 't':  result += '\t'; break;
+            default:   ThrowSyntaxError(line, "Unknown escape sequence");
+            }
+            continue;
+        }
+        result += c;
+    }
+    ThrowSyntaxError(line, "Unterminated string");
+}
+
+std::string_view StripComment(std::string_view text) {
+    auto quoted = false;
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (quoted && text[i] == '\\') ++i;
+        else if (text[i] == '"') quoted = !quoted;
+        else if (!quoted && text[i] == '#') return text.substr(0, i);
+    }
+    return text;
+}
+
+Entry ParseEntry(std::string_view text, std::size_t line) {
+    auto equal = text.find('=');
+    if (equal == std::string_view::npos) ThrowSyntaxError(line, "Expected 'name = value'");
+    auto name  = Trim(text.substr(0, equal));
+    auto value = Trim(text.substr(equal + 1));
+    if (name.empty()) ThrowSyntaxError(line, "Missing name");
+    for (auto c : name) {
+        auto valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '.' || c == '-';
+        if (!valid) ThrowSyntaxError(line, "Invalid character in the name");
+    }
+    if (value.empty()) ThrowSyntaxError(line, "Missing value");
+    Entry entry { std::string(name), RecordType::Integer, 0, {}, line };
+    if (value.front() == '"') {
+        entry.type = RecordType::String;
+        entry.text = ParseQuoted(value, line);
+    } else if (value.starts_with("asset") && value.size() > 5 && (value[5] == ' ' || value[5] == '\t')) {
+        entry.type = RecordType::Asset;
+        entry.text = ParseQuoted(Trim(value.substr(5)), line);
+    } else if (value.find_first_of(".eE") == std::string_view::npos || value.starts_with("0x")) {
+        std::int64_t integer = 0;
+        auto base   = value.starts_with("0x") ? 16 : 10;
+        auto digits = base == 16 ? value.substr(2) : value;
+        auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), integer, base);
+        if (error != std::errc() || end != digits.data() + digits.size()) ThrowSyntaxError(line, "Invalid integer");
+        entry.value = std::bit_cast<std::uint64_t>(integer);
+    } else {
+        double real = 0.0;
+        auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), real);
+        if (error != std::errc() || end != value.data() + value.size()) ThrowSyntaxError(line, "Invalid real number");
+        entry.type  = RecordType::Real;
+        entry.value = std::bit_cast<std::uint64_t>(real);
+    }
+    return entry;
+}
+
+} // namespace
+
+std::vector<std::byte> SettingsFile::Compile(std::string_view source) {
+    std::vector<Entry> entries;
+    std::size_t line = 0;
+    while (!source.empty()) {
+        auto end  = source.find('\n');
+        auto text = Trim(StripComment(source.substr(0, end)));
+        source = end == std::string_view::npos ? std::string_view() : source.substr(end + 1);
+        ++line;
+        if (!text.empty()) entries.push_back(ParseEntry(text, line));
+    }
+    std::ranges::sort(entries, {}, &Entry::name);
+    for (std::size_t i = 1; i < entries.size(); ++i) {
+        if (entries[i].name == entries[i - 1].name) ThrowSyntaxError(entries[i].line, "Duplicate name '" + entries[i].name + "'");
+    }
+    std::string strings;
+    auto append = [&](const std::string& text) {
+        if (strings.size() + text.size() > EmptySlot) throw std::runtime_error("Too many settings");
+        auto offset = static_cast<std::uint32_t>(strings.size());
+        strings += text;
+        return PackString(offset, static_cast<std::uint32_t>(text.size()));
+    };
+    if (entries.size() >= EmptySlot / 2) throw std::runtime_error("Too many settings");
+    std::vector<Record> records;
+    for (const auto& entry : entries) {
+        Record record {};
+        record.hash = HashSettingKey(entry.name);
+        auto name = append(entry.name);
+        record.nameOffset = static_cast<std::uint32_t>(name & 0xffffffff);
+        record.nameSize   = static_cast<std::uint32_t>(name >> 32);
+        record.type       = entry.type;
+        record.value      = entry.type == RecordType::String || entry.type == RecordType::Asset ? append(entry.text) : entry.value;
+        records.push_back(record);
+    }
+    auto indexSize = std::bit_ceil(static_cast<std::uint32_t>(records.size() * 2 + 1));
+    std::vector<std::uint32_t> index(indexSize, EmptySlot);
+    for (std::uint32_t i = 0; i < records.size(); ++i) {
+        auto slot = static_cast<std::uint32_t>(records[i].hash) & (indexSize - 1);
+        while (index[slot] != EmptySlot) {
+            if (records[index[slot]].hash == records[i].hash) ThrowSyntaxError(entries[i].line, "Hash collision with '" + entries[index[slot]].name + "'");
+            slot = (slot + 1) & (indexSize - 1);
+        }
+        index[slot] = i;
+    }
+    Header header {};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version     = FormatVersion;
+    header.recordCount = static_cast<std::uint32_t>(records.size());
+    header.indexSize   = indexSize;
+    header.stringSize  = static_cast<std::uint32_t>(strings.size());
+    header.fileSize    = sizeof(Header) + records.size() * sizeof(Record) + index.size() * sizeof(std::uint32_t) + strings.size();
+    std::vector<std::byte> file(header.fileSize);
+    auto output = file.data();
+    auto write  = [&](const void* data, std::size_t size) {
+        if (size) std::memcpy(output, data, size);
+        output += size;
+    };
+    write(&header       , sizeof(header));
+    write(records.data(), records.size() * sizeof(Record));
+    write(index.data()  , index.size() * sizeof(std::uint32_t));
+    write(strings.data(), strings.size());
+    return file;
+}
+
+} // namespace Starlight::Core
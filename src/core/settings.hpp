@@ -0,0 +1,214 @@
+/**
+ * @file
+ * @brief
+ * Read the settings and the asset manifest from a memory-mapped binary file.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_SETTINGS_HPP
+#define STARLIGHT_CORE_SETTINGS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Starlight::Core {
+
+/**
+ * @brief Hash the name of a setting.
+ *
+ * This function computes the 64-bit FNV-1a hash that the settings file indexes its keys by.
+ *
+ * @param name The name of the setting.
+ *
+ * @return The hash of the name.
+ */
+constexpr std::uint64_t HashSettingKey(std::string_view name) {
+    std::uint64_t hash = 0xcbf29ce484222325;
+    for (auto c : name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+/**
+ * @brief A key of a setting.
+ *
+ * A key is implicitly constructed from a string literal at compile time, so a lookup only probes the hashed index.
+ * Use FromName for the names that are only known at runtime.
+ */
+class SettingKey final {
+public:
+    /**
+     * @brief Construct a key from a name at compile time.
+     *
+     * @param name The name of the setting.
+     */
+    consteval SettingKey(const char* name) : hash(HashSettingKey(name)), name(name) {
+    }
+
+    /**
+     * @brief Construct a key from a name at runtime.
+     *
+     * @param name The name of the setting, which must outlive the key.
+     *
+     * @return The key.
+     */
+    static constexpr SettingKey FromName(std::string_view name) {
+        return SettingKey(HashSettingKey(name), name);
+    }
+
+    /**
+     * @brief Get the hash of the key.
+     *
+     * @return The hash of the name.
+     */
+    constexpr std::uint64_t GetHash(void) const {
+        return hash;
+    }
+
+    /**
+     * @brief Get the name of the key.
+     *
+     * @return The name of the setting.
+     */
+    constexpr std::string_view GetName(void) const {
+        return name;
+    }
+
+private:
+    constexpr SettingKey(std::uint64_t hash, std::string_view name) : hash(hash), name(name) {
+    }
+
+    std::uint64_t    hash;
+    std::string_view name;
+};
+
+/**
+ * @brief Read a settings file.
+ *
+ * This class maps a settings file read-only, so loading it does not parse anything
+ * and the pages are shared by all processes that map the same file.
+ * The file consists of a header, fixed-layout records sorted by key, a hashed index of the records and a string table.
+ * All offsets and sizes are validated when the file is mapped, so lookups never read outside the mapping.
+ * The file is written by Compile from a text source, see Compile for the syntax.
+ * The file must not be modified while it is mapped.
+ * All methods are thread safe.
+ */
+class SettingsFile final {
+public:
+    /**
+     * @brief The version of the file format.
+     */
+    static constexpr std::uint32_t FormatVersion = 1;
+
+    /**
+     * @brief Map a settings file.
+     *
+     * @param path The path of the settings file.
+     *
+     * @throw std::runtime_error If the file cannot be mapped or is not a valid settings file.
+     */
+    explicit SettingsFile(const std::filesystem::path& path);
+
+    /**
+     * @brief Unmap the settings file.
+     */
+    ~SettingsFile();
+
+    SettingsFile(const SettingsFile&) = delete;
+    SettingsFile& operator=(const SettingsFile&) = delete;
+
+    /**
+     * @brief Get an integer setting.
+     *
+     * @param key The key of the setting.
+     *
+     * @return The value, or nothing if the setting is missing or is not an integer.
+     */
+    std::optional<std::int64_t> GetInteger(SettingKey key) const;
+
+    /**
+     * @brief Get a real setting.
+     *
+     * Integer settings are converted to real numbers.
+     *
+     * @param key The key of the setting.
+     *
+     * @return The value, or nothing if the setting is missing or is not a number.
+     */
+    std::optional<double> GetReal(SettingKey key) const;
+
+    /**
+     * @brief Get a string setting.
+     *
+     * @param key The key of the setting.
+     *
+     * @return The value, which stays valid while this object lives, or nothing if the setting is missing or is not a string.
+     */
+    std::optional<std::string_view> GetString(SettingKey key) const;
+
+    /**
+     * @brief Get the path of an asset in the manifest.
+     *
+     * @param key The name of the asset.
+     *
+     * @return The path, which stays valid while this object lives, or nothing if the asset is missing.
+     */
+    std::optional<std::string_view> GetAsset(SettingKey key) const;
+
+    /**
+     * @brief Get all assets in the manifest.
+     *
+     * @return The pairs of the name and the path of the assets, sorted by name, which stay valid while this object lives.
+     */
+    std::vector<std::pair<std::string_view, std::string_view>> GetAssets(void) const;
+
+    /**
+     * @brief Compile a text source into a settings file.
+     *
+     * The source has a setting per line in the form `name = value`, and `#` begins a comment.
+     * A value is an integer such as `42`, a real number such as `0.5`,
+     * a string in double quotes such as `"Starlight"`, or an asset path such as `asset "textures/sky.ktx2"`.
+     * Strings support the escape sequences `\"`, `\\`, `\n` and `\t`.
+     *
+     * @param source The text source.
+     *
+     * @return The contents of the settings file.
+     *
+     * @throw std::runtime_error If the source is invalid or two names collide, with the line number in the message.
+     */
+    static std::vector<std::byte> Compile(std::string_view source);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_SETTINGS_HPP
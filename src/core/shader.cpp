@@ -0,0 +1,86 @@
+/**
+ * @file
+ * @brief
+ * Load the shader modules and specialize their constants.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "mapping.hpp"
+#include "shader.hpp"
+
+namespace Starlight::Core {
+
+static constexpr std::uint32_t SpirvMagic = 0x07230203;
+
+static std::uint64_t HashCode(std::span<const std::uint32_t> code) {
+    std::uint64_t hash = 0xcbf29ce484222325;
+    for (auto word : code) {
+        hash ^= word;
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+struct ShaderCache::Impl {
+    struct Entry {
+        std::vector<std::uint32_t>           code;
+        vk::UniqueShaderModule               module;
+    };
+    vk::Device                               device;
+    std::mutex                               mutex;
+    std::multimap<std::uint64_t, Entry>      modules;
+};
+
+ShaderCache::ShaderCache(vk::Device device) :
+pImpl(std::make_unique<Impl>()) {
+    pImpl->device = device;
+}
+
+ShaderCache::~ShaderCache() {
+}
+
+vk::ShaderModule ShaderCache::Load(const std::filesystem::path& path) {
+    MappedFile file(path);
+    auto data = file.GetData();
+    if (data.size() % sizeof(std::uint32_t)) throw std::runtime_error("Invalid SPIR-V file " + path.string());
+    return Load(std::span(reinterpret_cast<const std::uint32_t*>(data.data()), data.size() / sizeof(std::uint32_t)));
+}
+
+vk::ShaderModule ShaderCache::Load(std::span<const std::uint32_t> code) {
+    if (code.size() < 5 || code[0] != SpirvMagic) throw std::runtime_error("Invalid SPIR-V code");
+    auto hash = HashCode(code);
+    std::lock_guard lock(pImpl->mutex);
+    auto [first, last] = pImpl->modules.equal_range(hash);
+    for (auto it = first; it != last; ++it) {
+        if (std::ranges::equal(it->second.code, code)) return *it->second.module;
+    }
+    auto module = pImpl->device.createShaderModuleUnique(vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(), code));
+    auto entry  = pImpl->modules.emplace(hash, Impl::Entry{ std::vector(code.begin(), code.end()), std::move(module) });
+    return *entry->second.module;
+}
+
+} // namespace Starlight::Core
@@ -0,0 +1,184 @@
+/**
+ * @file
+ * @brief
+ * Load the shader modules and specialize their constants.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_SHADER_HPP
+#define STARLIGHT_CORE_SHADER_HPP
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vulkan/vulkan.hpp>
+
+namespace Starlight::Core {
+
+/**
+ * @brief A value of a specialization constant.
+ *
+ * A specialization constant is declared once as an alias with the ID of the `constant_id` layout qualifier in the shader,
+ * and its values are constructed from the alias, so the ID and the type are checked at compile time:
+ *
+ * @code{.cpp}
+ * using WorkgroupSize = SpecConstant<0, std::uint32_t>;
+ * using UseShadows    = SpecConstant<1, bool>;
+ * constexpr Specialization specialization(WorkgroupSize{ 64 }, UseShadows{ true });
+ * @endcode
+ *
+ * @tparam Id The ID of the constant.
+ * @tparam T  The type of the constant, which is bool, a 32-bit or 64-bit integer, float or double.
+ */
+template <std::uint32_t Id, typename T>
+struct SpecConstant final {
+    static_assert(std::is_same_v<T, bool> || ((std::is_integral_v<T> || std::is_floating_point_v<T>) && (sizeof(T) == 4 || sizeof(T) == 8)),
+                  "A specialization constant must be bool, a 32-bit or 64-bit integer, float or double");
+    static constexpr std::uint32_t id   = Id;                                                      ///< The ID of the constant.
+    static constexpr std::size_t   size = std::is_same_v<T, bool> ? sizeof(VkBool32) : sizeof(T); ///< The size of the packed value.
+    using Type = T;                                                                                ///< The type of the constant.
+    T value;                                                                                       ///< The value of the constant.
+};
+
+/**
+ * @brief A set of specialization constants.
+ *
+ * This class packs the values of the constants and their map entries at compile time,
+ * so creating a variant of a pipeline does not branch on uniforms at runtime.
+ * A bool is packed as a `VkBool32`, as SPIR-V requires.
+ *
+ * @tparam Constants The SpecConstant types of the constants, whose IDs must be unique.
+ */
+template <typename... Constants>
+class Specialization final {
+public:
+    /**
+     * @brief Construct a set of specialization constants.
+     *
+     * @param constants The values of the constants.
+     */
+    constexpr explicit Specialization(Constants... constants) : entries(), data() {
+        static_assert(IsUnique(), "The IDs of the specialization constants must be unique");
+        [[maybe_unused]] std::size_t index  = 0;
+        [[maybe_unused]] std::size_t offset = 0;
+        (Pack(constants, index, offset), ...);
+    }
+
+    /**
+     * @brief Get the specialization info.
+     *
+     * @return The specialization info, which points to this object.
+     */
+    vk::SpecializationInfo GetInfo(void) const {
+        if constexpr (sizeof...(Constants) == 0) {
+            return vk::SpecializationInfo();
+        } else {
+            return vk::SpecializationInfo(static_cast<std::uint32_t>(entries.size()), entries.data(), data.size(), data.data());
+        }
+    }
+
+private:
+    static constexpr bool IsUnique(void) {
+        std::array<std::uint32_t, sizeof...(Constants)> ids{ Constants::id... };
+        for (std::size_t i = 0; i < ids.size(); ++i) {
+            for (std::size_t j = i + 1; j < ids.size(); ++j) if (ids[i] == ids[j]) return false;
+        }
+        return true;
+    }
+
+    template <typename Constant>
+    constexpr void Pack(const Constant& constant, std::size_t& index, std::size_t& offset) {
+        using T = typename Constant::Type;
+        constexpr auto size = Constant::size;
+        std::array<std::byte, size> bytes;
+        if constexpr (std::is_same_v<T, bool>) {
+            bytes = std::bit_cast<std::array<std::byte, size>>(static_cast<VkBool32>(constant.value ? VK_TRUE : VK_FALSE));
+        } else {
+            bytes = std::bit_cast<std::array<std::byte, size>>(constant.value);
+        }
+        for (std::size_t i = 0; i < size; ++i) data[offset + i] = bytes[i];
+        entries[index++] = vk::SpecializationMapEntry(Constant::id, static_cast<std::uint32_t>(offset), size);
+        offset += size;
+    }
+
+    std::array<vk::SpecializationMapEntry, sizeof...(Constants)> entries;
+    std::array<std::byte, (Constants::size + ... + 0)>          data;
+};
+
+/**
+ * @brief Cache the shader modules.
+ *
+ * This class creates a shader module once for each distinct SPIR-V code, keyed by a hash of the code,
+ * so pipelines that share a shader share its module.
+ * The code of each module is kept and compared on a hash hit, so codes whose hashes collide never share a module.
+ * The precompiled SPIR-V files are memory-mapped while their modules are created.
+ * The modules are owned by this object and destroyed with it.
+ * All methods are thread safe.
+ */
+class ShaderCache final {
+public:
+    /**
+     * @brief Construct a new ShaderCache object.
+     *
+     * @param device The logical device.
+     */
+    explicit ShaderCache(vk::Device device);
+
+    /**
+     * @brief Destruct the ShaderCache object.
+     */
+    ~ShaderCache();
+
+    /**
+     * @brief Get the shader module of a SPIR-V file.
+     *
+     * @param path The path of the SPIR-V file.
+     *
+     * @return The shader module.
+     *
+     * @throw std::runtime_error If the file cannot be mapped or is not SPIR-V.
+     */
+    vk::ShaderModule Load(const std::filesystem::path& path);
+
+    /**
+     * @brief Get the shader module of SPIR-V code.
+     *
+     * @param code The SPIR-V code.
+     *
+     * @return The shader module.
+     *
+     * @throw std::runtime_error If the code is not SPIR-V.
+     */
+    vk::ShaderModule Load(std::span<const std::uint32_t> code);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_SHADER_HPP
@@ -0,0 +1,175 @@
+/**
+ * @file
+ * @brief
+ * Schedule the residency of the streamed textures.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include "streaming.hpp"
+
+namespace Starlight::Core {
+
+struct ResidencyScheduler::Impl {
+    struct Texture {
+        std::vector<std::size_t>      tailBytes;
+        std::uint32_t                 resident;
+        std::uint32_t                 wanted;
+        float                         priority = 0.0f;
+        bool                          pending  = false;
+        std::uint32_t GetCoarsest(void) const {
+            return static_cast<std::uint32_t>(tailBytes.size() - 1);
+        }
+    };
+    struct Request {
+        std::uint32_t                 mipLevel;
+        float                         priority;
+    };
+    float                                        decay;
+    std::unordered_map<std::uint32_t, Texture>   textures;
+    std::size_t                                  residentBytes = 0;
+    std::mutex                                   mutex;
+    std::unordered_map<std::uint32_t, Request>   requests;
+    std::vector<ResidencyChange>                 changes;
+    std::size_t                                  frameLeft;
+    void Change(std::uint32_t id, Texture& texture, std::uint32_t mipLevel) {
+        auto bytes = texture.tailBytes[mipLevel];
+        residentBytes    = residentBytes + bytes - texture.tailBytes[texture.resident];
+        frameLeft       -= bytes;
+        texture.resident = mipLevel;
+        texture.pending  = true;
+        changes.push_back({ id, mipLevel, bytes });
+    }
+};
+
+ResidencyScheduler::ResidencyScheduler(float decay) :
+pImpl(std::make_unique<Impl>()) {
+    pImpl->decay = decay;
+}
+
+ResidencyScheduler::~ResidencyScheduler() {
+}
+
+void ResidencyScheduler::Add(std::uint32_t texture, std::vector<std::size_t> mipSizes) {
+    if (mipSizes.empty()) throw std::runtime_error("The texture has no mip level");
+    Impl::Texture entry;
+    entry.tailBytes = std::move(mipSizes);
+    for (auto i = entry.tailBytes.size() - 1; i-- > 0;) entry.tailBytes[i] += entry.tailBytes[i + 1];
+    entry.resident = entry.GetCoarsest();
+    entry.wanted   = entry.resident;
+    pImpl->residentBytes += entry.tailBytes[entry.resident];
+    if (auto [found, added] = pImpl->textures.try_emplace(texture, std::move(entry)); !added) throw std::runtime_error("The texture is already streamed");
+}
+
+void ResidencyScheduler::Remove(std::uint32_t texture) {
+    auto found = pImpl->textures.find(texture);
+    if (found == pImpl->textures.end()) return;
+    pImpl->residentBytes -= found->second.tailBytes[found->second.resident];
+    pImpl->textures.erase(found);
+    std::lock_guard lock(pImpl->mutex);
+    pImpl->requests.erase(texture);
+}
+
+void ResidencyScheduler::Request(std::uint32_t texture, std::uint32_t mipLevel, float priority) {
+    std::lock_guard lock(pImpl->mutex);
+    auto [found, added] = pImpl->requests.try_emplace(texture, Impl::Request{ mipLevel, priority });
+    if (added) return;
+    found->second.mipLevel = std::min(found->second.mipLevel, mipLevel);
+    found->second.priority = std::max(found->second.priority, priority);
+}
+
+std::vector<ResidencyChange> ResidencyScheduler::Schedule(std::size_t residencyBudget, std::size_t frameBudget) {
+    std::unordered_map<std::uint32_t, Impl::Request> requests;
+    {
+        std::lock_guard lock(pImpl->mutex);
+        requests.swap(pImpl->requests);
+    }
+    std::vector<std::pair<std::uint32_t, Impl::Texture*>> candidates;
+    std::vector<std::pair<std::uint32_t, Impl::Texture*>> victims;
+    for (auto& [id, texture] : pImpl->textures) {
+        if (auto found = requests.find(id); found != requests.end()) {
+            texture.wanted   = std::min(found->second.mipLevel, texture.GetCoarsest());
+            texture.priority = found->second.priority;
+        } else {
+            texture.priority *= pImpl->decay;
+        }
+        if (texture.pending) continue;
+        if (texture.wanted   < texture.resident     ) candidates.emplace_back(id, &texture);
+        if (texture.resident < texture.GetCoarsest()) victims.emplace_back(id, &texture);
+    }
+    auto order = [](const auto& lhs, const auto& rhs) {
+        if (lhs.second->priority != rhs.second->priority) return lhs.second->priority > rhs.second->priority;
+        return lhs.first < rhs.first;
+    };
+    std::ranges::sort(candidates, order);
+    std::ranges::sort(victims, [&](const auto& lhs, const auto& rhs) { return order(rhs, lhs); });
+    pImpl->changes.clear();
+    pImpl->frameLeft = frameBudget;
+    auto victim = victims.begin();
+    auto demote = [&](const Impl::Texture* keep, float priority, std::size_t reserved) {
+        while (victim != victims.end() && victim->second->pending) ++victim;
+        for (auto it = victim; it != victims.end(); ++it) {
+            auto& [id, texture] = *it;
+            if (texture->pending || texture == keep) continue;
+            if (texture->priority >= priority) return false;
+            if (texture->tailBytes[texture->resident + 1] + reserved > pImpl->frameLeft) return false;
+            pImpl->Change(id, *texture, texture->resident + 1);
+            return true;
+        }
+        return false;
+    };
+    for (auto& [id, texture] : candidates) {
+        if (texture->pending) continue;
+        for (auto target = texture->wanted; target < texture->resident; ++target) {
+            auto bytes = texture->tailBytes[target];
+            if (bytes > pImpl->frameLeft) continue;
+            auto growth = bytes - texture->tailBytes[texture->resident];
+            while (pImpl->residentBytes + growth > residencyBudget && demote(texture, texture->priority, bytes)) {
+            }
+            if (pImpl->residentBytes + growth > residencyBudget || bytes > pImpl->frameLeft) continue;
+            pImpl->Change(id, *texture, target);
+            break;
+        }
+    }
+    while (pImpl->residentBytes > residencyBudget && demote(nullptr, std::numeric_limits<float>::infinity(), 0)) {
+    }
+    return std::move(pImpl->changes);
+}
+
+void ResidencyScheduler::Complete(std::uint32_t texture) {
+    if (auto found = pImpl->textures.find(texture); found != pImpl->textures.end()) found->second.pending = false;
+}
+
+std::uint32_t ResidencyScheduler::GetResidentMip(std::uint32_t texture) const {
+    auto found = pImpl->textures.find(texture);
+    if (found == pImpl->textures.end()) throw std::runtime_error("The texture is not streamed");
+    return found->second.resident;
+}
+
+std::size_t ResidencyScheduler::GetResidentBytes(void) const {
+    return pImpl->residentBytes;
+}
+
+} // namespace Starlight::Core
@@ -0,0 +1,140 @@
+/**
+ * @file
+ * @brief
+ * Schedule the residency of the streamed textures.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_STREAMING_HPP
+#define STARLIGHT_CORE_STREAMING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Starlight::Core {
+
+/**
+ * @brief A change of the resident mip levels of a texture.
+ */
+struct ResidencyChange final {
+    std::uint32_t texture;  ///< The identifier of the texture.
+    std::uint32_t mipLevel; ///< The finest mip level that becomes resident.
+    std::size_t   bytes;    ///< The number of bytes to upload for the change.
+};
+
+/**
+ * @brief Schedule the residency of the streamed textures.
+ *
+ * This class decides which mip levels of the streamed textures are resident.
+ * Each frame, the renderer requests the finest mip level it sampled with a priority, and Schedule
+ * promotes the most important textures within a per-frame upload budget and a residency budget.
+ * When the residency budget is exceeded, the textures with the lowest priority are demoted one level at a time.
+ * The priority of an unrequested texture decays every frame, so textures that are no longer seen are the first to go.
+ * The coarsest mip level of a texture is always resident.
+ * A texture is pending from the change that Schedule returns until Complete, and is not changed again meanwhile.
+ * Request is thread safe, and the other methods must be called from one thread.
+ */
+class ResidencyScheduler final {
+public:
+    /**
+     * @brief Construct a new ResidencyScheduler object.
+     *
+     * @param decay The factor that the priority of an unrequested texture is multiplied by every frame.
+     */
+    explicit ResidencyScheduler(float decay = 0.9f);
+
+    /**
+     * @brief Destruct the ResidencyScheduler object.
+     */
+    ~ResidencyScheduler();
+
+    /**
+     * @brief Add a texture.
+     *
+     * Only the coarsest mip level is resident at first.
+     *
+     * @param texture  The identifier of the texture.
+     * @param mipSizes The size of each mip level in bytes, from the finest to the coarsest.
+     */
+    void Add(std::uint32_t texture, std::vector<std::size_t> mipSizes);
+
+    /**
+     * @brief Remove a texture.
+     *
+     * @param texture The identifier of the texture.
+     */
+    void Remove(std::uint32_t texture);
+
+    /**
+     * @brief Request a mip level of a texture for the current frame.
+     *
+     * The finest mip level and the highest priority of the requests of a frame are kept.
+     * Requests for unknown textures are ignored.
+     *
+     * @param texture  The identifier of the texture.
+     * @param mipLevel The finest mip level that was sampled.
+     * @param priority The priority of the request, such as the screen coverage of the texture.
+     */
+    void Request(std::uint32_t texture, std::uint32_t mipLevel, float priority);
+
+    /**
+     * @brief Schedule the changes of a frame.
+     *
+     * @param residencyBudget The number of bytes that the resident mip levels of all textures may occupy.
+     * @param frameBudget     The number of bytes that may be uploaded in this frame.
+     *
+     * @return The changes, each of which makes its texture pending.
+     */
+    std::vector<ResidencyChange> Schedule(std::size_t residencyBudget, std::size_t frameBudget);
+
+    /**
+     * @brief Complete the pending change of a texture.
+     *
+     * @param texture The identifier of the texture.
+     */
+    void Complete(std::uint32_t texture);
+
+    /**
+     * @brief Get the finest resident mip level of a texture, including a pending change.
+     *
+     * @param texture The identifier of the texture.
+     *
+     * @return The mip level.
+     */
+    std::uint32_t GetResidentMip(std::uint32_t texture) const;
+
+    /**
+     * @brief Get the number of bytes that the resident mip levels occupy, including the pending changes.
+     *
+     * @return The number of bytes.
+     */
+    std::size_t GetResidentBytes(void) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_STREAMING_HPP
@@ -0,0 +1,146 @@
+/**
+ * @file
+ * @brief
+ * Synchronize the GPU work with timeline semaphores.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include "sync.hpp"
+
+namespace Starlight::Core {
+
+static bool WaitPoints(vk::Device device, std::span<const SyncPoint> points, std::uint64_t timeout, vk::SemaphoreWaitFlags flags) {
+    if (points.empty()) return true;
+    std::vector<vk::Semaphore> semaphores;
+    std::vector<std::uint64_t> values;
+    for (const auto& point : points) {
+        semaphores.push_back(point.semaphore);
+        values    .push_back(point.value    );
+    }
+    vk::SemaphoreWaitInfo info(flags, semaphores, values);
+    auto result = device.waitSemaphores(info, timeout);
+    if (result == vk::Result::eTimeout) return false;
+    if (result != vk::Result::eSuccess) throw std::runtime_error("Failed to wait for the timeline semaphores");
+    return true;
+}
+
+Timeline::Timeline(vk::Device device) :
+device(device), pending(0) {
+    vk::StructureChain<vk::SemaphoreCreateInfo, vk::SemaphoreTypeCreateInfo> info;
+    info.get<vk::SemaphoreTypeCreateInfo>().setSemaphoreType(vk::SemaphoreType::eTimeline).setInitialValue(0);
+    semaphore = device.createSemaphoreUnique(info.get<vk::SemaphoreCreateInfo>());
+}
+
+vk::Semaphore Timeline::GetSemaphore(void) const {
+    return *semaphore;
+}
+
+SyncPoint Timeline::Next(void) {
+    return { *semaphore, ++pending };
+}
+
+SyncPoint Timeline::GetPending(void) const {
+    return { *semaphore, pending.load() };
+}
+
+std::uint64_t Timeline::GetCompleted(void) const {
+    return device.getSemaphoreCounterValue(*semaphore);
+}
+
+bool Timeline::IsComplete(std::uint64_t value) const {
+    return GetCompleted() >= value;
+}
+
+void Timeline::Wait(std::uint64_t value) const {
+    SyncPoint point{ *semaphore, value };
+    WaitPoints(device, std::span(&point, 1), std::numeric_limits<std::uint64_t>::max(), {});
+}
+
+bool WaitAll(vk::Device device, std::span<const SyncPoint> points, std::uint64_t timeout) {
+    return WaitPoints(device, points, timeout, {});
+}
+
+bool WaitAny(vk::Device device, std::span<const SyncPoint> points, std::uint64_t timeout) {
+    return WaitPoints(device, points, timeout, vk::SemaphoreWaitFlagBits::eAny);
+}
+
+Submission& Submission::Wait(const SyncPoint& point, vk::PipelineStageFlags2 stages) {
+    waitInfos.emplace_back(point.semaphore, point.value, stages);
+    return *this;
+}
+
+Submission& Submission::Wait(vk::Semaphore semaphore, vk::PipelineStageFlags2 stages) {
+    waitInfos.emplace_back(semaphore, 0, stages);
+    return *this;
+}
+
+Submission& Submission::Execute(vk::CommandBuffer commandBuffer) {
+    commandInfos.emplace_back(commandBuffer);
+    return *this;
+}
+
+Submission& Submission::Signal(const SyncPoint& point, vk::PipelineStageFlags2 stages) {
+    signalInfos.emplace_back(point.semaphore, point.value, stages);
+    return *this;
+}
+
+Submission& Submission::Signal(vk::Semaphore semaphore, vk::PipelineStageFlags2 stages) {
+    signalInfos.emplace_back(semaphore, 0, stages);
+    return *this;
+}
+
+vk::SubmitInfo2 Submission::GetInfo(void) const {
+    vk::SubmitInfo2 info;
+    info.setWaitSemaphoreInfos  (waitInfos   );
+    info.setCommandBufferInfos  (commandInfos);
+    info.setSignalSemaphoreInfos(signalInfos );
+    return info;
+}
+
+Queue::Queue() :
+queue(nullptr) {
+}
+
+Queue::Queue(vk::Queue queue, std::shared_ptr<std::mutex> mutex) :
+queue(queue), mutex(mutex) {
+}
+
+vk::Queue Queue::Get(void) const {
+    return queue;
+}
+
+void Queue::Submit(std::span<const Submission> submissions, vk::Fence fence) {
+    std::vector<vk::SubmitInfo2> infos;
+    for (const auto& submission : submissions) infos.push_back(submission.GetInfo());
+    std::lock_guard lock(*mutex);
+    queue.submit2(infos, fence);
+}
+
+void Queue::Submit(const Submission& submission, vk::Fence fence) {
+    Submit(std::span(&submission, 1), fence);
+}
+
+vk::Result Queue::Present(const vk::PresentInfoKHR& info) {
+    std::lock_guard lock(*mutex);
+    return queue.presentKHR(info);
+}
+
+} // namespace Starlight::Core
@@ -0,0 +1,289 @@
+/**
+ * @file
+ * @brief
+ * Synchronize the GPU work with timeline semaphores.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_SYNC_HPP
+#define STARLIGHT_CORE_SYNC_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace Starlight::Core {
+
+/**
+ * @brief A point on a timeline semaphore.
+ *
+ * The point is reached when the semaphore has been signaled with the value or a larger one.
+ */
+struct SyncPoint final {
+    vk::Semaphore semaphore; ///< The timeline semaphore.
+    std::uint64_t value;     ///< The value on the timeline.
+};
+
+/**
+ * @brief A timeline semaphore.
+ *
+ * This class owns a timeline semaphore and hands out the values that submissions signal.
+ * Values are reserved by Next in increasing order, so a point completes no later than any larger point.
+ * All methods are thread safe.
+ */
+class Timeline final {
+public:
+    /**
+     * @brief Construct a new Timeline object.
+     *
+     * @param device The logical device.
+     */
+    explicit Timeline(vk::Device device);
+
+    /**
+     * @brief Get the timeline semaphore.
+     *
+     * @return The timeline semaphore.
+     */
+    vk::Semaphore GetSemaphore(void) const;
+
+    /**
+     * @brief Reserve the next value to signal.
+     *
+     * @return The point of the reserved value.
+     */
+    SyncPoint Next(void);
+
+    /**
+     * @brief Get the last reserved value.
+     *
+     * @return The point of the last reserved value.
+     */
+    SyncPoint GetPending(void) const;
+
+    /**
+     * @brief Get the value that the GPU has reached.
+     *
+     * @return The current value of the semaphore.
+     */
+    std::uint64_t GetCompleted(void) const;
+
+    /**
+     * @brief Check if a value has been reached.
+     *
+     * @param value The value on the timeline.
+     *
+     * @return true if the value has been reached, false otherwise.
+     */
+    bool IsComplete(std::uint64_t value) const;
+
+    /**
+     * @brief Wait for a value to be reached.
+     *
+     * If the wait fails, a `std::runtime_error` exception is thrown.
+     *
+     * @param value The value on the timeline.
+     *
+     * @throw std::runtime_error If the wait fails.
+     */
+    void Wait(std::uint64_t value) const;
+
+private:
+    vk::Device                 device;
+    vk::UniqueSemaphore        semaphore;
+    std::atomic<std::uint64_t> pending;
+};
+
+/**
+ * @brief Wait for all of the points to be reached.
+ *
+ * @param device  The logical device.
+ * @param points  The points to wait for.
+ * @param timeout The timeout in nanoseconds.
+ *
+ * @return true if all of the points have been reached, false on timeout.
+ *
+ * @throw std::runtime_error If the wait fails.
+ */
+bool WaitAll(vk::Device device, std::span<const SyncPoint> points, std::uint64_t timeout = std::numeric_limits<std::uint64_t>::max());
+
+/**
+ * @brief Wait for any of the points to be reached.
+ *
+ * @param device  The logical device.
+ * @param points  The points to wait for.
+ * @param timeout The timeout in nanoseconds.
+ *
+ * @return true if any of the points has been reached, false on timeout.
+ *
+ * @throw std::runtime_error If the wait fails.
+ */
+bool WaitAny(vk::Device device, std::span<const SyncPoint> points, std::uint64_t timeout = std::numeric_limits<std::uint64_t>::max());
+
+/**
+ * @brief A batch of work for a queue.
+ *
+ * This class collects the semaphores to wait for, the command buffers to execute,
+ * and the semaphores to signal, and submits them with a single `vkQueueSubmit2`.
+ * Timeline points and binary semaphores can be mixed freely.
+ *
+ * Example:
+ * @code{.cpp}
+ * Submission submission;
+ * submission.Wait(upload, vk::PipelineStageFlagBits2::eVertexInput);
+ * submission.Execute(commandBuffer);
+ * submission.Signal(timeline.Next());
+ * queue.Submit(submission);
+ * @endcode
+ */
+class Submission final {
+public:
+    /**
+     * @brief Wait for a timeline point before the given stages.
+     *
+     * @param point  The point to wait for.
+     * @param stages The stages that wait.
+     *
+     * @return This submission.
+     */
+    Submission& Wait(const SyncPoint& point, vk::PipelineStageFlags2 stages);
+
+    /**
+     * @brief Wait for a binary semaphore before the given stages.
+     *
+     * @param semaphore The binary semaphore to wait for.
+     * @param stages    The stages that wait.
+     *
+     * @return This submission.
+     */
+    Submission& Wait(vk::Semaphore semaphore, vk::PipelineStageFlags2 stages);
+
+    /**
+     * @brief Execute a command buffer.
+     *
+     * @param commandBuffer The command buffer to execute.
+     *
+     * @return This submission.
+     */
+    Submission& Execute(vk::CommandBuffer commandBuffer);
+
+    /**
+     * @brief Signal a timeline point after the given stages.
+     *
+     * @param point  The point to signal.
+     * @param stages The stages to complete before signaling.
+     *
+     * @return This submission.
+     */
+    Submission& Signal(const SyncPoint& point, vk::PipelineStageFlags2 stages = vk::PipelineStageFlagBits2::eAllCommands);
+
+    /**
+     * @brief Signal a binary semaphore after the given stages.
+     *
+     * @param semaphore The binary semaphore to signal.
+     * @param stages    The stages to complete before signaling.
+     *
+     * @return This submission.
+     */
+    Submission& Signal(vk::Semaphore semaphore, vk::PipelineStageFlags2 stages = vk::PipelineStageFlagBits2::eAllCommands);
+
+    /**
+     * @brief Get the submit info of the batch.
+     *
+     * The returned structure points into this submission and is valid as long as it is not modified.
+     *
+     * @return The submit info.
+     */
+    vk::SubmitInfo2 GetInfo(void) const;
+
+private:
+    std::vector<vk::SemaphoreSubmitInfo>     waitInfos;
+    std::vector<vk::CommandBufferSubmitInfo> commandInfos;
+    std::vector<vk::SemaphoreSubmitInfo>     signalInfos;
+};
+
+/**
+ * @brief A queue with external synchronization.
+ *
+ * Vulkan requires the host to synchronize the access to a queue.
+ * This class serializes the submissions with a mutex, which is shared by every Queue object that refers to the same queue,
+ * so the graphics, compute and transfer queues stay safe even if the hardware lacks dedicated queues.
+ */
+class Queue final {
+public:
+    /**
+     * @brief Construct an empty Queue object.
+     */
+    Queue();
+
+    /**
+     * @brief Construct a new Queue object.
+     *
+     * @param queue The queue.
+     * @param mutex The mutex shared by every Queue object that refers to the queue.
+     */
+    Queue(vk::Queue queue, std::shared_ptr<std::mutex> mutex);
+
+    /**
+     * @brief Get the queue.
+     *
+     * @return The queue.
+     */
+    vk::Queue Get(void) const;
+
+    /**
+     * @brief Submit batches of work.
+     *
+     * @param submissions The batches to submit.
+     * @param fence       The fence to signal, or null.
+     */
+    void Submit(std::span<const Submission> submissions, vk::Fence fence = nullptr);
+
+    /**
+     * @brief Submit a batch of work.
+     *
+     * @param submission The batch to submit.
+     * @param fence      The fence to signal, or null.
+     */
+    void Submit(const Submission& submission, vk::Fence fence = nullptr);
+
+    /**
+     * @brief Present swapchain images.
+     *
+     * @param info The present info.
+     *
+     * @return The result of the presentation.
+     */
+    vk::Result Present(const vk::PresentInfoKHR& info);
+
+private:
+    vk::Queue                   queue;
+    std::shared_ptr<std::mutex> mutex;
+};
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_SYNC_HPP
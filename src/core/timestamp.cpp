@@ -0,0 +1,120 @@
+/**
+ * @file
+ * @brief
+ * Measure the GPU time with timestamp queries.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <algorithm>
+#include <limits>
+#include "timestamp.hpp"
+
+namespace Starlight::Core {
+
+struct TimestampProfiler::Impl {
+    struct Zone {
+        std::string                name;
+        std::string                queue;
+        std::uint64_t              mask;
+    };
+    struct Slot {
+        vk::UniqueQueryPool        pool;
+        std::vector<Zone>          zones;
+    };
+    vk::Device                     device;
+    double                         period;
+    std::vector<std::uint32_t>     validBits;
+    std::uint32_t                  capacity;
+    std::vector<Slot>              slots;
+    std::size_t                    current;
+    std::vector<GpuZone> Resolve(Slot& slot) {
+        if (slot.zones.empty()) return {};
+        auto count = static_cast<std::uint32_t>(slot.zones.size() * 2);
+        auto flags = vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability;
+        auto stride = sizeof(std::uint64_t) * 2;
+        auto results = device.getQueryPoolResults<std::uint64_t>(*slot.pool, 0, count, count * stride, stride, flags).value;
+        std::vector<GpuZone> zones;
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> ticks;
+        for (std::size_t i = 0; i < slot.zones.size(); ++i) {
+            const auto* begin = &results[i * 4];
+            const auto* end   = &results[i * 4 + 2];
+            if (!begin[1] || !end[1]) continue;
+            const auto& zone = slot.zones[i];
+            zones.push_back({ zone.name, zone.queue, 0.0, 0.0 });
+            ticks.emplace_back(begin[0] & zone.mask, ((end[0] - begin[0]) & zone.mask));
+        }
+        if (zones.empty()) return zones;
+        auto origin = std::ranges::min(ticks, {}, &std::pair<std::uint64_t, std::uint64_t>::first).first;
+        for (std::size_t i = 0; i < zones.size(); ++i) {
+            zones[i].begin = static_cast<double>(ticks[i].first - origin) * period / 1.0e6;
+            zones[i].end   = zones[i].begin + static_cast<double>(ticks[i].second) * period / 1.0e6;
+        }
+        return zones;
+    }
+};
+
+TimestampProfiler::TimestampProfiler(vk::PhysicalDevice phyDevice, vk::Device device, std::size_t slotCount, std::uint32_t capacity) :
+pImpl(std::make_unique<Impl>()) {
+    pImpl->device   = device;
+    pImpl->period   = phyDevice.getProperties().limits.timestampPeriod;
+    pImpl->capacity = capacity;
+    pImpl->current  = 0;
+    for (const auto& property : phyDevice.getQueueFamilyProperties()) {
+        pImpl->validBits.push_back(property.timestampValidBits);
+    }
+    vk::QueryPoolCreateInfo info(vk::QueryPoolCreateFlags(), vk::QueryType::eTimestamp, capacity * 2);
+    pImpl->slots.resize(slotCount);
+    for (auto& slot : pImpl->slots) {
+        slot.pool = device.createQueryPoolUnique(info);
+        device.resetQueryPool(*slot.pool, 0, capacity * 2);
+    }
+}
+
+TimestampProfiler::~TimestampProfiler() {
+}
+
+std::vector<GpuZone> TimestampProfiler::BeginSlot(std::size_t slot) {
+    auto& target = pImpl->slots[slot];
+    auto zones = pImpl->Resolve(target);
+    if (!target.zones.empty()) pImpl->device.resetQueryPool(*target.pool, 0, static_cast<std::uint32_t>(target.zones.size() * 2));
+    target.zones.clear();
+    pImpl->current = slot;
+    return zones;
+}
+
+std::optional<std::uint32_t> TimestampProfiler::Begin(vk::CommandBuffer commandBuffer, std::uint32_t family, const std::string& queue, const std::string& name) {
+    auto& slot = pImpl->slots[pImpl->current];
+    auto  bits = family < pImpl->validBits.size() ? pImpl->validBits[family] : 0;
+    if (!bits || slot.zones.size() >= pImpl->capacity) return std::nullopt;
+    auto zone = static_cast<std::uint32_t>(slot.zones.size());
+    auto mask = bits >= 64 ? std::numeric_limits<std::uint64_t>::max() : (std::uint64_t(1) << bits) - 1;
+    slot.zones.push_back({ name, queue, mask });
+    commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe, *slot.pool, zone * 2);
+    return zone;
+}
+
+void TimestampProfiler::End(vk::CommandBuffer commandBuffer, std::optional<std::uint32_t> zone) {
+    if (!zone) return;
+    auto& slot = pImpl->slots[pImpl->current];
+    commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, *slot.pool, *zone * 2 + 1);
+}
+
+} // namespace Starlight::Core
@@ -0,0 +1,109 @@
+/**
+ * @file
+ * @brief
+ * Measure the GPU time with timestamp queries.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_TIMESTAMP_HPP
+#define STARLIGHT_CORE_TIMESTAMP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include "profiler.hpp"
+
+namespace Starlight::Core {
+
+/**
+ * @brief Measure the GPU time with timestamp queries.
+ *
+ * This class owns a timestamp query pool per frame slot and writes a pair of timestamps around each zone.
+ * The results of a slot are read back when the slot is begun again, after the GPU has finished the frame that used it,
+ * with the availability of each query, so reading them never waits for the GPU.
+ * The queries are reset from the host, which requires the `hostQueryReset` feature.
+ * Zones on queue families without timestamp support are ignored, and so are the zones that exceed the capacity of a slot.
+ * It is not thread safe.
+ */
+class TimestampProfiler final {
+public:
+    /**
+     * @brief Construct a new TimestampProfiler object.
+     *
+     * @param phyDevice The physical device to get the timestamp period and the valid bits of the queue families from.
+     * @param device    The logical device.
+     * @param slotCount The number of frame slots.
+     * @param capacity  The maximum number of zones per frame slot.
+     */
+    TimestampProfiler(vk::PhysicalDevice phyDevice, vk::Device device, std::size_t slotCount, std::uint32_t capacity = 256);
+
+    /**
+     * @brief Destruct the TimestampProfiler object.
+     */
+    ~TimestampProfiler();
+
+    /**
+     * @brief Begin a frame slot.
+     *
+     * This method resolves the zones that the previous frame of the slot measured, resets the slot,
+     * and makes it the slot that the following zones are written to.
+     * The GPU must have finished the previous frame of the slot.
+     *
+     * @param slot The index of the frame slot.
+     *
+     * @return The zones of the previous frame of the slot, in the order they were begun.
+     */
+    std::vector<GpuZone> BeginSlot(std::size_t slot);
+
+    /**
+     * @brief Begin a zone.
+     *
+     * @param commandBuffer The command buffer to write the timestamp into.
+     * @param family        The queue family that the command buffer is submitted to.
+     * @param queue         The name of the queue.
+     * @param name          The name of the zone.
+     *
+     * @return The zone to end, or nothing if the zone is ignored.
+     */
+    std::optional<std::uint32_t> Begin(vk::CommandBuffer commandBuffer, std::uint32_t family, const std::string& queue, const std::string& name);
+
+    /**
+     * @brief End a zone.
+     *
+     * The zone must be ended in the command buffer that it was begun in.
+     *
+     * @param commandBuffer The command buffer to write the timestamp into.
+     * @param zone          The zone returned by Begin.
+     */
+    void End(vk::CommandBuffer commandBuffer, std::optional<std::uint32_t> zone);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_TIMESTAMP_HPP
@@ -0,0 +1,237 @@
+/**
+ * @file
+ * @brief
+ * Upload data to the GPU on the transfer queue.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include "upload.hpp"
+
+namespace Starlight::Core {
+
+struct Uploader::Impl {
+    struct Batch {
+        vk::CommandBuffer commandBuffer;
+        std::uint64_t     value;
+        vk::DeviceSize    end;
+    };
+    struct Acquire {
+        std::uint64_t                           value;
+        std::optional<vk::BufferMemoryBarrier2> bufferBarrier;
+        std::optional<vk::ImageMemoryBarrier2>  imageBarrier;
+    };
+    vk::Device                           device;
+    Queue                                queue;
+    std::uint32_t                        transferFamily;
+    std::uint32_t                        graphicsFamily;
+    vk::DeviceSize                       alignment;
+    vk::DeviceSize                       capacity;
+    vk::DeviceSize                       head;
+    vk::DeviceSize                       tail;
+    Buffer                               staging;
+    vk::UniqueCommandPool                commandPool;
+    std::vector<vk::UniqueCommandBuffer> commandBuffers;
+    std::vector<vk::CommandBuffer>       freeCommandBuffers;
+    vk::CommandBuffer                    recording;
+    Timeline                             timeline;
+    std::deque<Batch>                    inFlight;
+    std::vector<Acquire>                 acquires;
+    std::mutex                           mutex;
+    Impl(vk::Device device, Allocator& allocator, Queue queue, std::uint32_t transferFamily, std::uint32_t graphicsFamily, vk::DeviceSize alignment, vk::DeviceSize capacity) :
+    device(device), queue(queue), transferFamily(transferFamily), graphicsFamily(graphicsFamily),
+    alignment(std::max<vk::DeviceSize>(alignment, 16)), capacity(capacity), head(0), tail(0), recording(nullptr), timeline(device) {
+        staging = allocator.CreateBuffer(vk::BufferCreateInfo(vk::BufferCreateFlags(), capacity, vk::BufferUsageFlagBits::eTransferSrc), MemoryUsage::CpuToGpu);
+        vk::CommandPoolCreateInfo poolInfo(vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient, transferFamily);
+        commandPool = device.createCommandPoolUnique(poolInfo);
+    }
+    std::uint64_t GetSubmitted(void) const {
+        return timeline.GetPending().value;
+    }
+    void Reclaim(void) {
+        auto completed = timeline.GetCompleted();
+        while (!inFlight.empty() && inFlight.front().value <= completed) {
+            tail = inFlight.front().end;
+            freeCommandBuffers.push_back(inFlight.front().commandBuffer);
+            inFlight.pop_front();
+        }
+        if (inFlight.empty() && !recording) head = tail = 0;
+    }
+    vk::DeviceSize Reserve(vk::DeviceSize size) {
+        for (;;) {
+            Reclaim();
+            auto aligned = (head + alignment - 1) / alignment * alignment;
+            if (head >= tail && aligned + size > capacity && size < tail) aligned = 0;
+            if ((head >= tail && aligned + size <= capacity) || aligned + size < tail) {
+                head = aligned + size;
+                return aligned;
+            }
+            if (recording) Submit();
+            if (inFlight.empty()) throw std::runtime_error("The upload is larger than the staging buffer");
+            timeline.Wait(inFlight.front().value);
+        }
+    }
+    vk::CommandBuffer Record(void) {
+        if (recording) return recording;
+        if (freeCommandBuffers.empty()) {
+            vk::CommandBufferAllocateInfo info(*commandPool, vk::CommandBufferLevel::ePrimary, 1);
+            freeCommandBuffers.push_back(*commandBuffers.emplace_back(std::move(device.allocateCommandBuffersUnique(info).front())));
+        }
+        recording = freeCommandBuffers.back();
+        freeCommandBuffers.pop_back();
+        recording.reset();
+        recording.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+        return recording;
+    }
+    std::byte* GetMapped(vk::DeviceSize offset) {
+        return static_cast<std::byte*>(staging.allocation.GetMapped()) + offset;
+    }
+    std::uint64_t Submit(void) {
+        if (!recording) return GetSubmitted();
+        recording.end();
+        auto point = timeline.Next();
+        Submission submission;
+        submission.Execute(recording).Signal(point);
+        queue.Submit(submission);
+        inFlight.push_back({ recording, point.value, head });
+        recording = nullptr;
+        return point.value;
+    }
+};
+
+Uploader::Uploader(vk::Device device, Allocator& allocator, Queue queue, std::uint32_t transferFamily, std::uint32_t graphicsFamily, vk::DeviceSize alignment, vk::DeviceSize capacity) :
+pImpl(std::make_unique<Impl>(device, allocator, queue, transferFamily, graphicsFamily, alignment, capacity)) {
+}
+
+Uploader::~Uploader() {
+}
+
+std::uint64_t Uploader::CopyBuffer(vk::Buffer buffer, vk::DeviceSize offset, std::span<const std::byte> data) {
+    std::lock_guard lock(pImpl->mutex);
+    if (data.empty()) return pImpl->GetSubmitted();
+    auto chunkSize = std::max<vk::DeviceSize>(pImpl->capacity / 4, 1);
+    for (vk::DeviceSize copied = 0; copied < data.size();) {
+        auto size   = std::min<vk::DeviceSize>(data.size() - copied, chunkSize);
+        auto staged = pImpl->Reserve(size);
+        std::memcpy(pImpl->GetMapped(staged), data.data() + copied, size);
+        vk::BufferCopy region(staged, offset + copied, size);
+        pImpl->Record().copyBuffer(*pImpl->staging.buffer, buffer, region);
+        copied += size;
+    }
+    if (pImpl->transferFamily != pImpl->graphicsFamily) {
+        vk::BufferMemoryBarrier2 release(
+            vk::PipelineStageFlagBits2::eCopy, vk::AccessFlagBits2::eTransferWrite,
+            vk::PipelineStageFlagBits2::eNone, vk::AccessFlagBits2::eNone,
+            pImpl->transferFamily, pImpl->graphicsFamily, buffer, offset, data.size()
+        );
+        pImpl->Record().pipelineBarrier2(vk::DependencyInfo().setBufferMemoryBarriers(release));
+        auto& acquire = pImpl->acquires.emplace_back(pImpl->GetSubmitted() + 1);
+        acquire.bufferBarrier = release;
+        acquire.bufferBarrier->setSrcStageMask (vk::PipelineStageFlagBits2::eNone);
+        acquire.bufferBarrier->setSrcAccessMask(vk::AccessFlagBits2::eNone);
+        acquire.bufferBarrier->setDstStageMask (vk::PipelineStageFlagBits2::eAllCommands);
+        acquire.bufferBarrier->setDstAccessMask(vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite);
+    }
+    return pImpl->GetSubmitted() + 1;
+}
+
+std::uint64_t Uploader::CopyImage(vk::Image image, const vk::ImageSubresourceLayers& subresource, const vk::Extent3D& extent, std::span<const std::byte> data, vk::ImageLayout layout) {
+    std::lock_guard lock(pImpl->mutex);
+    auto staged = pImpl->Reserve(data.size());
+    std::memcpy(pImpl->GetMapped(staged), data.data(), data.size());
+    vk::ImageSubresourceRange range(subresource.aspectMask, subresource.mipLevel, 1, subresource.baseArrayLayer, subresource.layerCount);
+    vk::ImageMemoryBarrier2 before(
+        vk::PipelineStageFlagBits2::eNone, vk::AccessFlagBits2::eNone,
+        vk::PipelineStageFlagBits2::eCopy, vk::AccessFlagBits2::eTransferWrite,
+        vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+        VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, image, range
+    );
+    vk::ImageMemoryBarrier2 after(
+        vk::PipelineStageFlagBits2::eCopy, vk::AccessFlagBits2::eTransferWrite,
+        vk::PipelineStageFlagBits2::eAllCommands, vk::AccessFlagBits2::eNone,
+        vk::ImageLayout::eTransferDstOptimal, layout,
+        VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, image, range
+    );
+    if (pImpl->transferFamily != pImpl->graphicsFamily) {
+        after.setDstStageMask(vk::PipelineStageFlagBits2::eNone);
+        after.setSrcQueueFamilyIndex(pImpl->transferFamily);
+        after.setDstQueueFamilyIndex(pImpl->graphicsFamily);
+    }
+    auto commandBuffer = pImpl->Record();
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo().setImageMemoryBarriers(before));
+    vk::BufferImageCopy region(staged, 0, 0, subresource, vk::Offset3D(0, 0, 0), extent);
+    commandBuffer.copyBufferToImage(*pImpl->staging.buffer, image, vk::ImageLayout::eTransferDstOptimal, region);
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo().setImageMemoryBarriers(after));
+    if (pImpl->transferFamily != pImpl->graphicsFamily) {
+        auto& acquire = pImpl->acquires.emplace_back(pImpl->GetSubmitted() + 1);
+        acquire.imageBarrier = after;
+        acquire.imageBarrier->setSrcStageMask (vk::PipelineStageFlagBits2::eNone);
+        acquire.imageBarrier->setSrcAccessMask(vk::AccessFlagBits2::eNone);
+        acquire.imageBarrier->setDstStageMask (vk::PipelineStageFlagBits2::eAllCommands);
+        acquire.imageBarrier->setDstAccessMask(vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite);
+    }
+    return pImpl->GetSubmitted() + 1;
+}
+
+std::uint64_t Uploader::Flush(void) {
+    std::lock_guard lock(pImpl->mutex);
+    return pImpl->Submit();
+}
+
+bool Uploader::IsComplete(std::uint64_t token) {
+    return pImpl->timeline.IsComplete(token);
+}
+
+void Uploader::Wait(std::uint64_t token) {
+    {
+        std::lock_guard lock(pImpl->mutex);
+        if (token > pImpl->GetSubmitted()) pImpl->Submit();
+    }
+    pImpl->timeline.Wait(token);
+}
+
+std::optional<SyncPoint> Uploader::RecordAcquires(vk::CommandBuffer commandBuffer) {
+    std::lock_guard lock(pImpl->mutex);
+    auto completed = pImpl->timeline.GetCompleted();
+    std::vector<vk::BufferMemoryBarrier2> bufferBarriers;
+    std::vector<vk::ImageMemoryBarrier2>  imageBarriers;
+    std::erase_if(pImpl->acquires, [&](const Impl::Acquire& acquire) {
+        if (acquire.value > completed) return false;
+        if (acquire.bufferBarrier) bufferBarriers.push_back(*acquire.bufferBarrier);
+        if (acquire.imageBarrier ) imageBarriers .push_back(*acquire.imageBarrier );
+        return true;
+    });
+    if (!bufferBarriers.empty() || !imageBarriers.empty()) {
+        commandBuffer.pipelineBarrier2(vk::DependencyInfo().setBufferMemoryBarriers(bufferBarriers).setImageMemoryBarriers(imageBarriers));
+    }
+    // Seeing the value on the host does not make the copies visible to another queue, so the submission always waits for it
+    if (!completed) return std::nullopt;
+    return SyncPoint{ pImpl->timeline.GetSemaphore(), completed };
+}
+
+const Timeline& Uploader::GetTimeline(void) const {
+    return pImpl->timeline;
+}
+
+} // namespace Starlight::Core
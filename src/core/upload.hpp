@@ -0,0 +1,165 @@
+/**
+ * @file
+ * @brief
+ * Upload data to the GPU on the transfer queue.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#ifndef STARLIGHT_CORE_UPLOAD_HPP
+#define STARLIGHT_CORE_UPLOAD_HPP
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vulkan/vulkan.hpp>
+#include "allocator.hpp"
+#include "sync.hpp"
+
+namespace Starlight::Core {
+
+/**
+ * @brief Upload data to the GPU on the transfer queue.
+ *
+ * This class copies data into a persistently mapped staging ring buffer and records the copies
+ * into a batch, which is submitted to the transfer queue by Flush.
+ * Each batch signals a timeline semaphore, and the value it signals is the completion token of its copies.
+ * If the transfer queue belongs to another family than the graphics queue,
+ * the ownership of the destination is released after the copy and must be acquired on the graphics queue by RecordAcquires.
+ * In any case, a graphics submission may only use the completed copies if it waits for the point returned by RecordAcquires.
+ * All methods are thread safe.
+ *
+ * Example:
+ * @code{.cpp}
+ * auto token = uploader.CopyBuffer(buffer, 0, data);
+ * uploader.Flush();
+ * // Keep rendering...
+ * if (uploader.IsComplete(token)) {
+ *     // The buffer can be used from the next graphics submission that waits for RecordAcquires.
+ * }
+ * @endcode
+ */
+class Uploader final {
+public:
+    /**
+     * @brief Construct a new Uploader object.
+     *
+     * @param device         The logical device.
+     * @param allocator      The allocator to create the staging buffer with.
+     * @param queue          The transfer queue to submit the copies to.
+     * @param transferFamily The queue family index of the transfer queue.
+     * @param graphicsFamily The queue family index of the graphics queue that receives the ownership.
+     * @param alignment      The alignment of the copies in the staging buffer.
+     * @param capacity       The size of the staging buffer.
+     */
+    Uploader(vk::Device device, Allocator& allocator, Queue queue, std::uint32_t transferFamily, std::uint32_t graphicsFamily, vk::DeviceSize alignment, vk::DeviceSize capacity);
+
+    /**
+     * @brief Destruct the Uploader object.
+     *
+     * The GPU must have finished the submitted copies before destroying the uploader.
+     */
+    ~Uploader();
+
+    /**
+     * @brief Copy data to a buffer.
+     *
+     * Data larger than the staging buffer is split into several copies.
+     *
+     * @param buffer The destination buffer.
+     * @param offset The offset in the destination buffer.
+     * @param data   The data to copy.
+     *
+     * @return The completion token of the copy.
+     */
+    std::uint64_t CopyBuffer(vk::Buffer buffer, vk::DeviceSize offset, std::span<const std::byte> data);
+
+    /**
+     * @brief Copy data to an image.
+     *
+     * The whole subresource is overwritten, and transitioned to `layout` after the copy.
+     * If the data is larger than the staging buffer, a `std::runtime_error` exception is thrown.
+     *
+     * @param image       The destination image.
+     * @param subresource The destination subresource.
+     * @param extent      The extent of the subresource.
+     * @param data        The tightly packed texels to copy.
+     * @param layout      The layout of the image after the copy.
+     *
+     * @return The completion token of the copy.
+     *
+     * @throw std::runtime_error If the data is larger than the staging buffer.
+     */
+    std::uint64_t CopyImage(vk::Image image, const vk::ImageSubresourceLayers& subresource, const vk::Extent3D& extent, std::span<const std::byte> data, vk::ImageLayout layout);
+
+    /**
+     * @brief Submit the recorded copies.
+     *
+     * @return The completion token of the submitted copies.
+     */
+    std::uint64_t Flush(void);
+
+    /**
+     * @brief Check if the copies of a token are complete.
+     *
+     * @param token The completion token.
+     *
+     * @return true if the copies are complete, false otherwise.
+     */
+    bool IsComplete(std::uint64_t token);
+
+    /**
+     * @brief Wait for the copies of a token to complete.
+     *
+     * If the copies have not been submitted yet, they are submitted first.
+     *
+     * @param token The completion token.
+     */
+    void Wait(std::uint64_t token);
+
+    /**
+     * @brief Acquire the ownership of the uploaded resources.
+     *
+     * This method records the acquire barriers of the completed copies into a graphics command buffer.
+     * The submission of the command buffer must wait for the returned point, which covers every completed copy,
+     * so their writes are visible to the submission even if no ownership transfer is needed.
+     *
+     * @param commandBuffer The graphics command buffer to record the barriers into.
+     *
+     * @return The point to wait for, or nothing if no copy has completed yet.
+     */
+    std::optional<SyncPoint> RecordAcquires(vk::CommandBuffer commandBuffer);
+
+    /**
+     * @brief Get the timeline signaled by the copies.
+     *
+     * @return The timeline.
+     */
+    const Timeline& GetTimeline(void) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace Starlight::Core
+
+#endif // STARLIGHT_CORE_UPLOAD_HPP
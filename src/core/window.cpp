@@ -23,8 +23,14 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  * @endparblock
  */
+#include <algorithm>
+#include <atomic>
 #include <mutex>
+#include <stdexcept>
+#include <vector>
 #include <GLFW/glfw3.h>
+#include "profiler.hpp"
+#include "ring.hpp"
 #include "window.hpp"
 
 namespace Starlight::Core {
@@ -32,14 +38,16 @@ namespace Starlight::Core {
 static std::once_flag initialized;
 
 struct Window::Impl {
-    GLFWwindow*    window;
-    ResizeCallback resize;
+    GLFWwindow*                window;
+    SpscRing<InputEvent>       events{ EventCapacity };
+    std::vector<InputEvent>    held;
+    std::atomic<std::uint64_t> framebufferSize;
+    std::atomic<bool>          resized{ false };
+    std::atomic<std::uint64_t> dropped{ 0 };
     Impl(const std::string& title, std::size_t width, std::size_t height, bool visible) {
-        std::call_once(initialized, [] {
-            if (glfwInit() && std::atexit(glfwTerminate)) glfwTerminate();
-        });
+        InitializeWindowSystem();
         glfwDefaultWindowHints();
-        glfwWindowHint(GLFW_RESIZABLE,                     GLFW_FALSE);
+        glfwWindowHint(GLFW_RESIZABLE,                      GLFW_TRUE);
         glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
         glfwWindowHint(GLFW_CLIENT_API,                   GLFW_NO_API);
         window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
@@ -48,15 +56,70 @@ struct Window::Impl {
             glfwGetError(&description);
             throw std::runtime_error(description);
         }
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        SetFramebufferSize(framebufferWidth, framebufferHeight);
         glfwSetWindowUserPointer(window, this);
         glfwSetFramebufferSizeCallback(window, [](GLFWwindow* window, int width, int height) {
-            auto self = static_cast<Impl*>(glfwGetWindowUserPointer(window));
-            if (self && self->resize) self->resize(width, height);
+            auto self = Get(window);
+            self->SetFramebufferSize(width, height);
+            self->Push({ .type = InputEventType::Resize, .x = static_cast<double>(width), .y = static_cast<double>(height) });
+        });
+        glfwSetKeyCallback(window, [](GLFWwindow* window, int key, int, int action, int mods) {
+            Get(window)->Push({ .type = InputEventType::Key, .code = key, .action = static_cast<InputAction>(action), .mods = mods });
+        });
+        glfwSetCharCallback(window, [](GLFWwindow* window, unsigned int codepoint) {
+            Get(window)->Push({ .type = InputEventType::Char, .code = static_cast<std::int32_t>(codepoint) });
+        });
+        glfwSetMouseButtonCallback(window, [](GLFWwindow* window, int button, int action, int mods) {
+            Get(window)->Push({ .type = InputEventType::MouseButton, .code = button, .action = static_cast<InputAction>(action), .mods = mods });
+        });
+        glfwSetCursorPosCallback(window, [](GLFWwindow* window, double x, double y) {
+            Get(window)->Push({ .type = InputEventType::CursorMove, .x = x, .y = y });
+        });
+        glfwSetScrollCallback(window, [](GLFWwindow* window, double x, double y) {
+            Get(window)->Push({ .type = InputEventType::Scroll, .x = x, .y = y });
+        });
+        glfwSetWindowFocusCallback(window, [](GLFWwindow* window, int focused) {
+            Get(window)->Push({ .type = InputEventType::Focus, .action = focused ? InputAction::Press : InputAction::Release });
         });
     }
     ~Impl() {
         glfwDestroyWindow(window);
     }
+    static Impl* Get(GLFWwindow* window) {
+        return static_cast<Impl*>(glfwGetWindowUserPointer(window));
+    }
+    static bool IsRelease(const InputEvent& event) {
+        if (event.action != InputAction::Release) return false;
+        return event.type == InputEventType::Key || event.type == InputEventType::MouseButton || event.type == InputEventType::Focus;
+    }
+    void Flush(void) {
+        std::size_t count = 0;
+        while (count < held.size() && events.TryPush(held[count])) ++count;
+        held.erase(held.begin(), held.begin() + count);
+    }
+    void Push(InputEvent event) {
+        event.time = GetProfilerTime();
+        Flush();
+        if (held.empty() && events.TryPush(event)) return;
+        if (event.type == InputEventType::Resize) {
+            resized.store(true, std::memory_order_release);
+        } else if (IsRelease(event)) {
+            held.push_back(event);
+        } else {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    std::optional<InputEvent> Pop(void) {
+        if (auto event = events.TryPop()) return event;
+        if (!resized.exchange(false, std::memory_order_acquire)) return std::nullopt;
+        auto size = framebufferSize.load();
+        return InputEvent{ .type = InputEventType::Resize, .time = GetProfilerTime(), .x = static_cast<double>(size >> 32), .y = static_cast<double>(size & 0xffffffff) };
+    }
+    void SetFramebufferSize(int width, int height) {
+        framebufferSize = static_cast<std::uint64_t>(std::max(width, 0)) << 32 | static_cast<std::uint32_t>(std::max(height, 0));
+    }
 };
 
 Window::Window(const std::string& title, std::size_t width, std::size_t height, bool visible) :
@@ -70,8 +133,17 @@ std::any Window::GetHandle(void) {
     return pImpl->window;
 }
 
-void Window::SetResizeCallback(const ResizeCallback& resize) {
-    pImpl->resize = resize;
+std::optional<InputEvent> Window::PopEvent(void) {
+    return pImpl->Pop();
+}
+
+std::uint64_t Window::GetDroppedEvents(void) const {
+    return pImpl->dropped.load(std::memory_order_relaxed);
+}
+
+std::pair<std::size_t, std::size_t> Window::GetFramebufferSize(void) const {
+    auto size = pImpl->framebufferSize.load();
+    return { static_cast<std::size_t>(size >> 32), static_cast<std::size_t>(size & 0xffffffff) };
 }
 
 bool Window::ShouldClose(void) {
@@ -83,7 +155,27 @@ void Window::CancelClose(void) {
 }
 
 void Window::PollEvents(void) {
+    STARLIGHT_ZONE("PollEvents");
     glfwPollEvents();
+    pImpl->Flush();
+}
+
+void Window::WaitEvents(double timeout) {
+    STARLIGHT_ZONE("WaitEvents");
+    glfwWaitEventsTimeout(timeout);
+    pImpl->Flush();
+}
+
+void Window::PostEmptyEvent(void) {
+    glfwPostEmptyEvent();
+}
+
+bool Window::IsIconified(void) {
+    return glfwGetWindowAttrib(pImpl->window, GLFW_ICONIFIED);
+}
+
+bool Window::IsVisible(void) {
+    return glfwGetWindowAttrib(pImpl->window, GLFW_VISIBLE);
 }
 
 void Window::ShowCursor(void) {
@@ -102,6 +194,12 @@ void Window::HideWindow(void) {
     glfwHideWindow(pImpl->window);
 }
 
+void InitializeWindowSystem(void) {
+    std::call_once(initialized, [] {
+        if (glfwInit() && std::atexit(glfwTerminate)) glfwTerminate();
+    });
+}
+
 SharedWindow CreateSharedWindow(const std::string& title, std::size_t width, std::size_t height, bool visible) {
     return std::make_shared<Window>(title, width, height, visible);
 }
@@ -27,9 +27,13 @@
 #define STARLIGHT_CORE_WINDOW_HPP
 
 #include <any>
-#include <functional>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
+#include <utility>
+#include "input.hpp"
 
 namespace Starlight::Core {
 
@@ -43,6 +47,11 @@ namespace Starlight::Core {
  * - Create an instance of Window by providing the title, width, height, and visibility.
  * - The destructor will automatically clean up the window resources when the object is destroyed.
  *
+ * The window events are handled on the main thread, which pushes them as timestamped input events into a lock-free ring buffer.
+ * Another thread, such as the thread that updates and renders, drains them with PopEvent,
+ * so handling the input never waits for a frame and a frame never waits for the input.
+ * Unless noted otherwise, the methods must be called on the main thread.
+ *
  * Example:
  * @code{.cpp}
  * Starlight::Core::Window window("My Window", 1280, 720, true);
@@ -55,20 +64,13 @@ namespace Starlight::Core {
 class Window final {
 public:
     /**
-     * @brief Callback function type for window resize events.
-     *
-     * This callback function is called when the window is resized.
-     * It receives the new width and height of the window as parameters.
-     *
-     * Signature:
-     * @code
-     * void resize(std::size_t width, std::size_t height);
-     * @endcode
+     * @brief The number of input events that the ring buffer holds.
      *
-     * @param width  The new width of the window.
-     * @param height The new height of the window.
+     * If the events are not drained, the newest events are dropped once the ring buffer is full, and counted by GetDroppedEvents.
+     * Releases of keys and buttons and losses of the focus are never dropped but held back until there is room,
+     * and resizes are coalesced into a single one that carries the latest framebuffer size.
      */
-    using ResizeCallback = std::function<void(std::size_t, std::size_t)>;
+    static constexpr std::size_t EventCapacity = 4096;
 
     /**
      * @brief Construct a new Window object.
@@ -104,20 +106,40 @@ public:
     std::any GetHandle(void);
 
     /**
-     * @brief Set the resize callback function.
+     * @brief Pop the oldest input event.
      *
-     * This method sets the callback function to be called when the window is resized.
-     * The provided `resize` function will be invoked with the new width and height as parameters.
+     * The events are pushed while the main thread polls or waits for the window events.
+     * This method may be called from any thread, but only from one thread at a time.
      *
-     * @param resize The resize callback function.
+     * @return The oldest input event, or nothing if no event is pending.
      */
-    void SetResizeCallback(const ResizeCallback& resize);
+    std::optional<InputEvent> PopEvent(void);
+
+    /**
+     * @brief Get the number of input events dropped because the ring buffer was full.
+     *
+     * This method may be called from any thread.
+     *
+     * @return The number of events dropped since the window was created.
+     */
+    std::uint64_t GetDroppedEvents(void) const;
+
+    /**
+     * @brief Get the size of the framebuffer.
+     *
+     * The size is updated when the main thread handles a resize event.
+     * This method may be called from any thread.
+     *
+     * @return The width and the height of the framebuffer in pixels.
+     */
+    std::pair<std::size_t, std::size_t> GetFramebufferSize(void) const;
 
     /**
      * @brief Check if the window should be closed.
      *
      * This method checks if the window should be closed.
      * It returns true if the window should be closed, false otherwise.
+     * It may be called from any thread.
      *
      * @return true if the window should be closed, false otherwise.
      */
@@ -139,6 +161,39 @@ public:
      */
     void PollEvents(void);
 
+    /**
+     * @brief Wait for window events.
+     *
+     * This method puts the calling thread to sleep until at least one event is received or the timeout elapses,
+     * and then processes all received events like PollEvents.
+     * It must be called on the main thread.
+     *
+     * @param timeout The maximum time to wait in seconds.
+     */
+    void WaitEvents(double timeout);
+
+    /**
+     * @brief Wake up a thread waiting for window events.
+     *
+     * This method posts an empty event, so that a pending WaitEvents call returns.
+     * It may be called from any thread.
+     */
+    void PostEmptyEvent(void);
+
+    /**
+     * @brief Check if the window is iconified.
+     *
+     * @return true if the window is iconified (minimized), false otherwise.
+     */
+    bool IsIconified(void);
+
+    /**
+     * @brief Check if the window is visible.
+     *
+     * @return true if the window is visible, false otherwise.
+     */
+    bool IsVisible(void);
+
     /**
      * @brief Show the cursor.
      *
@@ -188,6 +243,15 @@ using SharedWindow = std::shared_ptr<Window>;
  */
 using UniqueWindow = std::unique_ptr<Window>;
 
+/**
+ * @brief Initialize the windowing system.
+ *
+ * The windowing system is initialized by the first Window object, or earlier by this function,
+ * so that other threads may query it before the first window exists, such as to choose a GPU that can present.
+ * This function must be called on the main thread, and does nothing after the first call.
+ */
+void InitializeWindowSystem(void);
+
 /**
  * @brief Creates a shared pointer to a new Window object.
  *
@@ -23,15 +23,22 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  * @endparblock
  */
-#include <thread>
+#include <filesystem>
+#include "core/application.hpp"
+#include "core/config.hpp"
+#include "core/device.hpp"
 #include "core/window.hpp"
 
 int main(int argc, char** argv) {
+    if (std::filesystem::exists("settings.bin")) Starlight::Core::Config::LoadSettings("settings.bin");
+    Starlight::Core::Device::Preload(true);
     auto window = Starlight::Core::CreateSharedWindow("Starlight", 1280, 720, true);
-    while (!window->ShouldClose()) {
-        using namespace std::chrono_literals;
-        std::this_thread::sleep_for(10ms);
-        window->PollEvents();
-    }
+    Starlight::Core::Device device(window);
+    Starlight::Core::Application application(window);
+    application.SetRenderCallback([&](double) {
+        device.BeginFrame(0.0f, 0.0f, 0.0f);
+        device.EndFrame();
+    });
+    application.Run();
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,60 @@
+/**
+ * @file
+ * @brief
+ * Entry point of the settings compiler.
+ *
+ * @author
+ * Takaaki Sato
+ *
+ * @copyright @parblock
+ * (c) 2023, Demiquartz <info@demiquartz.jp>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * @endparblock
+ */
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include "core/settings.hpp"
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: starlight-settings <source> <output>" << std::endl;
+        return EXIT_FAILURE;
+    }
+    try {
+        std::ifstream input(argv[1], std::ios::binary);
+        if (!input) throw std::runtime_error(std::string("Failed to open ") + argv[1]);
+        std::string source((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+        auto data = Starlight::Core::SettingsFile::Compile(source);
+        std::filesystem::path path(argv[2]);
+        auto temp = path;
+        temp += ".tmp";
+        {
+            std::ofstream output(temp, std::ios::binary | std::ios::trunc);
+            output.write(reinterpret_cast<const char*>(data.data()), data.size());
+            if (!output) throw std::runtime_error("Failed to write " + temp.string());
+        }
+        // Replacing the file keeps the old contents mapped by running processes intact.
+        std::filesystem::rename(temp, path);
+    } catch (const std::exception& e) {
+        std::cerr << argv[1] << ": " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}